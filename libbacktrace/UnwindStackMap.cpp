@@ -39,8 +39,13 @@ bool UnwindStackMap::Build() {
     stack_maps_.reset(new unwindstack::RemoteMaps(pid_));
   }
 
-  // Create the process memory object.
-  process_memory_ = unwindstack::Memory::CreateProcessMemory(pid_);
+  // Create the process memory object. A remote process is stopped while it
+  // is unwound, so its memory can be cached for the length of an unwind.
+  if (pid_ == getpid()) {
+    process_memory_ = unwindstack::Memory::CreateProcessMemory(pid_);
+  } else {
+    process_memory_ = unwindstack::Memory::CreateProcessMemoryCached(pid_);
+  }
 
   // Create a JitDebug object for getting jit unwind information.
   std::vector<std::string> search_libs_{"libart.so", "libartd.so"};
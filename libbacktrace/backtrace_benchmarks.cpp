@@ -19,20 +19,30 @@
 #include <stdio.h>
 #include <string.h>
 #include <sys/prctl.h>
+#include <sys/ptrace.h>
 #include <sys/stat.h>
 #include <sys/types.h>
 #include <sys/wait.h>
 #include <unistd.h>
 
+#include <algorithm>
+#include <functional>
+#include <memory>
 #include <string>
+#include <vector>
 
 #include <android-base/file.h>
+#include <android-base/stringprintf.h>
 
 #include <benchmark/benchmark.h>
 
 #include <backtrace/Backtrace.h>
 #include <backtrace/BacktraceMap.h>
+#include <unwindstack/Maps.h>
 #include <unwindstack/Memory.h>
+#include <unwindstack/Regs.h>
+#include <unwindstack/RegsGetLocal.h>
+#include <unwindstack/Unwinder.h>
 
 // Definitions of prctl arguments to set a vma name in Android kernels.
 #define ANDROID_PR_SET_VMA 0x53564d41
@@ -165,4 +175,223 @@ static void BM_create_backtrace(benchmark::State& state) {
 }
 BENCHMARK(BM_create_backtrace);
 
+// Run func with this many frames of CallAtDepth below it.
+constexpr size_t kUnwindDepth = 32;
+constexpr size_t kMaxFrames = 256;
+
+static void __attribute__((noinline)) CallAtDepth(size_t depth, const std::function<void()>& func) {
+  if (depth == 0) {
+    func();
+  } else {
+    CallAtDepth(depth - 1, func);
+  }
+  // Make sure the call above is not turned into a tail call.
+  asm volatile("" ::: "memory");
+}
+
+static void BM_unwindstack_unwind(benchmark::State& state) {
+  unwindstack::LocalMaps maps;
+  if (!maps.Parse()) {
+    state.SkipWithError("Failed to parse local maps.");
+    return;
+  }
+  std::unique_ptr<unwindstack::Regs> regs(unwindstack::Regs::CreateFromLocal());
+  unwindstack::Unwinder unwinder(kMaxFrames, &maps, regs.get(),
+                                 unwindstack::Memory::CreateProcessMemory(getpid()));
+
+  size_t frames = 0;
+  CallAtDepth(kUnwindDepth, [&]() {
+    while (state.KeepRunning()) {
+      unwindstack::RegsGetLocal(regs.get());
+      unwinder.Unwind();
+      frames += unwinder.NumFrames();
+    }
+  });
+  state.SetItemsProcessed(frames);
+}
+BENCHMARK(BM_unwindstack_unwind);
+
+static void BM_unwindstack_unwind_pcs(benchmark::State& state) {
+  unwindstack::LocalMaps maps;
+  if (!maps.Parse()) {
+    state.SkipWithError("Failed to parse local maps.");
+    return;
+  }
+  std::unique_ptr<unwindstack::Regs> regs(unwindstack::Regs::CreateFromLocal());
+  unwindstack::Unwinder unwinder(0, &maps, regs.get(),
+                                 unwindstack::Memory::CreateProcessMemory(getpid()));
+  unwindstack::PcFrameData pc_frames[kMaxFrames];
+
+  size_t frames = 0;
+  CallAtDepth(kUnwindDepth, [&]() {
+    while (state.KeepRunning()) {
+      unwindstack::RegsGetLocal(regs.get());
+      frames += unwinder.UnwindPcs(pc_frames, kMaxFrames);
+    }
+  });
+  state.SetItemsProcessed(frames);
+}
+BENCHMARK(BM_unwindstack_unwind_pcs);
+
+// Symbolize the frames of many samples of the same stack at once.
+static void BM_unwindstack_symbolize_frames(benchmark::State& state) {
+  constexpr size_t kNumSamples = 64;
+  unwindstack::LocalMaps maps;
+  if (!maps.Parse()) {
+    state.SkipWithError("Failed to parse local maps.");
+    return;
+  }
+  std::unique_ptr<unwindstack::Regs> regs(unwindstack::Regs::CreateFromLocal());
+  unwindstack::Unwinder unwinder(0, &maps, regs.get(),
+                                 unwindstack::Memory::CreateProcessMemory(getpid()));
+  std::vector<unwindstack::PcFrameData> pc_frames(kNumSamples * kMaxFrames);
+
+  size_t num_frames = 0;
+  CallAtDepth(kUnwindDepth, [&]() {
+    for (size_t i = 0; i < kNumSamples; i++) {
+      unwindstack::RegsGetLocal(regs.get());
+      num_frames += unwinder.UnwindPcs(&pc_frames[num_frames], kMaxFrames);
+    }
+  });
+
+  std::vector<unwindstack::FrameData> frames;
+  while (state.KeepRunning()) {
+    unwinder.SymbolizeFrames(pc_frames.data(), num_frames, &frames);
+  }
+  state.SetItemsProcessed(state.iterations() * num_frames);
+}
+BENCHMARK(BM_unwindstack_symbolize_frames);
+
+// Counts the syscalls made to read the memory of a stopped child. It reads
+// with process_vm_readv, or a word at a time with ptrace, which is what
+// MemoryRemote falls back to when process_vm_readv is not available.
+class MemoryCountSyscalls : public unwindstack::Memory {
+ public:
+  MemoryCountSyscalls(pid_t pid, bool use_ptrace)
+      : memory_(unwindstack::Memory::CreateProcessMemory(pid)),
+        pid_(pid),
+        use_ptrace_(use_ptrace) {}
+  virtual ~MemoryCountSyscalls() = default;
+
+  size_t Read(uint64_t addr, void* dst, size_t size) override {
+    if (!use_ptrace_) {
+      syscalls_++;
+      return memory_->Read(addr, dst, size);
+    }
+
+    uint64_t end;
+    if (__builtin_add_overflow(addr, size, &end)) {
+      return 0;
+    }
+    uint8_t* out = reinterpret_cast<uint8_t*>(dst);
+    for (uint64_t word = addr & ~(sizeof(long) - 1); word < end; word += sizeof(long)) {
+      syscalls_++;
+      errno = 0;
+      long data = ptrace(PTRACE_PEEKTEXT, pid_, reinterpret_cast<void*>(word), nullptr);
+      if (data == -1 && errno != 0) {
+        return word > addr ? word - addr : 0;
+      }
+      uint64_t start = std::max(word, addr);
+      memcpy(&out[start - addr], reinterpret_cast<uint8_t*>(&data) + start - word,
+             std::min(word + sizeof(long), end) - start);
+    }
+    return size;
+  }
+
+  bool CheapBlockReads() override { return !use_ptrace_ && memory_->CheapBlockReads(); }
+
+  size_t syscalls() { return syscalls_; }
+
+ private:
+  std::shared_ptr<unwindstack::Memory> memory_;
+  pid_t pid_;
+  bool use_ptrace_;
+  size_t syscalls_ = 0;
+};
+
+// Unwind a stopped child, the way crash_dump does, and count how many
+// syscalls are made to read its memory.
+static void RemoteUnwind(benchmark::State& state, bool cached, bool use_ptrace) {
+  int fds[2];
+  if (pipe(fds) == -1) {
+    state.SkipWithError("Failed to create pipe.");
+    return;
+  }
+  pid_t pid = fork();
+  if (pid == 0) {
+    close(fds[0]);
+    CallAtDepth(kUnwindDepth, [&]() {
+      char value = 0;
+      TEMP_FAILURE_RETRY(write(fds[1], &value, sizeof(value)));
+      while (true) {
+        pause();
+      }
+    });
+    _exit(0);
+  }
+  close(fds[1]);
+  char value;
+  bool ready = TEMP_FAILURE_RETRY(read(fds[0], &value, sizeof(value))) == sizeof(value);
+  close(fds[0]);
+  if (pid == -1 || !ready || ptrace(PTRACE_ATTACH, pid, 0, 0) == -1 ||
+      waitpid(pid, nullptr, __WALL) != pid) {
+    state.SkipWithError("Failed to stop the child.");
+    if (pid > 0) {
+      kill(pid, SIGKILL);
+      waitpid(pid, nullptr, 0);
+    }
+    return;
+  }
+
+  unwindstack::RemoteMaps maps(pid);
+  if (maps.Parse()) {
+    auto count_memory = std::make_shared<MemoryCountSyscalls>(pid, use_ptrace);
+    std::shared_ptr<unwindstack::Memory> process_memory(count_memory);
+    if (cached) {
+      process_memory.reset(new unwindstack::MemoryCache(count_memory));
+    }
+
+    size_t frames = 0;
+    while (state.KeepRunning()) {
+      std::unique_ptr<unwindstack::Regs> regs(unwindstack::Regs::RemoteGet(pid));
+      process_memory->ClearCache();
+      unwindstack::Unwinder unwinder(kMaxFrames, &maps, regs.get(), process_memory);
+      unwinder.Unwind();
+      frames += unwinder.NumFrames();
+    }
+    state.SetItemsProcessed(frames);
+    if (state.iterations() != 0) {
+      state.SetLabel(android::base::StringPrintf(
+          "%zu frames, %.1f syscalls/unwind", frames / state.iterations(),
+          static_cast<double>(count_memory->syscalls()) / state.iterations()));
+    }
+  } else {
+    state.SkipWithError("Failed to parse remote maps.");
+  }
+
+  ptrace(PTRACE_DETACH, pid, 0, 0);
+  kill(pid, SIGKILL);
+  waitpid(pid, nullptr, 0);
+}
+
+static void BM_unwindstack_remote_unwind(benchmark::State& state) {
+  RemoteUnwind(state, false, false);
+}
+BENCHMARK(BM_unwindstack_remote_unwind);
+
+static void BM_unwindstack_remote_unwind_cached(benchmark::State& state) {
+  RemoteUnwind(state, true, false);
+}
+BENCHMARK(BM_unwindstack_remote_unwind_cached);
+
+static void BM_unwindstack_remote_unwind_ptrace(benchmark::State& state) {
+  RemoteUnwind(state, false, true);
+}
+BENCHMARK(BM_unwindstack_remote_unwind_ptrace);
+
+static void BM_unwindstack_remote_unwind_ptrace_cached(benchmark::State& state) {
+  RemoteUnwind(state, true, true);
+}
+BENCHMARK(BM_unwindstack_remote_unwind_ptrace_cached);
+
 BENCHMARK_MAIN();
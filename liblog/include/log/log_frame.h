@@ -0,0 +1,72 @@
+/*
+ * Copyright (C) 2018 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _LIBS_LOG_LOG_FRAME_H
+#define _LIBS_LOG_LOG_FRAME_H
+
+#include <stdint.h>
+#include <sys/types.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct log_msg; /* <log/log_read.h> */
+
+/*
+ * Framed binary log stream, as written by logcat --binary=framed.
+ *
+ * The stream is a sequence of records, each an android_log_frame_t header
+ * followed by len bytes of the entry's payload exactly as logd delivered it
+ * (struct log_msg msg()). All fields are little-endian. Every record starts
+ * with ANDROID_LOG_FRAME_MAGIC, so streams can be concatenated, eg: across
+ * rotated files. A reader must skip hdr_size - sizeof(android_log_frame_t)
+ * bytes of fields added by later versions of this format.
+ */
+#define ANDROID_LOG_FRAME_MAGIC 0x464c /* "LF" */
+
+typedef struct __attribute__((__packed__)) {
+  uint16_t magic;    /* ANDROID_LOG_FRAME_MAGIC */
+  uint16_t hdr_size; /* sizeof(android_log_frame_t), or larger */
+  uint16_t len;      /* length of the payload that follows */
+  uint8_t id;        /* log_id_t */
+  uint8_t reserved;  /* zero */
+  int32_t pid;
+  uint32_t tid;
+  uint32_t uid;
+  uint32_t sec;  /* CLOCK_REALTIME, or CLOCK_MONOTONIC if logd uses it */
+  uint32_t nsec;
+} android_log_frame_t;
+
+/*
+ * Fills in the frame header for a log_msg from android_logger_list_read(),
+ * returns the payload length, or -EINVAL if log_msg is not valid.
+ */
+int android_log_frame_header(struct log_msg* log_msg,
+                             android_log_frame_t* frame);
+
+/*
+ * Reads the next record of a framed stream into log_msg as a
+ * logger_entry_v4, returns its len(), 0 at the end of the stream, -EINVAL if
+ * the stream is corrupt, or another negative errno if the read failed.
+ */
+int android_log_frame_read(int fd, struct log_msg* log_msg);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _LIBS_LOG_LOG_FRAME_H */
@@ -81,7 +81,7 @@ AndroidLogPrintFormat android_log_formatFromString(const char* s);
 
 /**
  * filterExpression: a single filter expression
- * eg "AT:d"
+ * eg "AT:d", or "AT*:d" for every tag starting with "AT"
  *
  * returns 0 on success and -1 on invalid expression
  *
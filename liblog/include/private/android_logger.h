@@ -55,6 +55,19 @@ typedef struct __attribute__((__packed__)) {
   log_time realtime;
 } android_log_header_t;
 
+/*
+ * Batched datagram to logd, android_log_header_t.id is LOG_ID_BATCH and
+ * .tid the writer, followed by entries each led by a batch header.
+ */
+#define LOG_ID_BATCH ((typeof_log_id_t)0xFF)
+
+/* Batch Entry Header Structure to logd */
+typedef struct __attribute__((__packed__)) {
+  typeof_log_id_t id;
+  uint16_t len; /* of the payload that follows */
+  log_time realtime;
+} android_log_batch_header_t;
+
 /* Event Header Structure to logd */
 typedef struct __attribute__((__packed__)) {
   int32_t tag;  // Little Endian Order
@@ -150,6 +163,22 @@ bool __android_logger_property_get_bool(const char* key, int flag);
 unsigned long __android_logger_get_buffer_size(log_id_t logId);
 bool __android_logger_valid_buffer_size(unsigned long value);
 
+/*
+ * Ask logd to drop entries android_log_shouldPrintLine() would reject for the
+ * android_log_addFilterString() spec, before they are sent to the reader.
+ * Must be called before the first read.
+ */
+int __android_logger_list_set_filter(struct logger_list* logger_list,
+                                     const char* filterspec);
+
+/*
+ * Stage entries to logd in per-thread buffers and send them in batches, an
+ * entry is delayed at most a few tens of milliseconds. Disabling sends what
+ * is pending. Security, crash and error or higher priority entries are
+ * always sent immediately.
+ */
+int __android_log_set_batching(bool enable);
+
 /* Retrieve the composed event buffer */
 int android_log_write_list_buffer(android_log_context ctx, const char** msg);
 
@@ -0,0 +1,122 @@
+/*
+ * Copyright (C) 2018 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <errno.h>
+#include <stddef.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <log/log_frame.h>
+#include <log/log_read.h>
+
+#include "log_portability.h"
+
+LIBLOG_ABI_PRIVATE int android_log_frame_header(struct log_msg* log_msg,
+                                                android_log_frame_t* frame) {
+  size_t hdr_size = log_msg->entry_v4.hdr_size;
+
+  if (!hdr_size) {
+    hdr_size = sizeof(log_msg->entry_v1);
+  }
+  if ((hdr_size < sizeof(log_msg->entry_v1)) ||
+      (hdr_size > sizeof(log_msg->entry_v4)) ||
+      (log_msg->entry_v1.len > LOGGER_ENTRY_MAX_PAYLOAD)) {
+    return -EINVAL;
+  }
+
+  /* pid, tid, sec and nsec are at the same offset in all versions */
+  frame->magic = ANDROID_LOG_FRAME_MAGIC;
+  frame->hdr_size = sizeof(*frame);
+  frame->len = log_msg->entry_v1.len;
+  frame->id = (hdr_size >= sizeof(log_msg->entry_v3)) ? log_msg->entry_v3.lid
+                                                      : LOG_ID_MAIN;
+  frame->reserved = 0;
+  frame->pid = log_msg->entry_v1.pid;
+  frame->tid = log_msg->entry_v1.tid;
+  frame->uid =
+      (hdr_size >= sizeof(log_msg->entry_v4)) ? log_msg->entry_v4.uid : 0;
+  frame->sec = log_msg->entry_v1.sec;
+  frame->nsec = log_msg->entry_v1.nsec;
+
+  return frame->len;
+}
+
+/* returns len, 0 if at the end of the stream, or negative errno */
+static ssize_t readFully(int fd, void* buf, size_t len) {
+  size_t total = 0;
+
+  while (total < len) {
+    ssize_t ret = TEMP_FAILURE_RETRY(read(fd, (char*)buf + total, len - total));
+    if (ret < 0) {
+      return -errno;
+    }
+    if (!ret) {
+      /* a partial record is as good as a corrupt one */
+      return total ? -EINVAL : 0;
+    }
+    total += ret;
+  }
+  return total;
+}
+
+LIBLOG_ABI_PRIVATE int android_log_frame_read(int fd,
+                                              struct log_msg* log_msg) {
+  android_log_frame_t frame;
+  ssize_t ret;
+
+  ret = readFully(fd, &frame, sizeof(frame));
+  if (ret <= 0) {
+    return ret;
+  }
+  if ((frame.magic != ANDROID_LOG_FRAME_MAGIC) ||
+      (frame.hdr_size < sizeof(frame)) ||
+      (frame.len > LOGGER_ENTRY_MAX_PAYLOAD)) {
+    return -EINVAL;
+  }
+
+  /* skip what a later version added to the header */
+  while (frame.hdr_size > sizeof(frame)) {
+    char skip[64];
+    size_t len = frame.hdr_size - sizeof(frame);
+
+    if (len > sizeof(skip)) {
+      len = sizeof(skip);
+    }
+    ret = readFully(fd, skip, len);
+    if (ret <= 0) {
+      return ret ? ret : -EINVAL;
+    }
+    frame.hdr_size -= len;
+  }
+
+  memset(log_msg, 0, sizeof(log_msg->entry_v4));
+  if (frame.len) {
+    ret = readFully(fd, log_msg->buf + sizeof(log_msg->entry_v4), frame.len);
+    if (ret <= 0) {
+      return ret ? ret : -EINVAL;
+    }
+  }
+  log_msg->entry_v4.len = frame.len;
+  log_msg->entry_v4.hdr_size = sizeof(log_msg->entry_v4);
+  log_msg->entry_v4.pid = frame.pid;
+  log_msg->entry_v4.tid = frame.tid;
+  log_msg->entry_v4.sec = frame.sec;
+  log_msg->entry_v4.nsec = frame.nsec;
+  log_msg->entry_v4.lid = frame.id;
+  log_msg->entry_v4.uid = frame.uid;
+
+  return sizeof(log_msg->entry_v4) + frame.len;
+}
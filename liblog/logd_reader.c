@@ -464,7 +464,7 @@ static int logdOpen(struct android_log_logger_list* logger_list,
   struct sigaction ignore;
   struct sigaction old_sigaction;
   unsigned int old_alarm = 0;
-  char buffer[256], *cp, c;
+  char buffer[1024], *cp, c;
   int e, ret, remaining, sock;
 
   if (!logger_list) {
@@ -534,9 +534,20 @@ static int logdOpen(struct android_log_logger_list* logger_list,
   if (logger_list->pid) {
     ret = snprintf(cp, remaining, " pid=%u", logger_list->pid);
     ret = min(ret, remaining);
+    remaining -= ret;
     cp += ret;
   }
 
+  /* Goes last, a truncated spec could drop what we want, leave it out */
+  if (logger_list->filter) {
+    ret = snprintf(cp, remaining, " filter=%s", logger_list->filter);
+    if ((ret > 0) && (ret < remaining)) {
+      cp += ret;
+    } else {
+      *cp = '\0';
+    }
+  }
+
   if (logger_list->mode & ANDROID_LOG_NONBLOCK) {
     /* Deal with an unresponsive logd */
     memset(&ignore, 0, sizeof(ignore));
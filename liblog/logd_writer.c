@@ -19,6 +19,7 @@
 #include <fcntl.h>
 #include <inttypes.h>
 #include <poll.h>
+#include <pthread.h>
 #include <stdarg.h>
 #include <stdatomic.h>
 #include <stdio.h>
@@ -31,6 +32,7 @@
 #include <time.h>
 #include <unistd.h>
 
+#include <cutils/list.h>
 #include <cutils/sockets.h>
 #include <private/android_filesystem_config.h>
 #include <private/android_logger.h>
@@ -47,6 +49,10 @@ static int logdOpen();
 static void logdClose();
 static int logdWrite(log_id_t logId, struct timespec* ts, struct iovec* vec,
                      size_t nr);
+static void logdBatchFlushAll();
+
+static atomic_int_fast32_t dropped;
+static atomic_int_fast32_t droppedSecurity;
 
 LIBLOG_HIDDEN struct android_log_transport_write logdLoggerWrite = {
   .node = { &logdLoggerWrite.node, &logdLoggerWrite.node },
@@ -108,6 +114,7 @@ static void __logdClose(int negative_errno) {
 }
 
 static void logdClose() {
+  logdBatchFlushAll();
   __logdClose(-EBADF);
 }
 
@@ -124,6 +131,285 @@ static int logdAvailable(log_id_t logId) {
   return 1;
 }
 
+static ssize_t logdSend(int sock, struct iovec* vec, size_t nr) {
+  ssize_t ret;
+
+  /*
+   * The write below could be lost, but will never block.
+   *
+   * ENOTCONN occurs if logd has died.
+   * ENOENT occurs if logd is not running and socket is missing.
+   * ECONNREFUSED occurs if we can not reconnect to logd.
+   * EAGAIN occurs if logd is overloaded.
+   */
+  if (sock < 0) {
+    ret = sock;
+  } else {
+    ret = TEMP_FAILURE_RETRY(writev(sock, vec, nr));
+    if (ret < 0) {
+      ret = -errno;
+    }
+  }
+  switch (ret) {
+    case -ENOTCONN:
+    case -ECONNREFUSED:
+    case -ENOENT:
+      if (__android_log_trylock()) {
+        return ret; /* in a signal handler? try again when less stressed */
+      }
+      __logdClose(ret);
+      ret = logdOpen();
+      __android_log_unlock();
+
+      if (ret < 0) {
+        return ret;
+      }
+
+      ret = TEMP_FAILURE_RETRY(
+          writev(atomic_load(&logdLoggerWrite.context.sock), vec, nr));
+      if (ret < 0) {
+        ret = -errno;
+      }
+    /* FALLTHRU */
+    default:
+      break;
+  }
+
+  return ret;
+}
+
+/*
+ * Batched mode. Entries are staged in a per-thread buffer and sent to logd
+ * as a single LOG_ID_BATCH datagram, once the buffer is full or from the
+ * flusher thread at most LOGD_BATCH_DELAY_MS after the first of them.
+ */
+#define LOGD_BATCH_DELAY_MS 20
+
+struct logd_batch {
+  struct listnode node;
+  pthread_mutex_t lock;
+  size_t len; /* in buf, including the datagram header */
+  size_t count;
+  char buf[sizeof(android_log_header_t) + LOGGER_ENTRY_MAX_PAYLOAD];
+};
+
+static atomic_bool batching;
+static pthread_once_t batchOnce = PTHREAD_ONCE_INIT;
+static pthread_key_t batchKey;
+/* lock order is batchListLock before logd_batch.lock */
+static pthread_mutex_t batchListLock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t batchCond = PTHREAD_COND_INITIALIZER;
+static struct listnode batchList = { &batchList, &batchList };
+static atomic_int batchPending; /* count of non-empty batches */
+static bool batchFlusher;       /* batchListLock */
+
+static void logdBatchReset(struct logd_batch* batch) {
+  batch->len = sizeof(android_log_header_t);
+  batch->count = 0;
+}
+
+/* logd_batch.lock assumed */
+static void logdBatchFlushLocked(struct logd_batch* batch) {
+  struct iovec vec;
+  ssize_t ret;
+
+  if (!batch->count) {
+    return;
+  }
+
+  vec.iov_base = batch->buf;
+  vec.iov_len = batch->len;
+  ret = logdSend(atomic_load(&logdLoggerWrite.context.sock), &vec, 1);
+  if (ret == -EAGAIN) {
+    atomic_fetch_add_explicit(&dropped, batch->count, memory_order_relaxed);
+  }
+
+  logdBatchReset(batch);
+  atomic_fetch_sub(&batchPending, 1);
+}
+
+static void logdBatchFlushAll() {
+  struct listnode* node;
+
+  pthread_mutex_lock(&batchListLock);
+  list_for_each(node, &batchList) {
+    struct logd_batch* batch = node_to_item(node, struct logd_batch, node);
+
+    pthread_mutex_lock(&batch->lock);
+    logdBatchFlushLocked(batch);
+    pthread_mutex_unlock(&batch->lock);
+  }
+  pthread_mutex_unlock(&batchListLock);
+}
+
+static void* logdBatchFlusher(void* arg __unused) {
+  static const struct timespec delay = { 0, LOGD_BATCH_DELAY_MS * 1000000 };
+
+  for (;;) {
+    pthread_mutex_lock(&batchListLock);
+    while (!atomic_load(&batchPending)) {
+      pthread_cond_wait(&batchCond, &batchListLock);
+    }
+    pthread_mutex_unlock(&batchListLock);
+
+    nanosleep(&delay, NULL);
+    logdBatchFlushAll();
+  }
+  return NULL;
+}
+
+static void logdBatchWake() {
+  pthread_mutex_lock(&batchListLock);
+  if (!batchFlusher) {
+    pthread_attr_t attr;
+    pthread_t thread;
+
+    pthread_attr_init(&attr);
+    pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+    batchFlusher = !pthread_create(&thread, &attr, logdBatchFlusher, NULL);
+    pthread_attr_destroy(&attr);
+  }
+  pthread_cond_signal(&batchCond);
+  pthread_mutex_unlock(&batchListLock);
+}
+
+/* thread exit */
+static void logdBatchFree(void* arg) {
+  struct logd_batch* batch = arg;
+
+  pthread_mutex_lock(&batchListLock);
+  pthread_mutex_lock(&batch->lock);
+  logdBatchFlushLocked(batch);
+  pthread_mutex_unlock(&batch->lock);
+  list_remove(&batch->node);
+  pthread_mutex_unlock(&batchListLock);
+
+  pthread_mutex_destroy(&batch->lock);
+  free(batch);
+}
+
+/*
+ * The parent still owns whatever its threads have staged, only the calling
+ * thread survives in the child and it has a new tid.
+ */
+static void logdBatchChild() {
+  struct listnode* node;
+  struct logd_batch* batch;
+
+  pthread_mutex_init(&batchListLock, NULL);
+  pthread_cond_init(&batchCond, NULL);
+  batchFlusher = false;
+  atomic_store(&batchPending, 0);
+  list_for_each(node, &batchList) {
+    batch = node_to_item(node, struct logd_batch, node);
+    pthread_mutex_init(&batch->lock, NULL);
+    logdBatchReset(batch);
+  }
+  batch = pthread_getspecific(batchKey);
+  if (batch) {
+    ((android_log_header_t*)batch->buf)->tid = gettid();
+  }
+}
+
+static void logdBatchInit() {
+  pthread_key_create(&batchKey, logdBatchFree);
+  pthread_atfork(NULL, NULL, logdBatchChild);
+}
+
+static struct logd_batch* logdBatchGet() {
+  struct logd_batch* batch;
+
+  pthread_once(&batchOnce, logdBatchInit);
+  batch = pthread_getspecific(batchKey);
+  if (batch) {
+    return batch;
+  }
+
+  batch = malloc(sizeof(*batch));
+  if (!batch) {
+    return NULL;
+  }
+  pthread_mutex_init(&batch->lock, NULL);
+  logdBatchReset(batch);
+  ((android_log_header_t*)batch->buf)->id = LOG_ID_BATCH;
+  ((android_log_header_t*)batch->buf)->tid = gettid();
+  pthread_setspecific(batchKey, batch);
+
+  pthread_mutex_lock(&batchListLock);
+  list_add_tail(&batchList, &batch->node);
+  pthread_mutex_unlock(&batchListLock);
+
+  return batch;
+}
+
+/*
+ * Returns the payload size if the entry was staged, or 0 if it must be sent
+ * immediately, in which case what the thread had staged before was sent.
+ */
+static ssize_t logdBatch(log_id_t logId, struct timespec* ts,
+                         struct iovec* vec, size_t nr) {
+  android_log_batch_header_t entry;
+  struct logd_batch* batch;
+  size_t i, len;
+  bool urgent, wake = false;
+
+  batch = logdBatchGet();
+  /* in a signal handler, or the flusher is sending it */
+  if (!batch || pthread_mutex_trylock(&batch->lock)) {
+    return 0;
+  }
+
+  for (len = 0, i = 0; i < nr; ++i) {
+    len += vec[i].iov_len;
+  }
+  urgent = (logId == LOG_ID_CRASH) ||
+           ((logId != LOG_ID_EVENTS) && (logId != LOG_ID_STATS) && nr &&
+            vec[0].iov_len &&
+            (*(const char*)vec[0].iov_base >= ANDROID_LOG_ERROR));
+
+  if (urgent || ((batch->len + sizeof(entry) + len) > sizeof(batch->buf))) {
+    logdBatchFlushLocked(batch);
+    if (urgent || ((batch->len + sizeof(entry) + len) > sizeof(batch->buf))) {
+      pthread_mutex_unlock(&batch->lock);
+      return 0;
+    }
+  }
+
+  if (!batch->count) {
+    android_log_header_t* header = (android_log_header_t*)batch->buf;
+
+    header->realtime.tv_sec = ts->tv_sec;
+    header->realtime.tv_nsec = ts->tv_nsec;
+    wake = !atomic_fetch_add(&batchPending, 1);
+  }
+
+  entry.id = logId;
+  entry.len = len;
+  entry.realtime.tv_sec = ts->tv_sec;
+  entry.realtime.tv_nsec = ts->tv_nsec;
+  memcpy(batch->buf + batch->len, &entry, sizeof(entry));
+  batch->len += sizeof(entry);
+  for (i = 0; i < nr; ++i) {
+    memcpy(batch->buf + batch->len, vec[i].iov_base, vec[i].iov_len);
+    batch->len += vec[i].iov_len;
+  }
+  ++batch->count;
+  pthread_mutex_unlock(&batch->lock);
+
+  if (wake) {
+    logdBatchWake();
+  }
+  return len;
+}
+
+LIBLOG_ABI_PRIVATE int __android_log_set_batching(bool enable) {
+  if (!atomic_exchange(&batching, enable) || enable) {
+    return 0;
+  }
+  logdBatchFlushAll();
+  return 0;
+}
+
 static int logdWrite(log_id_t logId, struct timespec* ts, struct iovec* vec,
                      size_t nr) {
   ssize_t ret;
@@ -132,8 +418,6 @@ static int logdWrite(log_id_t logId, struct timespec* ts, struct iovec* vec,
   struct iovec newVec[nr + headerLength];
   android_log_header_t header;
   size_t i, payloadSize;
-  static atomic_int_fast32_t dropped;
-  static atomic_int_fast32_t droppedSecurity;
 
   sock = atomic_load(&logdLoggerWrite.context.sock);
   if (sock < 0) switch (sock) {
@@ -236,46 +520,15 @@ static int logdWrite(log_id_t logId, struct timespec* ts, struct iovec* vec,
     }
   }
 
-  /*
-   * The write below could be lost, but will never block.
-   *
-   * ENOTCONN occurs if logd has died.
-   * ENOENT occurs if logd is not running and socket is missing.
-   * ECONNREFUSED occurs if we can not reconnect to logd.
-   * EAGAIN occurs if logd is overloaded.
-   */
-  if (sock < 0) {
-    ret = sock;
-  } else {
-    ret = TEMP_FAILURE_RETRY(writev(sock, newVec, i));
-    if (ret < 0) {
-      ret = -errno;
+  if ((sock >= 0) && (logId != LOG_ID_SECURITY) &&
+      atomic_load_explicit(&batching, memory_order_relaxed)) {
+    ret = logdBatch(logId, ts, &newVec[headerLength], i - headerLength);
+    if (ret) {
+      return ret;
     }
   }
-  switch (ret) {
-    case -ENOTCONN:
-    case -ECONNREFUSED:
-    case -ENOENT:
-      if (__android_log_trylock()) {
-        return ret; /* in a signal handler? try again when less stressed */
-      }
-      __logdClose(ret);
-      ret = logdOpen();
-      __android_log_unlock();
-
-      if (ret < 0) {
-        return ret;
-      }
 
-      ret = TEMP_FAILURE_RETRY(
-          writev(atomic_load(&logdLoggerWrite.context.sock), newVec, i));
-      if (ret < 0) {
-        ret = -errno;
-      }
-    /* FALLTHRU */
-    default:
-      break;
-  }
+  ret = logdSend(sock, newVec, i);
 
   if (ret > (ssize_t)sizeof(header)) {
     ret -= sizeof(header);
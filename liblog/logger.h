@@ -105,6 +105,7 @@ struct android_log_logger_list {
   unsigned int tail;
   log_time start;
   pid_t pid;
+  char* filter; /* tag and priority filterspec pushed to logd */
 };
 
 struct android_log_logger {
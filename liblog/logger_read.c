@@ -26,6 +26,7 @@
 #include <android/log.h>
 #include <cutils/list.h>
 #include <private/android_filesystem_config.h>
+#include <private/android_logger.h>
 
 #include "config_read.h"
 #include "log_portability.h"
@@ -264,6 +265,26 @@ LIBLOG_ABI_PUBLIC struct logger_list* android_logger_list_alloc_time(
   return (struct logger_list*)logger_list;
 }
 
+LIBLOG_ABI_PRIVATE int __android_logger_list_set_filter(
+    struct logger_list* logger_list, const char* filterspec) {
+  struct android_log_logger_list* logger_list_internal =
+      (struct android_log_logger_list*)logger_list;
+  char* filter = NULL;
+
+  if (!logger_list_internal) {
+    return -EINVAL;
+  }
+  if (filterspec && *filterspec) {
+    filter = strdup(filterspec);
+    if (!filter) {
+      return -ENOMEM;
+    }
+  }
+  free(logger_list_internal->filter);
+  logger_list_internal->filter = filter;
+  return 0;
+}
+
 /* android_logger_list_register unimplemented, no use case */
 /* android_logger_list_unregister unimplemented, no use case */
 
@@ -495,5 +516,6 @@ LIBLOG_ABI_PUBLIC void android_logger_list_free(struct logger_list* logger_list)
     android_logger_free((struct logger*)logger);
   }
 
+  free(logger_list_internal->filter);
   free(logger_list_internal);
 }
@@ -50,13 +50,20 @@
 
 typedef struct FilterInfo_t {
   char* mTag;
+  size_t mLen;
+  uint32_t mHash;
+  unsigned mSeq; /* order added, the last matching rule wins */
   android_LogPriority mPri;
-  struct FilterInfo_t* p_next;
+  struct FilterInfo_t* p_next; /* hash chain, or prefix list */
 } FilterInfo;
 
 struct AndroidLogFormat_t {
   android_LogPriority global_pri;
-  FilterInfo* filters;
+  FilterInfo** filters;      /* "<tag>" rules, hashed by tag */
+  size_t filter_buckets;     /* power of two */
+  size_t filter_count;
+  FilterInfo* prefix_filters; /* "<prefix>*" rules */
+  unsigned filter_seq;
   AndroidLogPrintFormat format;
   bool colored_output;
   bool usec_time_output;
@@ -90,17 +97,113 @@ static bool descriptive_output = false;
 #define ANDROID_COLOR_RED 196
 #define ANDROID_COLOR_YELLOW 226
 
-static FilterInfo* filterinfo_new(const char* tag, android_LogPriority pri) {
+/* FNV-1a */
+static uint32_t filterHash(const char* tag, size_t len) {
+  uint32_t hash = 2166136261U;
+
+  while (len--) {
+    hash ^= (unsigned char)*tag++;
+    hash *= 16777619U;
+  }
+  return hash;
+}
+
+static FilterInfo* filterinfo_new(const char* tag, size_t len,
+                                  android_LogPriority pri) {
   FilterInfo* p_ret;
 
   p_ret = (FilterInfo*)calloc(1, sizeof(FilterInfo));
-  p_ret->mTag = strdup(tag);
+  if (!p_ret) {
+    return NULL;
+  }
+  p_ret->mTag = malloc(len + 1);
+  if (!p_ret->mTag) {
+    free(p_ret);
+    return NULL;
+  }
+  memcpy(p_ret->mTag, tag, len);
+  p_ret->mTag[len] = '\0';
+  p_ret->mLen = len;
+  p_ret->mHash = filterHash(tag, len);
   p_ret->mPri = pri;
 
   return p_ret;
 }
 
-/* balance to above, filterinfo_free left unimplemented */
+static void filterinfo_free(FilterInfo* p_info) {
+  free(p_info->mTag);
+  free(p_info);
+}
+
+/* Double the hash table once it is three quarters full */
+static int filterGrow(AndroidLogFormat* p_format) {
+  size_t buckets, i;
+  FilterInfo** filters;
+
+  if ((p_format->filter_count * 4) < (p_format->filter_buckets * 3)) {
+    return 0;
+  }
+
+  buckets = p_format->filter_buckets ? (p_format->filter_buckets * 2) : 16;
+  filters = (FilterInfo**)calloc(buckets, sizeof(FilterInfo*));
+  if (!filters) {
+    return -1;
+  }
+  for (i = 0; i < p_format->filter_buckets; ++i) {
+    FilterInfo* p_info = p_format->filters[i];
+    while (p_info) {
+      FilterInfo* p_next = p_info->p_next;
+      FilterInfo** pp_head = &filters[p_info->mHash & (buckets - 1)];
+
+      p_info->p_next = *pp_head;
+      *pp_head = p_info;
+      p_info = p_next;
+    }
+  }
+  free(p_format->filters);
+  p_format->filters = filters;
+  p_format->filter_buckets = buckets;
+  return 0;
+}
+
+/* Adds or replaces the rule for tag, or for a prefix of tags */
+static int filterAdd(AndroidLogFormat* p_format, const char* tag, size_t len,
+                     bool prefix, android_LogPriority pri) {
+  FilterInfo** pp_head;
+  FilterInfo* p_info;
+  uint32_t hash = filterHash(tag, len);
+
+  if (prefix) {
+    pp_head = &p_format->prefix_filters;
+  } else {
+    if (filterGrow(p_format)) {
+      return -1;
+    }
+    pp_head = &p_format->filters[hash & (p_format->filter_buckets - 1)];
+  }
+
+  for (p_info = *pp_head; p_info; p_info = p_info->p_next) {
+    if ((p_info->mHash == hash) && (p_info->mLen == len) &&
+        !memcmp(p_info->mTag, tag, len)) {
+      break;
+    }
+  }
+  if (!p_info) {
+    p_info = filterinfo_new(tag, len, pri);
+    if (!p_info) {
+      return -1;
+    }
+    p_info->p_next = *pp_head;
+    *pp_head = p_info;
+    if (!prefix) {
+      ++p_format->filter_count;
+    }
+  }
+  p_info->mPri = pri;
+  p_info->mSeq = ++p_format->filter_seq;
+
+  return 0;
+}
 
 /*
  * Note: also accepts 0-9 priorities
@@ -178,20 +281,36 @@ static int colorFromPri(android_LogPriority pri) {
 
 static android_LogPriority filterPriForTag(AndroidLogFormat* p_format,
                                            const char* tag) {
+  FilterInfo* p_match = NULL;
   FilterInfo* p_curFilter;
 
-  for (p_curFilter = p_format->filters; p_curFilter != NULL;
-       p_curFilter = p_curFilter->p_next) {
-    if (0 == strcmp(tag, p_curFilter->mTag)) {
-      if (p_curFilter->mPri == ANDROID_LOG_DEFAULT) {
-        return p_format->global_pri;
-      } else {
-        return p_curFilter->mPri;
+  if (p_format->filter_count) {
+    size_t len = strlen(tag);
+    uint32_t hash = filterHash(tag, len);
+
+    for (p_curFilter =
+             p_format->filters[hash & (p_format->filter_buckets - 1)];
+         p_curFilter != NULL; p_curFilter = p_curFilter->p_next) {
+      if ((p_curFilter->mHash == hash) && (p_curFilter->mLen == len) &&
+          (0 == memcmp(tag, p_curFilter->mTag, len))) {
+        p_match = p_curFilter;
+        break;
       }
     }
   }
 
-  return p_format->global_pri;
+  for (p_curFilter = p_format->prefix_filters; p_curFilter != NULL;
+       p_curFilter = p_curFilter->p_next) {
+    if ((!p_match || (p_curFilter->mSeq > p_match->mSeq)) &&
+        (0 == strncmp(tag, p_curFilter->mTag, p_curFilter->mLen))) {
+      p_match = p_curFilter;
+    }
+  }
+
+  if (!p_match || (p_match->mPri == ANDROID_LOG_DEFAULT)) {
+    return p_format->global_pri;
+  }
+  return p_match->mPri;
 }
 
 /**
@@ -234,14 +353,27 @@ static list_declare(convertHead);
 
 LIBLOG_ABI_PUBLIC void android_log_format_free(AndroidLogFormat* p_format) {
   FilterInfo *p_info, *p_info_old;
+  size_t i;
+
+  for (i = 0; i < p_format->filter_buckets; ++i) {
+    p_info = p_format->filters[i];
+
+    while (p_info != NULL) {
+      p_info_old = p_info;
+      p_info = p_info->p_next;
+
+      filterinfo_free(p_info_old);
+    }
+  }
+  free(p_format->filters);
 
-  p_info = p_format->filters;
+  p_info = p_format->prefix_filters;
 
   while (p_info != NULL) {
     p_info_old = p_info;
     p_info = p_info->p_next;
 
-    free(p_info_old);
+    filterinfo_free(p_info_old);
   }
 
   free(p_format);
@@ -366,7 +498,7 @@ android_log_formatFromString(const char* formatString) {
 
 /**
  * filterExpression: a single filter expression
- * eg "AT:d"
+ * eg "AT:d", or "AT*:d" for every tag starting with "AT"
  *
  * returns 0 on success and -1 on invalid expression
  *
@@ -412,25 +544,14 @@ LIBLOG_ABI_PUBLIC int android_log_addFilterRule(AndroidLogFormat* p_format,
       pri = ANDROID_LOG_VERBOSE;
     }
 
-    char* tagName;
+    /* "<prefix>*" matches every tag starting with <prefix> */
+    bool prefix = (tagNameLength > 1) &&
+                  (filterExpression[tagNameLength - 1] == '*');
 
-/*
- * Presently HAVE_STRNDUP is never defined, so the second case is always taken
- * Darwin doesn't have strndup, everything else does
- */
-#ifdef HAVE_STRNDUP
-    tagName = strndup(filterExpression, tagNameLength);
-#else
-    /* a few extra bytes copied... */
-    tagName = strdup(filterExpression);
-    tagName[tagNameLength] = '\0';
-#endif /*HAVE_STRNDUP*/
-
-    FilterInfo* p_fi = filterinfo_new(tagName, pri);
-    free(tagName);
-
-    p_fi->p_next = p_format->filters;
-    p_format->filters = p_fi;
+    if (filterAdd(p_format, filterExpression, tagNameLength - prefix, prefix,
+                  pri)) {
+      goto error;
+    }
   }
 
   return 0;
@@ -16,6 +16,7 @@
 
 #include <ctype.h>
 #include <pthread.h>
+#include <stdatomic.h>
 #include <stdbool.h>
 #include <stdlib.h>
 #include <string.h>
@@ -88,6 +89,116 @@ static void refresh_cache(struct cache_char* cache, const char* key) {
   }
 }
 
+/*
+ * Multi-entry cache of the property character resolved for each tag, checked
+ * without the lock before __android_log_level goes to the properties. Any
+ * property change bumps __system_property_area_serial(), which invalidates
+ * every entry at once. Each entry is guarded by a sequence count that is odd
+ * while it is being updated, updates are made with lock_loggable held.
+ */
+#define TAG_CACHE_SETS 64 /* power of two */
+#define TAG_CACHE_WAYS 2
+#define TAG_CACHE_TAG_MAX 32
+
+struct tag_cache_entry {
+  atomic_uint_fast32_t seq; /* 0 if never used */
+  uint32_t serial;
+  uint32_t hash;
+  uint16_t len;
+  unsigned char c;
+  char tag[TAG_CACHE_TAG_MAX];
+};
+
+static struct tag_cache_entry tag_cache_sets[TAG_CACHE_SETS][TAG_CACHE_WAYS];
+
+static uint32_t tag_cache_hash(const char* tag, size_t len) {
+  uint32_t hash = 2166136261U; /* FNV-1a */
+
+  while (len--) {
+    hash = (hash ^ (unsigned char)*tag++) * 16777619U;
+  }
+  return hash;
+}
+
+/* returns the cached character, or -1 if not cached for this serial */
+static int tag_cache_find(uint32_t serial, uint32_t hash, const char* tag,
+                          size_t len) {
+  struct tag_cache_entry* set = tag_cache_sets[hash & (TAG_CACHE_SETS - 1)];
+  size_t i;
+
+  for (i = 0; i < TAG_CACHE_WAYS; ++i) {
+    struct tag_cache_entry* e = &set[i];
+    uint_fast32_t seq = atomic_load_explicit(&e->seq, memory_order_acquire);
+    unsigned char c;
+
+    if (!seq || (seq & 1) || (e->serial != serial) || (e->hash != hash) ||
+        (e->len != len) || memcmp(e->tag, tag, len)) {
+      continue;
+    }
+    c = e->c;
+    atomic_thread_fence(memory_order_acquire);
+    if (atomic_load_explicit(&e->seq, memory_order_relaxed) == seq) {
+      return c;
+    }
+  }
+  return -1;
+}
+
+/* lock_loggable must be held */
+static void tag_cache_add(uint32_t serial, uint32_t hash, const char* tag,
+                          size_t len, unsigned char c) {
+  static unsigned victim;
+  struct tag_cache_entry* set = tag_cache_sets[hash & (TAG_CACHE_SETS - 1)];
+  struct tag_cache_entry* e = NULL;
+  uint_fast32_t seq;
+  size_t i;
+
+  /* prefer the stale entry for this tag, then an unused or stale one */
+  for (i = 0; i < TAG_CACHE_WAYS; ++i) {
+    if ((set[i].hash == hash) && (set[i].len == len) &&
+        !memcmp(set[i].tag, tag, len)) {
+      e = &set[i];
+      break;
+    }
+  }
+  for (i = 0; !e && (i < TAG_CACHE_WAYS); ++i) {
+    if (!atomic_load_explicit(&set[i].seq, memory_order_relaxed) ||
+        (set[i].serial != serial)) {
+      e = &set[i];
+    }
+  }
+  if (!e) {
+    e = &set[victim++ % TAG_CACHE_WAYS];
+  }
+
+  seq = atomic_load_explicit(&e->seq, memory_order_relaxed);
+  atomic_store_explicit(&e->seq, seq + 1, memory_order_relaxed);
+  atomic_thread_fence(memory_order_release);
+  e->serial = serial;
+  e->hash = hash;
+  e->len = len;
+  e->c = c;
+  memcpy(e->tag, tag, len);
+  atomic_store_explicit(&e->seq, seq + 2, memory_order_release);
+}
+
+static int __android_log_level_of(char c, int default_prio) {
+  switch (toupper(c)) {
+    /* clang-format off */
+    case 'V': return ANDROID_LOG_VERBOSE;
+    case 'D': return ANDROID_LOG_DEBUG;
+    case 'I': return ANDROID_LOG_INFO;
+    case 'W': return ANDROID_LOG_WARN;
+    case 'E': return ANDROID_LOG_ERROR;
+    case 'F': /* FALLTHRU */ /* Not officially supported */
+    case 'A': return ANDROID_LOG_FATAL;
+    case BOOLEAN_FALSE: /* FALLTHRU */ /* Not Officially supported */
+    case 'S': return -1; /* ANDROID_LOG_SUPPRESS */
+    /* clang-format on */
+  }
+  return default_prio;
+}
+
 static int __android_log_level(const char* tag, size_t len, int default_prio) {
   /* sizeof() is used on this array below */
   static const char log_namespace[] = "persist.log.tag.";
@@ -100,7 +211,8 @@ static int __android_log_level(const char* tag, size_t len, int default_prio) {
   size_t i;
   char c = 0;
   /*
-   * Single layer cache of four properties. Priorities are:
+   * Behind tag_cache_sets, a single layer cache of four properties.
+   * Priorities are:
    *    log.tag.<tag>
    *    persist.log.tag.<tag>
    *    log.tag
@@ -118,6 +230,18 @@ static int __android_log_level(const char* tag, size_t len, int default_prio) {
   int change_detected;
   int global_change_detected;
   int not_locked;
+  const bool cacheable = taglen <= TAG_CACHE_TAG_MAX;
+  uint32_t hash = 0;
+
+  if (cacheable) {
+    int cached;
+
+    hash = tag_cache_hash(tag, taglen);
+    cached = tag_cache_find(__system_property_area_serial(), hash, tag, taglen);
+    if (cached >= 0) {
+      return __android_log_level_of(cached, default_prio);
+    }
+  }
 
   strcpy(key, log_namespace);
 
@@ -244,23 +368,13 @@ static int __android_log_level(const char* tag, size_t len, int default_prio) {
 
   if (!not_locked) {
     global_serial = current_global_serial;
+    if (cacheable) {
+      tag_cache_add(current_global_serial, hash, tag, taglen, c);
+    }
     unlock();
   }
 
-  switch (toupper(c)) {
-    /* clang-format off */
-    case 'V': return ANDROID_LOG_VERBOSE;
-    case 'D': return ANDROID_LOG_DEBUG;
-    case 'I': return ANDROID_LOG_INFO;
-    case 'W': return ANDROID_LOG_WARN;
-    case 'E': return ANDROID_LOG_ERROR;
-    case 'F': /* FALLTHRU */ /* Not officially supported */
-    case 'A': return ANDROID_LOG_FATAL;
-    case BOOLEAN_FALSE: /* FALLTHRU */ /* Not Officially supported */
-    case 'S': return -1; /* ANDROID_LOG_SUPPRESS */
-    /* clang-format on */
-  }
-  return default_prio;
+  return __android_log_level_of(c, default_prio);
 }
 
 LIBLOG_ABI_PUBLIC int __android_log_is_loggable_len(int prio, const char* tag,
@@ -69,6 +69,7 @@ cts_src_files := \
 
 test_src_files := \
     $(cts_src_files) \
+    log_frame_test.cpp \
 
 # Build tests for the device (with .so). Run with:
 #   adb shell /data/nativetest/liblog-unit-tests/liblog-unit-tests
@@ -22,12 +22,17 @@
 #include <sys/types.h>
 #include <unistd.h>
 
+#include <string>
+#include <thread>
 #include <unordered_set>
+#include <vector>
 
 #include <android-base/file.h>
+#include <android-base/stringprintf.h>
 #include <cutils/sockets.h>
 #include <log/event_tag_map.h>
 #include <log/log_transport.h>
+#include <log/logprint.h>
 #include <private/android_logger.h>
 
 #include "benchmark.h"
@@ -79,6 +84,27 @@ static void BM_log_maximum(int iters) {
 }
 BENCHMARK(BM_log_maximum);
 
+/*
+ *	Measure the fastest rate we can stuff long print messages into the log
+ * at high pressure, logd ingest throughput is reported in MB/s.
+ */
+static void BM_log_maximum_long(int iters) {
+  char buf[LOGGER_ENTRY_MAX_PAYLOAD / 4];
+  memset(buf, 'x', sizeof(buf) - 1);
+  buf[sizeof(buf) - 1] = '\0';
+
+  StartBenchmarkTiming();
+
+  for (int i = 0; i < iters; ++i) {
+    LOG_FAILURE_RETRY(
+        __android_log_write(ANDROID_LOG_INFO, "BM_log_maximum_long", buf));
+  }
+
+  StopBenchmarkTiming();
+  SetBenchmarkBytesProcessed(static_cast<uint64_t>(iters) * sizeof(buf));
+}
+BENCHMARK(BM_log_maximum_long);
+
 static void set_log_null() {
   android_set_log_transport(LOGGER_NULL);
 }
@@ -94,6 +120,43 @@ static void BM_log_maximum_null(int iters) {
 }
 BENCHMARK(BM_log_maximum_null);
 
+/*
+ *	Measure the aggregate rate at which several writer threads can stuff
+ * print messages into the log, one message per datagram or staged in
+ * per-thread buffers and sent to logd in batches.
+ */
+static void log_maximum_threads(int iters, int threads, bool batched) {
+  std::vector<std::thread> writers;
+
+  __android_log_set_batching(batched);
+  StartBenchmarkTiming();
+
+  for (int t = 0; t < threads; ++t) {
+    writers.emplace_back([iters, threads, t]() {
+      for (int i = t; i < iters; i += threads) {
+        __android_log_print(ANDROID_LOG_INFO, "BM_log_maximum_threads", "%d",
+                            i);
+      }
+    });
+  }
+  for (auto& writer : writers) {
+    writer.join();
+  }
+  __android_log_set_batching(false);  // includes the last batches
+
+  StopBenchmarkTiming();
+}
+
+static void BM_log_maximum_threads(int iters, int threads) {
+  log_maximum_threads(iters, threads, false);
+}
+BENCHMARK(BM_log_maximum_threads)->Arg(1)->Arg(4)->Arg(16);
+
+static void BM_log_maximum_threads_batched(int iters, int threads) {
+  log_maximum_threads(iters, threads, true);
+}
+BENCHMARK(BM_log_maximum_threads_batched)->Arg(1)->Arg(4)->Arg(16);
+
 /*
  *	Measure the time it takes to collect the time using
  * discrete acquisition (StartBenchmarkTiming() -> StopBenchmarkTiming())
@@ -772,6 +835,64 @@ static void BM_is_loggable(int iters) {
 }
 BENCHMARK(BM_is_loggable);
 
+/*
+ *	Measure the time it takes for __android_log_is_loggable when the process
+ * rotates through tags distinct tags, expect this to stay flat as long as
+ * they all fit in the loggable tag cache.
+ */
+static void BM_is_loggable_tags(int iters, int tags) {
+  std::vector<std::string> names;
+
+  for (int i = 0; i < tags; ++i) {
+    names.push_back(android::base::StringPrintf("BM_tag_%d", i));
+  }
+
+  StartBenchmarkTiming();
+
+  for (int i = 0; i < iters; ++i) {
+    const std::string& name = names[i % names.size()];
+    __android_log_is_loggable_len(ANDROID_LOG_WARN, name.c_str(), name.length(),
+                                  ANDROID_LOG_VERBOSE);
+  }
+
+  StopBenchmarkTiming();
+}
+BENCHMARK(BM_is_loggable_tags)->Arg(1)->Arg(4)->Arg(16)->Arg(64)->Arg(256);
+
+/*
+ *	Measure the lines per second android_log_shouldPrintLine can decide on
+ * with rules filterspec rules, a quarter of them prefix rules. Expect this to
+ * stay flat as the number of rules grows.
+ */
+static void BM_log_shouldPrintLine(int iters, int rules) {
+  AndroidLogFormat* p_format = android_log_format_new();
+  std::vector<std::string> tags;
+
+  android_log_addFilterRule(p_format, "*:s");
+  for (int i = 0; i < rules; ++i) {
+    std::string rule = android::base::StringPrintf(
+        (i % 4) ? "BM_tag_%d:i" : "BM_prefix_%d*:w", i);
+    android_log_addFilterRule(p_format, rule.c_str());
+  }
+  // half hit a rule, half fall through to the default
+  for (int i = 0; i < 64; ++i) {
+    tags.push_back(android::base::StringPrintf(
+        (i % 2) ? "BM_tag_%d" : "BM_miss_%d", (i * 7) % rules));
+  }
+
+  StartBenchmarkTiming();
+
+  for (int i = 0; i < iters; ++i) {
+    android_log_shouldPrintLine(p_format, tags[i % tags.size()].c_str(),
+                                ANDROID_LOG_INFO);
+  }
+
+  StopBenchmarkTiming();
+
+  android_log_format_free(p_format);
+}
+BENCHMARK(BM_log_shouldPrintLine)->Arg(1)->Arg(16)->Arg(64)->Arg(256);
+
 /*
  *	Measure the time it takes for android_log_clockid.
  */
@@ -268,6 +268,65 @@ TEST(liblog, __android_log_btwrite__android_logger_list_read) {
 #endif
 }
 
+TEST(liblog, __android_log_set_batching) {
+#if (defined(__ANDROID__) && defined(USING_LOGGER_DEFAULT))
+  struct logger_list* logger_list;
+
+  pid_t pid = getpid();
+
+  ASSERT_TRUE(NULL !=
+              (logger_list = android_logger_list_open(
+                   LOG_ID_EVENTS, ANDROID_LOG_RDONLY | ANDROID_LOG_NONBLOCK,
+                   1000, pid)));
+
+  // More than fit in one batch, the last ones are sent when disabled.
+  static const size_t num = 256;
+  log_time ts(CLOCK_MONOTONIC);
+  EXPECT_EQ(0, __android_log_set_batching(true));
+  for (size_t i = 0; i < num; ++i) {
+    log_time tx(ts.tv_sec, ts.tv_nsec + i);
+    EXPECT_LT(0, __android_log_btwrite(0, EVENT_TYPE_LONG, &tx, sizeof(tx)));
+  }
+  EXPECT_EQ(0, __android_log_set_batching(false));
+  usleep(1000000);
+
+  size_t count = 0;
+  for (;;) {
+    log_msg log_msg;
+    if (android_logger_list_read(logger_list, &log_msg) <= 0) {
+      break;
+    }
+
+    EXPECT_EQ(log_msg.entry.pid, pid);
+
+    if ((log_msg.entry.len != sizeof(android_log_event_long_t)) ||
+        (log_msg.id() != LOG_ID_EVENTS)) {
+      continue;
+    }
+
+    android_log_event_long_t* eventData;
+    eventData = reinterpret_cast<android_log_event_long_t*>(log_msg.msg());
+
+    if (!eventData || (eventData->payload.type != EVENT_TYPE_LONG)) {
+      continue;
+    }
+
+    // split back apart in order, with the tid of the writer
+    log_time tx(reinterpret_cast<char*>(&eventData->payload.data));
+    if (tx == log_time(ts.tv_sec, ts.tv_nsec + count)) {
+      EXPECT_EQ(log_msg.entry.tid, gettid());
+      ++count;
+    }
+  }
+
+  EXPECT_EQ(num, count);
+
+  android_logger_list_close(logger_list);
+#else
+  GTEST_LOG_(INFO) << "This test does nothing.\n";
+#endif
+}
+
 #if (defined(__ANDROID__) || defined(USING_LOGGER_LOCAL))
 static void print_transport(const char* prefix, int logger) {
   static const char orstr[] = " | ";
@@ -1419,6 +1478,18 @@ TEST(liblog, filterRule) {
 
   EXPECT_TRUE(android_log_addFilterString(p_format, "*:s random:z") < 0);
 
+  // prefix rules, the last rule matching a tag wins
+  EXPECT_TRUE(android_log_addFilterString(p_format, "ran*:e") == 0);
+  EXPECT_TRUE(checkPriForTag(p_format, tag, ANDROID_LOG_ERROR));
+  EXPECT_TRUE(checkPriForTag(p_format, "rand", ANDROID_LOG_ERROR));
+  EXPECT_TRUE(checkPriForTag(p_format, "ra", ANDROID_LOG_SILENT));
+  EXPECT_TRUE(android_log_addFilterString(p_format, "random:i") == 0);
+  EXPECT_TRUE(checkPriForTag(p_format, tag, ANDROID_LOG_INFO));
+  EXPECT_TRUE(checkPriForTag(p_format, "rand", ANDROID_LOG_ERROR));
+  EXPECT_TRUE(android_log_addFilterString(p_format, "rand*:w") == 0);
+  EXPECT_TRUE(checkPriForTag(p_format, tag, ANDROID_LOG_WARN));
+  EXPECT_TRUE(checkPriForTag(p_format, "ranch", ANDROID_LOG_ERROR));
+
 #if 0  // bitrot, seek update
     char defaultBuffer[512];
 
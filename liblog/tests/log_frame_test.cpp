@@ -0,0 +1,99 @@
+/*
+ * Copyright (C) 2018 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <gtest/gtest.h>
+#include <log/log_frame.h>
+#include <log/log_read.h>
+
+static void fill_log_msg(log_msg& msg, log_id_t id, const char* payload,
+                         size_t len) {
+  memset(&msg, 0, sizeof(msg));
+  msg.entry_v4.len = len;
+  msg.entry_v4.hdr_size = sizeof(msg.entry_v4);
+  msg.entry_v4.pid = 1;
+  msg.entry_v4.tid = 2;
+  msg.entry_v4.sec = 3;
+  msg.entry_v4.nsec = 4;
+  msg.entry_v4.lid = id;
+  msg.entry_v4.uid = 5;
+  memcpy(msg.msg(), payload, len);
+}
+
+static void write_frame(int fd, log_msg& msg) {
+  android_log_frame_t frame;
+  int len = android_log_frame_header(&msg, &frame);
+  ASSERT_LE(0, len);
+  ASSERT_EQ(static_cast<ssize_t>(sizeof(frame)),
+            write(fd, &frame, sizeof(frame)));
+  ASSERT_EQ(len, write(fd, msg.msg(), len));
+}
+
+TEST(liblog, android_log_frame_read) {
+  static const char text[] = "\4tag\0message";
+  static const char binary[] = { 42, 0, 0, 0, 0, 1, 2, 3, 4 };
+
+  int fds[2];
+  ASSERT_EQ(0, pipe(fds));
+
+  log_msg msg;
+  fill_log_msg(msg, LOG_ID_MAIN, text, sizeof(text));
+  write_frame(fds[1], msg);
+  fill_log_msg(msg, LOG_ID_EVENTS, binary, sizeof(binary));
+  write_frame(fds[1], msg);
+  close(fds[1]);
+
+  log_msg out;
+  EXPECT_EQ(static_cast<int>(sizeof(out.entry_v4) + sizeof(text)),
+            android_log_frame_read(fds[0], &out));
+  EXPECT_EQ(LOG_ID_MAIN, out.id());
+  EXPECT_EQ(sizeof(text), out.entry_v4.len);
+  EXPECT_EQ(1, out.entry_v4.pid);
+  EXPECT_EQ(2U, out.entry_v4.tid);
+  EXPECT_EQ(3U, out.entry_v4.sec);
+  EXPECT_EQ(4U, out.entry_v4.nsec);
+  EXPECT_EQ(5U, out.entry_v4.uid);
+  EXPECT_EQ(0, memcmp(text, out.msg(), sizeof(text)));
+
+  EXPECT_EQ(static_cast<int>(sizeof(out.entry_v4) + sizeof(binary)),
+            android_log_frame_read(fds[0], &out));
+  EXPECT_EQ(LOG_ID_EVENTS, out.id());
+  EXPECT_EQ(0, memcmp(binary, out.msg(), sizeof(binary)));
+
+  EXPECT_EQ(0, android_log_frame_read(fds[0], &out));
+  close(fds[0]);
+}
+
+TEST(liblog, android_log_frame_read__corrupt) {
+  int fds[2];
+  ASSERT_EQ(0, pipe(fds));
+
+  log_msg msg;
+  fill_log_msg(msg, LOG_ID_MAIN, "\4a\0b", 5);
+  android_log_frame_t frame;
+  ASSERT_EQ(5, android_log_frame_header(&msg, &frame));
+  frame.magic = ~ANDROID_LOG_FRAME_MAGIC;
+  ASSERT_EQ(static_cast<ssize_t>(sizeof(frame)),
+            write(fds[1], &frame, sizeof(frame)));
+  close(fds[1]);
+
+  log_msg out;
+  EXPECT_EQ(-EINVAL, android_log_frame_read(fds[0], &out));
+  close(fds[0]);
+}
@@ -16,6 +16,8 @@
 
 #include <assert.h>
 #include <errno.h>
+#include <limits.h>
+#include <stdbool.h>
 #include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
@@ -27,6 +29,7 @@ struct backed_block {
 	unsigned int block;
 	unsigned int len;
 	enum backed_block_type type;
+	bool indexed;
 	union {
 		struct {
 			void *data;
@@ -46,10 +49,20 @@ struct backed_block {
 	struct backed_block *next;
 };
 
+/* Blocks are placed by a binary search of every INDEX_STRIDE'th block of the
+ * list, rather than by walking the list from the start. The index is thrown
+ * away, to be built again, when the list has grown enough between its entries
+ * that a walk gets long. */
+#define INDEX_STRIDE 16
+#define INDEX_MAX_WALK (4 * INDEX_STRIDE)
+
 struct backed_block_list {
 	struct backed_block *data_blocks;
 	struct backed_block *last_used;
 	unsigned int block_size;
+
+	struct backed_block **index;
+	unsigned int index_len;
 };
 
 struct backed_block *backed_block_iter_new(struct backed_block_list *bbl)
@@ -127,6 +140,94 @@ struct backed_block_list *backed_block_list_new(unsigned int block_size)
 	return b;
 }
 
+static void index_clear(struct backed_block_list *bbl)
+{
+	unsigned int i;
+
+	for (i = 0; i < bbl->index_len; i++) {
+		bbl->index[i]->indexed = false;
+	}
+	free(bbl->index);
+	bbl->index = NULL;
+	bbl->index_len = 0;
+}
+
+static void index_build(struct backed_block_list *bbl)
+{
+	struct backed_block *bb;
+	unsigned int count = 0;
+	unsigned int i = 0;
+
+	for (bb = bbl->data_blocks; bb; bb = bb->next) {
+		count++;
+	}
+
+	bbl->index = malloc(sizeof(*bbl->index) * (count / INDEX_STRIDE + 1));
+	if (!bbl->index) {
+		return;
+	}
+	for (bb = bbl->data_blocks; bb; bb = bb->next) {
+		if (i++ % INDEX_STRIDE == 0) {
+			bb->indexed = true;
+			bbl->index[bbl->index_len++] = bb;
+		}
+	}
+}
+
+/* Returns the last indexed block before block, or the head of the list. */
+static struct backed_block *index_find(struct backed_block_list *bbl,
+		unsigned int block)
+{
+	unsigned int lo = 0;
+	unsigned int hi;
+
+	if (!bbl->index) {
+		index_build(bbl);
+	}
+
+	hi = bbl->index_len;
+	while (lo < hi) {
+		unsigned int mid = lo + (hi - lo) / 2;
+		if (bbl->index[mid]->block < block) {
+			lo = mid + 1;
+		} else {
+			hi = mid;
+		}
+	}
+	return lo ? bbl->index[lo - 1] : bbl->data_blocks;
+}
+
+/* Points the index entry for old, which is being freed, at new instead. */
+static void index_replace(struct backed_block_list *bbl,
+		struct backed_block *old, struct backed_block *new)
+{
+	unsigned int lo = 0;
+	unsigned int hi = bbl->index_len;
+
+	while (lo < hi) {
+		unsigned int mid = lo + (hi - lo) / 2;
+		if (bbl->index[mid]->block < old->block) {
+			lo = mid + 1;
+		} else {
+			hi = mid;
+		}
+	}
+	if (lo == bbl->index_len || bbl->index[lo] != old) {
+		index_clear(bbl);
+		return;
+	}
+
+	if (new->indexed) {
+		memmove(&bbl->index[lo], &bbl->index[lo + 1],
+				sizeof(*bbl->index) * (bbl->index_len - lo - 1));
+		bbl->index_len--;
+	} else {
+		new->indexed = true;
+		bbl->index[lo] = new;
+	}
+	old->indexed = false;
+}
+
 void backed_block_list_destroy(struct backed_block_list *bbl)
 {
 	if (bbl->data_blocks) {
@@ -138,9 +239,27 @@ void backed_block_list_destroy(struct backed_block_list *bbl)
 		}
 	}
 
+	free(bbl->index);
 	free(bbl);
 }
 
+void backed_block_list_destroy_first(struct backed_block_list *bbl)
+{
+	struct backed_block *bb = bbl->data_blocks;
+
+	if (!bb) {
+		return;
+	}
+	if (bb->indexed) {
+		index_clear(bbl);
+	}
+	if (bbl->last_used == bb) {
+		bbl->last_used = NULL;
+	}
+	bbl->data_blocks = bb->next;
+	backed_block_destroy(bb);
+}
+
 void backed_block_list_move(struct backed_block_list *from,
 		struct backed_block_list *to, struct backed_block *start,
 		struct backed_block *end)
@@ -162,6 +281,8 @@ void backed_block_list_move(struct backed_block_list *from,
 
 	from->last_used = NULL;
 	to->last_used = NULL;
+	index_clear(from);
+	index_clear(to);
 	if (from->data_blocks == start) {
 		from->data_blocks = end->next;
 	} else {
@@ -211,6 +332,11 @@ static int merge_bb(struct backed_block_list *bbl,
 		return -EINVAL;
 	}
 
+	/* Keep the length, and the chunk it is written as, well within 32 bits */
+	if (a->len > UINT_MAX / 2 || b->len > UINT_MAX / 2 - a->len) {
+		return -EINVAL;
+	}
+
 	switch (a->type) {
 	case BACKED_BLOCK_DATA:
 		/* Don't support merging data for now */
@@ -239,6 +365,9 @@ static int merge_bb(struct backed_block_list *bbl,
 	 * and free b */
 	a->len += b->len;
 	a->next = b->next;
+	if (b->indexed) {
+		index_replace(bbl, b, a);
+	}
 
 	backed_block_destroy(b);
 
@@ -248,6 +377,7 @@ static int merge_bb(struct backed_block_list *bbl,
 static int queue_bb(struct backed_block_list *bbl, struct backed_block *new_bb)
 {
 	struct backed_block *bb;
+	unsigned int walk = 0;
 
 	if (bbl->data_blocks == NULL) {
 		bbl->data_blocks = new_bb;
@@ -260,17 +390,20 @@ static int queue_bb(struct backed_block_list *bbl, struct backed_block *new_bb)
 		return 0;
 	}
 
-	/* Optimization: blocks are mostly queued in sequence, so save the
-	   pointer to the last bb that was added, and start searching from
-	   there if the next block number is higher */
-	if (bbl->last_used && new_bb->block > bbl->last_used->block)
+	/* Optimization: blocks are mostly queued in sequence, so start searching
+	   from the last bb that was added if the next block number is higher,
+	   unless the index gets closer */
+	bb = index_find(bbl, new_bb->block);
+	if (bbl->last_used && new_bb->block > bbl->last_used->block &&
+			bbl->last_used->block > bb->block)
 		bb = bbl->last_used;
-	else
-		bb = bbl->data_blocks;
 	bbl->last_used = new_bb;
 
 	for (; bb->next && bb->next->block < new_bb->block; bb = bb->next)
-		;
+		walk++;
+	if (walk > INDEX_MAX_WALK) {
+		index_clear(bbl);
+	}
 
 	if (bb->next == NULL) {
 		bb->next = new_bb;
@@ -379,6 +512,7 @@ int backed_block_split(struct backed_block_list *bbl, struct backed_block *bb,
 	}
 
 	*new_bb = *bb;
+	new_bb->indexed = false;
 
 	new_bb->len = bb->len - max_len;
 	new_bb->block = bb->block + max_len / bbl->block_size;
@@ -56,6 +56,7 @@ struct backed_block *backed_block_iter_next(struct backed_block *bb);
 
 struct backed_block_list *backed_block_list_new(unsigned int block_size);
 void backed_block_list_destroy(struct backed_block_list *bbl);
+void backed_block_list_destroy_first(struct backed_block_list *bbl);
 
 void backed_block_list_move(struct backed_block_list *from,
 		struct backed_block_list *to, struct backed_block *start,
@@ -47,7 +47,9 @@ struct sparse_file *sparse_file_new(unsigned int block_size, int64_t len);
  * @s - sparse file cookie
  *
  * Destroys a sparse file cookie.  After destroy, all memory passed in to
- * sparse_file_add_data can be freed by the caller
+ * sparse_file_add_data can be freed by the caller.  A file being written by
+ * sparse_file_stream that sparse_file_stream_finish was not called for is
+ * left unfinished, without its end or chunk count.
  */
 void sparse_file_destroy(struct sparse_file *s);
 
@@ -161,6 +163,39 @@ int sparse_file_add_fd(struct sparse_file *s,
 int sparse_file_write(struct sparse_file *s, int fd, bool gz, bool sparse,
 		bool crc);
 
+/**
+ * sparse_file_stream - write a sparse file to a file as blocks are added
+ *
+ * @s - sparse file cookie, with no blocks added yet
+ * @fd - file descriptor to write to, if sparse is true it must be seekable
+ * @sparse - write in the Android sparse file format
+ * @crc - append a crc chunk
+ *
+ * Like sparse_file_write, but instead of keeping every block added until the
+ * whole file is written, each sparse_file_add_* call writes out the blocks
+ * added before, in order, and forgets them.  Only the last block is held back,
+ * in case the next one extends it.  Blocks must be added at or after the end
+ * of those already written, and data passed to sparse_file_add_data must stay
+ * valid until the next sparse_file_add_* or sparse_file_stream_finish call.
+ * The chunk count in the sparse header is filled in by
+ * sparse_file_stream_finish, which must be called to complete the file,
+ * sparse_file_destroy alone leaves it unfinished.
+ *
+ * Returns 0 on success, negative errno on error.
+ */
+int sparse_file_stream(struct sparse_file *s, int fd, bool sparse, bool crc);
+
+/**
+ * sparse_file_stream_finish - finish a file started by sparse_file_stream
+ *
+ * @s - sparse file cookie
+ *
+ * Writes out the blocks held back and the rest of the file.
+ *
+ * Returns 0 on success, negative errno on error.
+ */
+int sparse_file_stream_finish(struct sparse_file *s);
+
 /**
  * sparse_file_len - return the length of a sparse file if written to disk
  *
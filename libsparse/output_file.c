@@ -64,6 +64,7 @@ struct output_file_ops {
 	int (*skip)(struct output_file *, int64_t);
 	int (*pad)(struct output_file *, int64_t);
 	int (*write)(struct output_file *, void *, size_t);
+	int (*rewrite)(struct output_file *, int64_t, void *, size_t);
 	void (*close)(struct output_file *);
 };
 
@@ -83,6 +84,7 @@ struct output_file {
 	struct output_file_ops *ops;
 	struct sparse_file_ops *sparse_ops;
 	int use_crc;
+	int count_chunks;
 	unsigned int block_size;
 	int64_t len;
 	char *zero_buf;
@@ -101,6 +103,7 @@ struct output_file_gz {
 struct output_file_normal {
 	struct output_file out;
 	int fd;
+	int64_t start;
 };
 
 #define to_output_file_normal(_o) \
@@ -120,6 +123,7 @@ static int file_open(struct output_file *out, int fd)
 	struct output_file_normal *outn = to_output_file_normal(out);
 
 	outn->fd = fd;
+	outn->start = lseek64(fd, 0, SEEK_CUR);
 	return 0;
 }
 
@@ -171,6 +175,28 @@ static int file_write(struct output_file *out, void *data, size_t len)
 	return 0;
 }
 
+/* Overwrites what was written at offset, from where the output started. */
+static int file_rewrite(struct output_file *out, int64_t offset, void *data,
+		size_t len)
+{
+	struct output_file_normal *outn = to_output_file_normal(out);
+	off64_t pos;
+	int ret;
+
+	pos = lseek64(outn->fd, 0, SEEK_CUR);
+	if (outn->start < 0 || pos < 0 ||
+			lseek64(outn->fd, outn->start + offset, SEEK_SET) < 0) {
+		error_errno("lseek64");
+		return -1;
+	}
+	ret = file_write(out, data, len);
+	if (lseek64(outn->fd, pos, SEEK_SET) < 0) {
+		error_errno("lseek64");
+		return -1;
+	}
+	return ret;
+}
+
 static void file_close(struct output_file *out)
 {
 	struct output_file_normal *outn = to_output_file_normal(out);
@@ -183,6 +209,7 @@ static struct output_file_ops file_ops = {
 	.skip = file_skip,
 	.pad = file_pad,
 	.write = file_write,
+	.rewrite = file_rewrite,
 	.close = file_close,
 };
 
@@ -364,6 +391,11 @@ static int write_sparse_skip_chunk(struct output_file *out, int64_t skip_len)
 	if (ret < 0)
 		return -1;
 
+	/* Don't care blocks read back as zeroes, and are checked as such */
+	if (out->use_crc) {
+		out->crc32 = sparse_crc32_fill(out->crc32, 0, skip_len);
+	}
+
 	out->cur_out_ptr += skip_len;
 	out->chunk_cnt++;
 
@@ -374,7 +406,7 @@ static int write_sparse_fill_chunk(struct output_file *out, unsigned int len,
 		uint32_t fill_val)
 {
 	chunk_header_t chunk_header;
-	int rnd_up_len, count;
+	int rnd_up_len;
 	int ret;
 
 	/* Round up the fill length to a multiple of the block size */
@@ -394,9 +426,7 @@ static int write_sparse_fill_chunk(struct output_file *out, unsigned int len,
 		return -1;
 
 	if (out->use_crc) {
-		count = out->block_size / sizeof(uint32_t);
-		while (count--)
-			out->crc32 = sparse_crc32(out->crc32, &fill_val, sizeof(uint32_t));
+		out->crc32 = sparse_crc32_fill(out->crc32, fill_val, rnd_up_len);
 	}
 
 	out->cur_out_ptr += rnd_up_len;
@@ -539,9 +569,23 @@ static struct sparse_file_ops normal_file_ops = {
 		.write_end_chunk = write_normal_end_chunk,
 };
 
-void output_file_close(struct output_file *out)
+int output_file_close(struct output_file *out)
+{
+	int ret;
+
+	ret = out->sparse_ops->write_end_chunk(out);
+	if (ret >= 0 && out->count_chunks) {
+		/* Now that the chunks are all written, fill in their count */
+		uint32_t total_chunks = out->chunk_cnt;
+		ret = out->ops->rewrite(out, offsetof(sparse_header_t, total_chunks),
+				&total_chunks, sizeof(total_chunks));
+	}
+	out->ops->close(out);
+	return ret;
+}
+
+void output_file_abort(struct output_file *out)
 {
-	out->sparse_ops->write_end_chunk(out);
 	out->ops->close(out);
 }
 
@@ -556,6 +600,7 @@ static int output_file_init(struct output_file *out, int block_size,
 	out->chunk_cnt = 0;
 	out->crc32 = 0;
 	out->use_crc = crc;
+	out->count_chunks = sparse && chunks < 0;
 
 	out->zero_buf = calloc(block_size, 1);
 	if (!out->zero_buf) {
@@ -585,7 +630,7 @@ static int output_file_init(struct output_file *out, int block_size,
 				.chunk_hdr_sz = CHUNK_HEADER_LEN,
 				.blk_sz = out->block_size,
 				.total_blks = DIV_ROUND_UP(out->len, out->block_size),
-				.total_chunks = chunks,
+				.total_chunks = chunks < 0 ? 0 : chunks,
 				.image_checksum = 0
 		};
 
@@ -641,6 +686,11 @@ struct output_file *output_file_open_callback(int (*write)(void *, const void *,
 	int ret;
 	struct output_file_callback *outc;
 
+	if (sparse && chunks < 0) {
+		/* The chunk count can't be filled in afterwards */
+		return NULL;
+	}
+
 	outc = calloc(1, sizeof(struct output_file_callback));
 	if (!outc) {
 		error_errno("malloc struct outc");
@@ -666,6 +716,11 @@ struct output_file *output_file_open_fd(int fd, unsigned int block_size, int64_t
 	int ret;
 	struct output_file *out;
 
+	if (gz && sparse && chunks < 0) {
+		/* The chunk count can't be filled in afterwards */
+		return NULL;
+	}
+
 	if (gz) {
 		out = output_file_new_gz();
 	} else {
@@ -25,6 +25,8 @@ extern "C" {
 
 struct output_file;
 
+/* chunks < 0 counts the chunks as they are written and fills the count in
+ * when the output is closed, fd must be seekable and not gz then. */
 struct output_file *output_file_open_fd(int fd, unsigned int block_size, int64_t len,
 		int gz, int sparse, int chunks, int crc);
 struct output_file *output_file_open_callback(int (*write)(void *, const void *, int),
@@ -38,7 +40,9 @@ int write_file_chunk(struct output_file *out, unsigned int len,
 int write_fd_chunk(struct output_file *out, unsigned int len,
 		int fd, int64_t offset);
 int write_skip_chunk(struct output_file *out, int64_t len);
-void output_file_close(struct output_file *out);
+int output_file_close(struct output_file *out);
+/* Closes without the end chunk or chunk count, leaving the file unfinished */
+void output_file_abort(struct output_file *out);
 
 int read_all(int fd, void *buf, size_t len);
 
@@ -48,36 +48,66 @@ struct sparse_file *sparse_file_new(unsigned int block_size, int64_t len)
 
 void sparse_file_destroy(struct sparse_file *s)
 {
+	if (s->out) {
+		/* Streamed but not finished, don't pass it off as complete */
+		output_file_abort(s->out);
+	}
 	backed_block_list_destroy(s->backed_block_list);
 	free(s);
 }
 
+static int stream_blocks(struct sparse_file *s, bool all);
+
+/* Once a block is added to a file being streamed, write out the ones before */
+static int stream_added(struct sparse_file *s, int ret)
+{
+	if (ret == 0 && s->out) {
+		ret = stream_blocks(s, false);
+	}
+	return ret;
+}
+
 int sparse_file_add_data(struct sparse_file *s,
 		void *data, unsigned int len, unsigned int block)
 {
-	return backed_block_add_data(s->backed_block_list, data, len, block);
+	if (s->out && block < s->out_block) {
+		return -EINVAL;
+	}
+	return stream_added(s, backed_block_add_data(s->backed_block_list, data,
+			len, block));
 }
 
 int sparse_file_add_fill(struct sparse_file *s,
 		uint32_t fill_val, unsigned int len, unsigned int block)
 {
-	return backed_block_add_fill(s->backed_block_list, fill_val, len, block);
+	if (s->out && block < s->out_block) {
+		return -EINVAL;
+	}
+	return stream_added(s, backed_block_add_fill(s->backed_block_list,
+			fill_val, len, block));
 }
 
 int sparse_file_add_file(struct sparse_file *s,
 		const char *filename, int64_t file_offset, unsigned int len,
 		unsigned int block)
 {
-	return backed_block_add_file(s->backed_block_list, filename, file_offset,
-			len, block);
+	if (s->out && block < s->out_block) {
+		return -EINVAL;
+	}
+	return stream_added(s, backed_block_add_file(s->backed_block_list,
+			filename, file_offset, len, block));
 }
 
 int sparse_file_add_fd(struct sparse_file *s,
 		int fd, int64_t file_offset, unsigned int len, unsigned int block)
 {
-	return backed_block_add_fd(s->backed_block_list, fd, file_offset,
-			len, block);
+	if (s->out && block < s->out_block) {
+		return -EINVAL;
+	}
+	return stream_added(s, backed_block_add_fd(s->backed_block_list, fd,
+			file_offset, len, block));
 }
+
 unsigned int sparse_count_chunks(struct sparse_file *s)
 {
 	struct backed_block *bb;
@@ -178,6 +208,72 @@ int sparse_file_write(struct sparse_file *s, int fd, bool gz, bool sparse,
 	return ret;
 }
 
+/* Writes out the blocks queued so far but the last, unless all is set, which
+ * could still be merged with the next one added. */
+static int stream_blocks(struct sparse_file *s, bool all)
+{
+	struct backed_block *bb;
+	int ret;
+
+	while ((bb = backed_block_iter_new(s->backed_block_list)) &&
+			(all || backed_block_iter_next(bb))) {
+		if (backed_block_block(bb) > s->out_block) {
+			unsigned int blocks = backed_block_block(bb) - s->out_block;
+			ret = write_skip_chunk(s->out, (int64_t)blocks * s->block_size);
+			if (ret)
+				return ret;
+		}
+		ret = sparse_file_write_block(s->out, bb);
+		if (ret)
+			return ret;
+		s->out_block = backed_block_block(bb) +
+				DIV_ROUND_UP(backed_block_len(bb), s->block_size);
+		backed_block_list_destroy_first(s->backed_block_list);
+	}
+
+	return 0;
+}
+
+int sparse_file_stream(struct sparse_file *s, int fd, bool sparse, bool crc)
+{
+	if (s->out || backed_block_iter_new(s->backed_block_list)) {
+		return -EINVAL;
+	}
+
+	s->out = output_file_open_fd(fd, s->block_size, s->len, false, sparse,
+			-1, crc);
+	if (!s->out)
+		return -ENOMEM;
+	s->out_block = 0;
+
+	return 0;
+}
+
+int sparse_file_stream_finish(struct sparse_file *s)
+{
+	int64_t pad;
+	int ret;
+
+	if (!s->out) {
+		return -EINVAL;
+	}
+
+	ret = stream_blocks(s, true);
+	if (!ret) {
+		pad = s->len - (int64_t)s->out_block * s->block_size;
+		if (pad > 0) {
+			ret = write_skip_chunk(s->out, pad);
+		}
+	}
+
+	if (output_file_close(s->out) < 0 && !ret) {
+		ret = -EIO;
+	}
+	s->out = NULL;
+
+	return ret;
+}
+
 int sparse_file_callback(struct sparse_file *s, bool sparse, bool crc,
 		int (*write)(void *priv, const void *data, int len), void *priv)
 {
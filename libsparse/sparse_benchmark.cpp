@@ -0,0 +1,92 @@
+/*
+ * Copyright (C) 2018 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdint.h>
+#include <unistd.h>
+
+#include <string>
+#include <vector>
+
+#include <android-base/file.h>
+#include <android-base/test_utils.h>
+#include <benchmark/benchmark.h>
+#include <sparse/sparse.h>
+
+#include "sparse_crc32.h"
+
+static void BM_sparse_crc32(benchmark::State& state) {
+  std::vector<uint8_t> buf(state.range(0));
+  for (size_t i = 0; i < buf.size(); i++) {
+    buf[i] = i * 31;
+  }
+
+  uint32_t crc = 0;
+  while (state.KeepRunning()) {
+    crc = sparse_crc32(crc, buf.data(), buf.size());
+  }
+  benchmark::DoNotOptimize(crc);
+  state.SetBytesProcessed(state.iterations() * buf.size());
+}
+BENCHMARK(BM_sparse_crc32)->Arg(4096)->Arg(1 << 20);
+
+// The checksum of a fill or don't care chunk, a block to 4GiB.
+static void BM_sparse_crc32_fill(benchmark::State& state) {
+  uint32_t crc = 0;
+  while (state.KeepRunning()) {
+    crc = sparse_crc32_fill(crc, 0xdeadbeef, state.range(0));
+  }
+  benchmark::DoNotOptimize(crc);
+  state.SetBytesProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_sparse_crc32_fill)->Arg(4096)->Arg(1 << 20)->Arg(1LL << 32);
+
+// Reading a raw 4GiB image, as img2simg does. It is mostly a hole, with a
+// megabyte of data and one of fill every 64MiB.
+static void BM_sparse_file_read_normal(benchmark::State& state) {
+  constexpr int64_t kLen = 4LL << 30;
+  constexpr int64_t kStride = 64 << 20;
+  constexpr size_t kRunLen = 1 << 20;
+  constexpr unsigned int kBlockSize = 4096;
+
+  TemporaryFile tf;
+  std::string data(kRunLen, '\0');
+  for (size_t i = 0; i < data.size(); i++) {
+    data[i] = static_cast<char>(i * 13 + i / kBlockSize);
+  }
+  std::string fill(kRunLen, '\x5a');
+  bool written = ftruncate(tf.fd, kLen) == 0;
+  for (int64_t offset = 0; written && offset < kLen; offset += kStride) {
+    written = lseek(tf.fd, offset, SEEK_SET) == offset &&
+              android::base::WriteFully(tf.fd, data.data(), data.size()) &&
+              android::base::WriteFully(tf.fd, fill.data(), fill.size());
+  }
+  if (!written) {
+    state.SkipWithError("Failed to create the image.");
+    return;
+  }
+
+  while (state.KeepRunning()) {
+    struct sparse_file* s = sparse_file_new(kBlockSize, kLen);
+    if (lseek(tf.fd, 0, SEEK_SET) != 0 || sparse_file_read(s, tf.fd, false, false) != 0) {
+      state.SkipWithError("Failed to read the image.");
+    }
+    sparse_file_destroy(s);
+  }
+  state.SetBytesProcessed(state.iterations() * kLen);
+}
+BENCHMARK(BM_sparse_file_read_normal)->Unit(benchmark::kMillisecond);
+
+BENCHMARK_MAIN();
@@ -17,6 +17,7 @@
 #ifndef _LIBSPARSE_SPARSE_CRC32_H_
 #define _LIBSPARSE_SPARSE_CRC32_H_
 
+#include <stddef.h>
 #include <stdint.h>
 
 #ifdef __cplusplus
@@ -25,6 +26,9 @@ extern "C" {
 
 uint32_t sparse_crc32(uint32_t crc, const void *buf, size_t size);
 
+/* Continues crc with len bytes of fill_val repeated, len is a multiple of 4. */
+uint32_t sparse_crc32_fill(uint32_t crc, uint32_t fill_val, int64_t len);
+
 #ifdef __cplusplus
 }
 #endif
@@ -30,6 +30,8 @@ struct sparse_file {
 
 	struct backed_block_list *backed_block_list;
 	struct output_file *out;
+	/* Block after those written out by sparse_file_stream */
+	unsigned int out_block;
 };
 
 #ifdef __cplusplus
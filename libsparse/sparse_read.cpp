@@ -20,6 +20,7 @@
 #include <algorithm>
 #include <inttypes.h>
 #include <fcntl.h>
+#include <limits.h>
 #include <stdarg.h>
 #include <stdint.h>
 #include <stdio.h>
@@ -115,11 +116,8 @@ static int process_fill_chunk(struct sparse_file *s, unsigned int chunk_size,
 		int fd, unsigned int blocks, unsigned int block, uint32_t *crc32)
 {
 	int ret;
-	int chunk;
 	int64_t len = (int64_t)blocks * s->block_size;
 	uint32_t fill_val;
-	uint32_t *fillbuf;
-	unsigned int i;
 
 	if (chunk_size != sizeof(fill_val)) {
 		return -EINVAL;
@@ -136,17 +134,7 @@ static int process_fill_chunk(struct sparse_file *s, unsigned int chunk_size,
 	}
 
 	if (crc32) {
-		/* Fill copy_buf with the fill value */
-		fillbuf = (uint32_t *)copybuf;
-		for (i = 0; i < (COPY_BUF_SIZE / sizeof(fill_val)); i++) {
-			fillbuf[i] = fill_val;
-		}
-
-		while (len) {
-			chunk = std::min(len, COPY_BUF_SIZE);
-			*crc32 = sparse_crc32(*crc32, copybuf, chunk);
-			len -= chunk;
-		}
+		*crc32 = sparse_crc32_fill(*crc32, fill_val, len);
 	}
 
 	return 0;
@@ -161,14 +149,7 @@ static int process_skip_chunk(struct sparse_file *s, unsigned int chunk_size,
 	}
 
 	if (crc32) {
-	        int64_t len = (int64_t)blocks * s->block_size;
-		memset(copybuf, 0, COPY_BUF_SIZE);
-
-		while (len) {
-			int chunk = std::min(len, COPY_BUF_SIZE);
-			*crc32 = sparse_crc32(*crc32, copybuf, chunk);
-			len -= chunk;
-		}
+		*crc32 = sparse_crc32_fill(*crc32, 0, (int64_t)blocks * s->block_size);
 	}
 
 	return 0;
@@ -329,56 +310,102 @@ static int sparse_file_read_sparse(struct sparse_file *s, int fd, bool crc)
 	return 0;
 }
 
+/* Whether a block is made of a single repeated 32 bit word, ie: a fill block.
+ * Comparing the block with itself shifted by a word lets memcmp, which is
+ * vectorized, do the work. */
+static bool is_fill_block(const uint32_t *buf, unsigned int block_size)
+{
+	return memcmp(buf, buf + 1, block_size - sizeof(uint32_t)) == 0;
+}
+
+/* A run of blocks of the same kind, queued as a single backed block. */
+struct read_run {
+	bool fill;
+	uint32_t fill_val;
+	unsigned int block;
+	unsigned int len;
+	int64_t offset;
+};
+
+static int queue_run(struct sparse_file *s, int fd, struct read_run *run)
+{
+	int ret = 0;
+
+	if (run->len) {
+		if (run->fill) {
+			/* TODO: add flag to use skip instead of fill for fill_val == 0 */
+			ret = sparse_file_add_fill(s, run->fill_val, run->len, run->block);
+		} else {
+			ret = sparse_file_add_fd(s, fd, run->offset, run->len, run->block);
+		}
+	}
+	run->len = 0;
+	return ret;
+}
+
 static int sparse_file_read_normal(struct sparse_file *s, int fd)
 {
-	int ret;
-	uint32_t *buf = (uint32_t *)malloc(s->block_size);
+	int ret = 0;
+	/* Read many blocks at a time, the block size divides COPY_BUF_SIZE in
+	 * practice but doesn't have to. */
+	unsigned int buf_blocks = std::max<int64_t>(COPY_BUF_SIZE / s->block_size, 1);
+	unsigned int buf_size = buf_blocks * s->block_size;
+	/* Backed block lengths are 32 bit, keep runs well below that. */
+	unsigned int max_run_len = (UINT_MAX / 2 / s->block_size) * s->block_size;
+	uint32_t *buf = (uint32_t *)malloc(buf_size);
 	unsigned int block = 0;
 	int64_t remain = s->len;
 	int64_t offset = 0;
-	unsigned int to_read;
-	unsigned int i;
-	bool sparse_block;
+	struct read_run run = {};
 
 	if (!buf) {
 		return -ENOMEM;
 	}
 
 	while (remain > 0) {
-		to_read = std::min(remain, (int64_t)(s->block_size));
+		unsigned int to_read = std::min(remain, (int64_t)buf_size);
 		ret = read_all(fd, buf, to_read);
 		if (ret < 0) {
 			error("failed to read sparse file");
-			free(buf);
-			return ret;
+			break;
 		}
 
-		if (to_read == s->block_size) {
-			sparse_block = true;
-			for (i = 1; i < s->block_size / sizeof(uint32_t); i++) {
-				if (buf[0] != buf[i]) {
-					sparse_block = false;
+		for (unsigned int pos = 0; pos < to_read; pos += s->block_size) {
+			const uint32_t *block_buf = buf + pos / sizeof(uint32_t);
+			unsigned int len = std::min(to_read - pos, s->block_size);
+			bool fill = (len == s->block_size) && is_fill_block(block_buf, len);
+
+			/* Coalesce consecutive data blocks, and fill blocks of the same
+			 * value, rather than queueing them one by one. */
+			if (run.len && (run.fill != fill || (fill && run.fill_val != block_buf[0]) ||
+					run.len > max_run_len - len)) {
+				ret = queue_run(s, fd, &run);
+				if (ret < 0) {
 					break;
 				}
 			}
-		} else {
-			sparse_block = false;
-		}
+			if (!run.len) {
+				run.fill = fill;
+				run.fill_val = block_buf[0];
+				run.block = block;
+				run.offset = offset;
+			}
+			run.len += len;
 
-		if (sparse_block) {
-			/* TODO: add flag to use skip instead of fill for buf[0] == 0 */
-			sparse_file_add_fill(s, buf[0], to_read, block);
-		} else {
-			sparse_file_add_fd(s, fd, offset, to_read, block);
+			offset += len;
+			block++;
+		}
+		if (ret < 0) {
+			break;
 		}
-
 		remain -= to_read;
-		offset += to_read;
-		block++;
 	}
 
+	if (ret >= 0) {
+		ret = queue_run(s, fd, &run);
+	}
 	free(buf);
-	return 0;
+	return ret < 0 ? ret : 0;
 }
 
 int sparse_file_read(struct sparse_file *s, int fd, bool sparse, bool crc)
@@ -0,0 +1,217 @@
+/*
+ * Copyright (C) 2018 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <errno.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <android-base/file.h>
+#include <android-base/test_utils.h>
+#include <gtest/gtest.h>
+#include <sparse/sparse.h>
+
+#include "sparse_format.h"
+
+static constexpr unsigned int kBlockSize = 4096;
+static constexpr unsigned int kBlocks = 64;
+static constexpr int64_t kLen = static_cast<int64_t>(kBlocks + 3) * kBlockSize;
+
+class SparseTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    data_.resize(kBlocks * kBlockSize);
+    for (size_t i = 0; i < data_.size(); ++i) {
+      data_[i] = static_cast<char>(i * 13 + i / kBlockSize);
+    }
+    // Runs of data and fill blocks, every fourth block left out.
+    for (unsigned int block = 0; block < kBlocks; ++block) {
+      if (block % 4 != 3) blocks_.push_back(block);
+    }
+  }
+
+  int AddBlock(struct sparse_file* s, unsigned int block) {
+    if (block % 8 == 5) {
+      return sparse_file_add_fill(s, 0xdeadbeef, kBlockSize, block);
+    }
+    return sparse_file_add_data(s, &data_[block * kBlockSize], kBlockSize, block);
+  }
+
+  std::string Write(const std::vector<unsigned int>& blocks, bool sparse, bool crc) {
+    struct sparse_file* s = sparse_file_new(kBlockSize, kLen);
+    for (unsigned int block : blocks) {
+      EXPECT_EQ(0, AddBlock(s, block));
+    }
+    TemporaryFile tf;
+    EXPECT_EQ(0, sparse_file_write(s, tf.fd, false, sparse, crc));
+    sparse_file_destroy(s);
+    return ReadAll(tf.fd);
+  }
+
+  static std::string ReadAll(int fd) {
+    std::string contents;
+    EXPECT_EQ(0, lseek(fd, 0, SEEK_SET));
+    EXPECT_TRUE(android::base::ReadFdToString(fd, &contents));
+    return contents;
+  }
+
+  std::string data_;
+  std::vector<unsigned int> blocks_;
+};
+
+// Counts the bytes written with data, rather than skipped.
+static int CountData(void* priv, const void* data, int len) {
+  if (data) *static_cast<int64_t*>(priv) += len;
+  return 0;
+}
+
+TEST_F(SparseTest, StreamMatchesWrite) {
+  for (bool sparse : {true, false}) {
+    for (bool crc : {false, true}) {
+      struct sparse_file* s = sparse_file_new(kBlockSize, kLen);
+      TemporaryFile tf;
+      ASSERT_EQ(0, sparse_file_stream(s, tf.fd, sparse, crc));
+      for (unsigned int block : blocks_) {
+        ASSERT_EQ(0, AddBlock(s, block));
+      }
+      ASSERT_EQ(0, sparse_file_stream_finish(s));
+      sparse_file_destroy(s);
+
+      ASSERT_EQ(Write(blocks_, sparse, crc), ReadAll(tf.fd))
+          << "sparse " << sparse << " crc " << crc;
+    }
+  }
+}
+
+TEST_F(SparseTest, StreamRejectsWrittenBlocks) {
+  struct sparse_file* s = sparse_file_new(kBlockSize, kLen);
+  TemporaryFile tf;
+  ASSERT_EQ(0, sparse_file_stream(s, tf.fd, true, false));
+  ASSERT_EQ(0, AddBlock(s, 4));
+  ASSERT_EQ(0, AddBlock(s, 6));
+  ASSERT_EQ(-EINVAL, AddBlock(s, 2));
+  ASSERT_EQ(0, sparse_file_stream_finish(s));
+  ASSERT_EQ(-EINVAL, sparse_file_stream_finish(s));
+  sparse_file_destroy(s);
+}
+
+TEST_F(SparseTest, DestroyUnfinishedStream) {
+  struct sparse_file* s = sparse_file_new(kBlockSize, kLen);
+  TemporaryFile tf;
+  ASSERT_EQ(0, sparse_file_stream(s, tf.fd, true, false));
+  for (unsigned int block : blocks_) {
+    ASSERT_EQ(0, AddBlock(s, block));
+  }
+  sparse_file_destroy(s);
+
+  // Left without its chunk count, rather than passed off as complete.
+  std::string contents = ReadAll(tf.fd);
+  ASSERT_LT(sizeof(sparse_header_t), contents.size());
+  sparse_header_t header;
+  memcpy(&header, contents.data(), sizeof(header));
+  ASSERT_EQ(SPARSE_HEADER_MAGIC, header.magic);
+  ASSERT_EQ(0U, header.total_chunks);
+}
+
+TEST_F(SparseTest, AddOutOfOrder) {
+  std::string expected = Write(blocks_, true, true);
+
+  std::vector<unsigned int> shuffled = blocks_;
+  std::shuffle(shuffled.begin(), shuffled.end(), std::mt19937(1));
+  ASSERT_EQ(expected, Write(shuffled, true, true));
+
+  std::vector<unsigned int> reversed(blocks_.rbegin(), blocks_.rend());
+  ASSERT_EQ(expected, Write(reversed, true, true));
+}
+
+TEST_F(SparseTest, ImportChecksCrc) {
+  // Fill chunks of several blocks, and don't care chunks, count towards the
+  // checksum like the data they expand to.
+  struct sparse_file* s = sparse_file_new(kBlockSize, kLen);
+  ASSERT_EQ(0, sparse_file_add_fill(s, 0xdeadbeef, 3 * kBlockSize, 0));
+  ASSERT_EQ(0, AddBlock(s, 6));
+  ASSERT_EQ(0, sparse_file_add_fill(s, 0, 2 * kBlockSize, 7));
+  TemporaryFile tf;
+  ASSERT_EQ(0, sparse_file_write(s, tf.fd, false, true, true));
+  sparse_file_destroy(s);
+
+  ASSERT_EQ(0, lseek(tf.fd, 0, SEEK_SET));
+  s = sparse_file_import(tf.fd, true, true);
+  ASSERT_TRUE(s != nullptr);
+  sparse_file_destroy(s);
+}
+
+TEST_F(SparseTest, ReadNormalRuns) {
+  // Runs that span the 1MiB read buffer.
+  std::string image;
+  image.append(data_, 0, 40 * kBlockSize);
+  for (size_t i = 0; i < 300 * kBlockSize / sizeof(uint32_t); ++i) {
+    uint32_t fill = 0xdeadbeef;
+    image.append(reinterpret_cast<const char*>(&fill), sizeof(fill));
+  }
+  image.append(60 * kBlockSize, '\0');
+  image.append(data_, 0, 10 * kBlockSize);
+
+  TemporaryFile raw;
+  ASSERT_TRUE(android::base::WriteStringToFd(image, raw.fd));
+  ASSERT_EQ(0, lseek(raw.fd, 0, SEEK_SET));
+  struct sparse_file* s = sparse_file_new(kBlockSize, image.size());
+  ASSERT_EQ(0, sparse_file_read(s, raw.fd, false, false));
+
+  TemporaryFile expanded;
+  ASSERT_EQ(0, sparse_file_write(s, expanded.fd, false, false, false));
+  ASSERT_EQ(image, ReadAll(expanded.fd));
+
+  // Each run is a single chunk: data, two fills and data.
+  TemporaryFile sparse;
+  ASSERT_EQ(0, sparse_file_write(s, sparse.fd, false, true, false));
+  sparse_file_destroy(s);
+  std::string contents = ReadAll(sparse.fd);
+  ASSERT_LT(sizeof(sparse_header_t), contents.size());
+  sparse_header_t header;
+  memcpy(&header, contents.data(), sizeof(header));
+  ASSERT_EQ(4U, header.total_chunks);
+}
+
+TEST_F(SparseTest, ReadNormalLargeZeroImage) {
+  // A run of identical blocks of 4GiB or more must not wrap the 32 bit
+  // backed block length.
+  constexpr int64_t kLargeLen = (4LL << 30) + kBlockSize;
+  TemporaryFile raw;
+  ASSERT_EQ(0, ftruncate(raw.fd, kLargeLen));
+  struct sparse_file* s = sparse_file_new(kBlockSize, kLargeLen);
+  ASSERT_EQ(0, sparse_file_read(s, raw.fd, false, false));
+
+  TemporaryFile sparse;
+  ASSERT_EQ(0, sparse_file_write(s, sparse.fd, false, true, true));
+  sparse_file_destroy(s);
+
+  ASSERT_EQ(0, lseek(sparse.fd, 0, SEEK_SET));
+  s = sparse_file_import(sparse.fd, true, true);
+  ASSERT_TRUE(s != nullptr);
+  ASSERT_EQ(kLargeLen, sparse_file_len(s, false, false));
+  // A wrapped length would leave the rest of the image as don't care.
+  int64_t filled = 0;
+  ASSERT_EQ(0, sparse_file_callback(s, false, false, CountData, &filled));
+  ASSERT_EQ(kLargeLen, filled);
+  sparse_file_destroy(s);
+}
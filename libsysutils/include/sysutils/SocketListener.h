@@ -18,6 +18,9 @@
 
 #include <pthread.h>
 
+#include <unordered_map>
+#include <vector>
+
 #include <sysutils/SocketClient.h>
 #include "SocketClientCommand.h"
 
@@ -25,11 +28,19 @@ class SocketListener {
     bool                    mListen;
     const char              *mSocketName;
     int                     mSock;
-    SocketClientCollection  *mClients;
+    // by socket, so an epoll event finds its client without a scan
+    std::unordered_map<int, SocketClient *> mClients;
     pthread_mutex_t         mClientsLock;
     int                     mCtrlPipe[2];
+    int                     mEpollFd;
     pthread_t               mThread;
     bool                    mUseCmdNum;
+    size_t                  mWorkerCount;
+    std::vector<pthread_t>  mWorkers;
+    SocketClientCollection  mPending;
+    pthread_mutex_t         mPendingLock;
+    pthread_cond_t          mPendingCond;
+    bool                    mWorkersStop;
 
 public:
     SocketListener(const char *socketName, bool listen);
@@ -41,19 +52,32 @@ public:
     int startListener(int backlog);
     int stopListener();
 
+    /*
+     * Call onDataAvailable() from a pool of count threads rather than the
+     * listener thread, so a slow client does not hold up the others. A
+     * client is still only handled by one thread at a time, but
+     * onDataAvailable() must be safe to call for different clients at once.
+     * Must be called before startListener().
+     */
+    void setWorkerThreads(size_t count) { mWorkerCount = count; }
+
     void sendBroadcast(int code, const char *msg, bool addErrno);
 
     void runOnEachSocket(SocketClientCommand *command);
 
-    bool release(SocketClient *c) { return release(c, true); }
+    bool release(SocketClient *c);
 
 protected:
     virtual bool onDataAvailable(SocketClient *c) = 0;
 
 private:
-    bool release(SocketClient *c, bool wakeup);
     static void *threadStart(void *obj);
+    static void *workerStart(void *obj);
     void runListener();
+    void runWorker();
+    void dispatch(SocketClient *c);
+    bool addClient(SocketClient *c);
+    void stopWorkers();
     void init(const char *socketName, int socketFd, bool listen, bool useCmdNum);
 };
 #endif
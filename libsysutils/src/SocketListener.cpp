@@ -19,7 +19,7 @@
 #include <errno.h>
 #include <stdio.h>
 #include <stdlib.h>
-#include <sys/select.h>
+#include <sys/epoll.h>
 #include <sys/socket.h>
 #include <sys/time.h>
 #include <sys/types.h>
@@ -32,7 +32,8 @@
 #include <sysutils/SocketClient.h>
 
 #define CtrlPipe_Shutdown 0
-#define CtrlPipe_Wakeup   1
+
+#define MAX_EPOLL_EVENTS 32
 
 SocketListener::SocketListener(const char *socketName, bool listen) {
     init(socketName, -1, listen, false);
@@ -51,8 +52,14 @@ void SocketListener::init(const char *socketName, int socketFd, bool listen, boo
     mSocketName = socketName;
     mSock = socketFd;
     mUseCmdNum = useCmdNum;
+    mCtrlPipe[0] = -1;
+    mCtrlPipe[1] = -1;
+    mEpollFd = -1;
+    mWorkerCount = 0;
+    mWorkersStop = false;
     pthread_mutex_init(&mClientsLock, NULL);
-    mClients = new SocketClientCollection();
+    pthread_mutex_init(&mPendingLock, NULL);
+    pthread_cond_init(&mPendingCond, NULL);
 }
 
 SocketListener::~SocketListener() {
@@ -63,12 +70,15 @@ SocketListener::~SocketListener() {
         close(mCtrlPipe[0]);
         close(mCtrlPipe[1]);
     }
-    SocketClientCollection::iterator it;
-    for (it = mClients->begin(); it != mClients->end();) {
-        (*it)->decRef();
-        it = mClients->erase(it);
+    if (mEpollFd != -1) {
+        close(mEpollFd);
     }
-    delete mClients;
+    for (auto& it : mClients) {
+        it.second->decRef();
+    }
+    mClients.clear();
+    pthread_cond_destroy(&mPendingCond);
+    pthread_mutex_destroy(&mPendingLock);
 }
 
 int SocketListener::startListener() {
@@ -94,16 +104,49 @@ int SocketListener::startListener(int backlog) {
     if (mListen && listen(mSock, backlog) < 0) {
         SLOGE("Unable to listen on socket (%s)", strerror(errno));
         return -1;
-    } else if (!mListen)
-        mClients->push_back(new SocketClient(mSock, false, mUseCmdNum));
+    }
 
     if (pipe(mCtrlPipe)) {
         SLOGE("pipe failed (%s)", strerror(errno));
         return -1;
     }
 
+    if ((mEpollFd = epoll_create1(EPOLL_CLOEXEC)) < 0) {
+        SLOGE("epoll_create1 failed (%s)", strerror(errno));
+        return -1;
+    }
+
+    struct epoll_event event = {};
+    event.events = EPOLLIN;
+    event.data.fd = mCtrlPipe[0];
+    if (epoll_ctl(mEpollFd, EPOLL_CTL_ADD, mCtrlPipe[0], &event)) {
+        SLOGE("epoll_ctl failed (%s)", strerror(errno));
+        return -1;
+    }
+    if (mListen) {
+        event.data.fd = mSock;
+        if (epoll_ctl(mEpollFd, EPOLL_CTL_ADD, mSock, &event)) {
+            SLOGE("epoll_ctl failed (%s)", strerror(errno));
+            return -1;
+        }
+    } else if (!addClient(new SocketClient(mSock, false, mUseCmdNum))) {
+        return -1;
+    }
+
+    mWorkersStop = false;
+    for (size_t i = 0; i < mWorkerCount; ++i) {
+        pthread_t thread;
+        if (pthread_create(&thread, NULL, SocketListener::workerStart, this)) {
+            SLOGE("pthread_create (%s)", strerror(errno));
+            stopWorkers();
+            return -1;
+        }
+        mWorkers.push_back(thread);
+    }
+
     if (pthread_create(&mThread, NULL, SocketListener::threadStart, this)) {
         SLOGE("pthread_create (%s)", strerror(errno));
+        stopWorkers();
         return -1;
     }
 
@@ -125,24 +168,45 @@ int SocketListener::stopListener() {
         SLOGE("Error joining to listener thread (%s)", strerror(errno));
         return -1;
     }
+    stopWorkers();
     close(mCtrlPipe[0]);
     close(mCtrlPipe[1]);
     mCtrlPipe[0] = -1;
     mCtrlPipe[1] = -1;
+    close(mEpollFd);
+    mEpollFd = -1;
 
     if (mSocketName && mSock > -1) {
         close(mSock);
         mSock = -1;
     }
 
-    SocketClientCollection::iterator it;
-    for (it = mClients->begin(); it != mClients->end();) {
-        delete (*it);
-        it = mClients->erase(it);
+    for (auto& it : mClients) {
+        delete it.second;
     }
+    mClients.clear();
     return 0;
 }
 
+void SocketListener::stopWorkers() {
+    pthread_mutex_lock(&mPendingLock);
+    mWorkersStop = true;
+    pthread_cond_broadcast(&mPendingCond);
+    pthread_mutex_unlock(&mPendingLock);
+
+    for (pthread_t thread : mWorkers) {
+        pthread_join(thread, NULL);
+    }
+    mWorkers.clear();
+
+    while (!mPending.empty()) {
+        SocketClientCollection::iterator it = mPending.begin();
+        SocketClient* c = *it;
+        mPending.erase(it);
+        c->decRef();
+    }
+}
+
 void *SocketListener::threadStart(void *obj) {
     SocketListener *me = reinterpret_cast<SocketListener *>(obj);
 
@@ -151,80 +215,84 @@ void *SocketListener::threadStart(void *obj) {
     return NULL;
 }
 
-void SocketListener::runListener() {
+void *SocketListener::workerStart(void *obj) {
+    SocketListener *me = reinterpret_cast<SocketListener *>(obj);
 
-    SocketClientCollection pendingList;
+    me->runWorker();
+    return NULL;
+}
 
-    while(1) {
-        SocketClientCollection::iterator it;
-        fd_set read_fds;
-        int rc = 0;
-        int max = -1;
+bool SocketListener::addClient(SocketClient* c) {
+    struct epoll_event event = {};
+    int fd = c->getSocket();
 
-        FD_ZERO(&read_fds);
+    event.events = EPOLLIN;
+    if (mWorkerCount) {
+        // disarmed until a worker has handled the event
+        event.events |= EPOLLONESHOT;
+    }
+    event.data.fd = fd;
 
-        if (mListen) {
-            max = mSock;
-            FD_SET(mSock, &read_fds);
-        }
+    pthread_mutex_lock(&mClientsLock);
+    if (epoll_ctl(mEpollFd, EPOLL_CTL_ADD, fd, &event)) {
+        pthread_mutex_unlock(&mClientsLock);
+        SLOGE("epoll_ctl failed (%s)", strerror(errno));
+        c->decRef();
+        return false;
+    }
+    mClients[fd] = c;
+    pthread_mutex_unlock(&mClientsLock);
+    return true;
+}
 
-        FD_SET(mCtrlPipe[0], &read_fds);
-        if (mCtrlPipe[0] > max)
-            max = mCtrlPipe[0];
+void SocketListener::runListener() {
 
-        pthread_mutex_lock(&mClientsLock);
-        for (it = mClients->begin(); it != mClients->end(); ++it) {
-            // NB: calling out to an other object with mClientsLock held (safe)
-            int fd = (*it)->getSocket();
-            FD_SET(fd, &read_fds);
-            if (fd > max) {
-                max = fd;
-            }
-        }
-        pthread_mutex_unlock(&mClientsLock);
-        SLOGV("mListen=%d, max=%d, mSocketName=%s", mListen, max, mSocketName);
-        if ((rc = select(max + 1, &read_fds, NULL, NULL, NULL)) < 0) {
-            if (errno == EINTR)
-                continue;
-            SLOGE("select failed (%s) mListen=%d, max=%d", strerror(errno), mListen, max);
+    SocketClientCollection pendingList;
+    struct epoll_event events[MAX_EPOLL_EVENTS];
+
+    while(1) {
+        SocketClientCollection::iterator it;
+        int rc = TEMP_FAILURE_RETRY(epoll_wait(mEpollFd, events, MAX_EPOLL_EVENTS, -1));
+        if (rc < 0) {
+            SLOGE("epoll_wait failed (%s) mListen=%d", strerror(errno), mListen);
             sleep(1);
             continue;
-        } else if (!rc)
-            continue;
+        }
 
-        if (FD_ISSET(mCtrlPipe[0], &read_fds)) {
-            char c = CtrlPipe_Shutdown;
-            TEMP_FAILURE_RETRY(read(mCtrlPipe[0], &c, 1));
-            if (c == CtrlPipe_Shutdown) {
-                break;
+        /* Add all active clients to the pending list first */
+        pendingList.clear();
+        bool shutdown = false;
+        for (int i = 0; i < rc; ++i) {
+            int fd = events[i].data.fd;
+
+            if (fd == mCtrlPipe[0]) {
+                char c = CtrlPipe_Shutdown;
+                TEMP_FAILURE_RETRY(read(mCtrlPipe[0], &c, 1));
+                if (c == CtrlPipe_Shutdown) {
+                    shutdown = true;
+                }
+                continue;
             }
-            continue;
-        }
-        if (mListen && FD_ISSET(mSock, &read_fds)) {
-            int c = TEMP_FAILURE_RETRY(accept4(mSock, nullptr, nullptr, SOCK_CLOEXEC));
-            if (c < 0) {
-                SLOGE("accept failed (%s)", strerror(errno));
-                sleep(1);
+            if (mListen && (fd == mSock)) {
+                int c = TEMP_FAILURE_RETRY(accept4(mSock, nullptr, nullptr, SOCK_CLOEXEC));
+                if (c < 0) {
+                    SLOGE("accept failed (%s)", strerror(errno));
+                    sleep(1);
+                    continue;
+                }
+                addClient(new SocketClient(c, true, mUseCmdNum));
                 continue;
             }
-            pthread_mutex_lock(&mClientsLock);
-            mClients->push_back(new SocketClient(c, true, mUseCmdNum));
-            pthread_mutex_unlock(&mClientsLock);
-        }
 
-        /* Add all active clients to the pending list first */
-        pendingList.clear();
-        pthread_mutex_lock(&mClientsLock);
-        for (it = mClients->begin(); it != mClients->end(); ++it) {
-            SocketClient* c = *it;
-            // NB: calling out to an other object with mClientsLock held (safe)
-            int fd = c->getSocket();
-            if (FD_ISSET(fd, &read_fds)) {
-                pendingList.push_back(c);
-                c->incRef();
+            // The client may have been released since epoll_wait returned
+            pthread_mutex_lock(&mClientsLock);
+            std::unordered_map<int, SocketClient *>::iterator client = mClients.find(fd);
+            if (client != mClients.end()) {
+                pendingList.push_back(client->second);
+                client->second->incRef();
             }
+            pthread_mutex_unlock(&mClientsLock);
         }
-        pthread_mutex_unlock(&mClientsLock);
 
         /* Process the pending list, since it is owned by the thread,
          * there is no need to lock it */
@@ -233,37 +301,83 @@ void SocketListener::runListener() {
             it = pendingList.begin();
             SocketClient* c = *it;
             pendingList.erase(it);
-            /* Process it, if false is returned, remove from list */
-            if (!onDataAvailable(c)) {
-                release(c, false);
+            if (shutdown) {
+                c->decRef();
+            } else if (mWorkerCount) {
+                pthread_mutex_lock(&mPendingLock);
+                mPending.push_back(c);
+                pthread_cond_signal(&mPendingCond);
+                pthread_mutex_unlock(&mPendingLock);
+            } else {
+                dispatch(c);
             }
-            c->decRef();
+        }
+        if (shutdown) {
+            break;
         }
     }
 }
 
-bool SocketListener::release(SocketClient* c, bool wakeup) {
+void SocketListener::runWorker() {
+    pthread_mutex_lock(&mPendingLock);
+    while (1) {
+        while (!mWorkersStop && mPending.empty()) {
+            pthread_cond_wait(&mPendingCond, &mPendingLock);
+        }
+        if (mWorkersStop) {
+            break;
+        }
+        SocketClientCollection::iterator it = mPending.begin();
+        SocketClient* c = *it;
+        mPending.erase(it);
+        pthread_mutex_unlock(&mPendingLock);
+
+        dispatch(c);
+
+        pthread_mutex_lock(&mPendingLock);
+    }
+    pthread_mutex_unlock(&mPendingLock);
+}
+
+/* Called with a reference held on c, which it drops */
+void SocketListener::dispatch(SocketClient* c) {
+    /* Process it, if false is returned, remove from list */
+    if (!onDataAvailable(c)) {
+        release(c);
+    } else if (mWorkerCount) {
+        /* re-arm the oneshot event, unless it was released meanwhile */
+        pthread_mutex_lock(&mClientsLock);
+        int fd = c->getSocket();
+        std::unordered_map<int, SocketClient *>::iterator it = mClients.find(fd);
+        if ((it != mClients.end()) && (it->second == c)) {
+            struct epoll_event event = {};
+            event.events = EPOLLIN | EPOLLONESHOT;
+            event.data.fd = fd;
+            epoll_ctl(mEpollFd, EPOLL_CTL_MOD, fd, &event);
+        }
+        pthread_mutex_unlock(&mClientsLock);
+    }
+    c->decRef();
+}
+
+bool SocketListener::release(SocketClient* c) {
     bool ret = false;
     /* if our sockets are connection-based, remove and destroy it */
     if (mListen && c) {
-        /* Remove the client from our array */
+        /* Remove the client from our map */
         SLOGV("going to zap %d for %s", c->getSocket(), mSocketName);
         pthread_mutex_lock(&mClientsLock);
-        SocketClientCollection::iterator it;
-        for (it = mClients->begin(); it != mClients->end(); ++it) {
-            if (*it == c) {
-                mClients->erase(it);
-                ret = true;
-                break;
-            }
+        int fd = c->getSocket();
+        std::unordered_map<int, SocketClient *>::iterator it = mClients.find(fd);
+        if ((it != mClients.end()) && (it->second == c)) {
+            // before the last reference closes the socket
+            epoll_ctl(mEpollFd, EPOLL_CTL_DEL, fd, NULL);
+            mClients.erase(it);
+            ret = true;
         }
         pthread_mutex_unlock(&mClientsLock);
         if (ret) {
             ret = c->decRef();
-            if (wakeup) {
-                char b = CtrlPipe_Wakeup;
-                TEMP_FAILURE_RETRY(write(mCtrlPipe[1], &b, 1));
-            }
         }
     }
     return ret;
@@ -277,8 +391,8 @@ void SocketListener::sendBroadcast(int code, const char *msg, bool addErrno) {
     pthread_mutex_lock(&mClientsLock);
     SocketClientCollection::iterator i;
 
-    for (i = mClients->begin(); i != mClients->end(); ++i) {
-        SocketClient* c = *i;
+    for (auto& it : mClients) {
+        SocketClient* c = it.second;
         c->incRef();
         safeList.push_back(c);
     }
@@ -305,8 +419,8 @@ void SocketListener::runOnEachSocket(SocketClientCommand *command) {
     pthread_mutex_lock(&mClientsLock);
     SocketClientCollection::iterator i;
 
-    for (i = mClients->begin(); i != mClients->end(); ++i) {
-        SocketClient* c = *i;
+    for (auto& it : mClients) {
+        SocketClient* c = it.second;
         c->incRef();
         safeList.push_back(c);
     }
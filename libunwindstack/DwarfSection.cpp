@@ -54,8 +54,35 @@ const DwarfFde* DwarfSection::GetFdeFromPc(uint64_t pc) {
   return nullptr;
 }
 
+void DwarfSection::FlattenLocRegs(const dwarf_loc_regs_t& loc_regs, DwarfLocRegsFlat* flat) {
+  flat->has_cfa = false;
+  flat->defined_regs = 0;
+  flat->regs.clear();
+  for (const auto& entry : loc_regs) {
+    if (entry.first == CFA_REG) {
+      flat->has_cfa = true;
+      flat->cfa = entry.second;
+    } else if (entry.first < DwarfLocRegsFlat::kMaxRegs) {
+      flat->defined_regs |= 1ULL << entry.first;
+      flat->regs.push_back(entry);
+    }
+  }
+}
+
 bool DwarfSection::Step(uint64_t pc, Regs* regs, Memory* process_memory, bool* finished) {
   last_error_ = DWARF_ERROR_NONE;
+
+  // The same call sites get unwound over and over, so keep the location
+  // rules of the pcs seen before rather than evaluating the cfa
+  // instructions every time.
+  auto cache_entry = step_cache_.find(pc);
+  if (cache_entry != step_cache_.end()) {
+    step_cache_hits_++;
+    return EvalFlat(cache_entry->second.cie, process_memory, cache_entry->second.loc_regs, regs,
+                    finished);
+  }
+  step_cache_misses_++;
+
   const DwarfFde* fde = GetFdeFromPc(pc);
   if (fde == nullptr || fde->cie == nullptr) {
     last_error_ = DWARF_ERROR_ILLEGAL_STATE;
@@ -68,8 +95,16 @@ bool DwarfSection::Step(uint64_t pc, Regs* regs, Memory* process_memory, bool* f
     return false;
   }
 
+  if (step_cache_.size() >= kMaxStepCacheEntries) {
+    // Start again rather than keep track of the least used entries.
+    step_cache_.clear();
+  }
+  StepCacheEntry* entry = &step_cache_[pc];
+  entry->cie = fde->cie;
+  FlattenLocRegs(loc_regs, &entry->loc_regs);
+
   // Now eval the actual registers.
-  return Eval(fde->cie, process_memory, loc_regs, regs, finished);
+  return EvalFlat(fde->cie, process_memory, entry->loc_regs, regs, finished);
 }
 
 template <typename AddressType>
@@ -101,6 +136,15 @@ template <typename AddressType>
 bool DwarfSectionImpl<AddressType>::Eval(const DwarfCie* cie, Memory* regular_memory,
                                          const dwarf_loc_regs_t& loc_regs, Regs* regs,
                                          bool* finished) {
+  DwarfLocRegsFlat flat;
+  FlattenLocRegs(loc_regs, &flat);
+  return EvalFlat(cie, regular_memory, flat, regs, finished);
+}
+
+template <typename AddressType>
+bool DwarfSectionImpl<AddressType>::EvalFlat(const DwarfCie* cie, Memory* regular_memory,
+                                             const DwarfLocRegsFlat& loc_regs, Regs* regs,
+                                             bool* finished) {
   RegsImpl<AddressType>* cur_regs = reinterpret_cast<RegsImpl<AddressType>*>(regs);
   if (cie->return_address_register >= cur_regs->total_regs()) {
     last_error_ = DWARF_ERROR_ILLEGAL_VALUE;
@@ -108,8 +152,7 @@ bool DwarfSectionImpl<AddressType>::Eval(const DwarfCie* cie, Memory* regular_me
   }
 
   // Get the cfa value;
-  auto cfa_entry = loc_regs.find(CFA_REG);
-  if (cfa_entry == loc_regs.end()) {
+  if (!loc_regs.has_cfa) {
     last_error_ = DWARF_ERROR_CFA_NOT_DEFINED;
     return false;
   }
@@ -117,7 +160,7 @@ bool DwarfSectionImpl<AddressType>::Eval(const DwarfCie* cie, Memory* regular_me
   AddressType prev_cfa = regs->sp();
 
   AddressType cfa;
-  const DwarfLocation* loc = &cfa_entry->second;
+  const DwarfLocation* loc = &loc_regs.cfa;
   // Only a few location types are valid for the cfa.
   switch (loc->type) {
     case DWARF_LOCATION_REGISTER:
@@ -128,7 +171,7 @@ bool DwarfSectionImpl<AddressType>::Eval(const DwarfCie* cie, Memory* regular_me
       // If the stack pointer register is the CFA, and the stack
       // pointer register does not have any associated location
       // information, use the current cfa value.
-      if (regs->sp_reg() == loc->values[0] && loc_regs.count(regs->sp_reg()) == 0) {
+      if (regs->sp_reg() == loc->values[0] && !loc_regs.IsDefined(regs->sp_reg())) {
         cfa = prev_cfa;
       } else {
         cfa = (*cur_regs)[loc->values[0]];
@@ -162,11 +205,8 @@ bool DwarfSectionImpl<AddressType>::Eval(const DwarfCie* cie, Memory* regular_me
   // because it does not guarantee that r5 is evaluated before r3.
   // Check that this case does not exist, and error if it does.
   bool return_address_undefined = false;
-  for (const auto& entry : loc_regs) {
+  for (const auto& entry : loc_regs.regs) {
     uint16_t reg = entry.first;
-    // Already handled the CFA register.
-    if (reg == CFA_REG) continue;
-
     if (reg >= cur_regs->total_regs()) {
       // Skip this unknown register.
       continue;
@@ -190,7 +230,7 @@ bool DwarfSectionImpl<AddressType>::Eval(const DwarfCie* cie, Memory* regular_me
           last_error_ = DWARF_ERROR_ILLEGAL_VALUE;
           return false;
         }
-        if (loc_regs.find(cur_reg) != loc_regs.end()) {
+        if (loc_regs.IsDefined(cur_reg)) {
           // This is a double indirection, a register definition references
           // another register which is also defined as something other
           // than a register.
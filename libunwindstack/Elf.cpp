@@ -67,7 +67,8 @@ void Elf::InitGnuDebugdata() {
     return;
   }
 
-  gnu_debugdata_memory_.reset(interface_->CreateGnuDebugdataMemory());
+  MemoryBuffer* gnu_memory = interface_->CreateGnuDebugdataMemory();
+  gnu_debugdata_memory_.reset(gnu_memory);
   gnu_debugdata_interface_.reset(CreateInterfaceFromMemory(gnu_debugdata_memory_.get()));
   ElfInterface* gnu = gnu_debugdata_interface_.get();
   if (gnu == nullptr) {
@@ -80,6 +81,7 @@ void Elf::InitGnuDebugdata() {
   if (gnu->Init(&load_bias)) {
     gnu->InitHeaders();
     interface_->SetGnuDebugdataInterface(gnu);
+    gnu_debugdata_memory_size_ = gnu_memory->Size();
   } else {
     // Free all of the memory associated with the gnu_debugdata section.
     gnu_debugdata_memory_.reset(nullptr);
@@ -103,6 +105,26 @@ bool Elf::GetFunctionName(uint64_t addr, std::string* name, uint64_t* func_offse
                                                      addr, load_bias_, name, func_offset)));
 }
 
+bool Elf::InitSymbolTables() {
+  std::lock_guard<std::mutex> guard(lock_);
+  if (!valid_) {
+    return false;
+  }
+  bool built = interface_->InitSymbolTables(load_bias_);
+  if (gnu_debugdata_interface_ && !gnu_debugdata_interface_->InitSymbolTables(load_bias_)) {
+    built = false;
+  }
+  return built;
+}
+
+bool Elf::GetFunctionNameFromTable(uint64_t addr, const char** name, uint64_t* func_offset) {
+  std::lock_guard<std::mutex> guard(lock_);
+  return valid_ && (interface_->GetFunctionNameFromTable(addr, load_bias_, name, func_offset) ||
+                    (gnu_debugdata_interface_ &&
+                     gnu_debugdata_interface_->GetFunctionNameFromTable(addr, load_bias_, name,
+                                                                       func_offset)));
+}
+
 bool Elf::GetGlobalVariable(const std::string& name, uint64_t* memory_address) {
   if (!valid_) {
     return false;
@@ -152,6 +174,26 @@ bool Elf::Step(uint64_t rel_pc, uint64_t adjusted_rel_pc, uint64_t elf_offset, R
   return interface_->Step(adjusted_rel_pc, load_bias_, regs, process_memory, finished);
 }
 
+static void AddStepCacheStats(ElfInterface* interface, uint64_t* hits, uint64_t* misses) {
+  if (interface == nullptr) {
+    return;
+  }
+  for (DwarfSection* section : {interface->eh_frame(), interface->debug_frame()}) {
+    if (section != nullptr) {
+      *hits += section->step_cache_hits();
+      *misses += section->step_cache_misses();
+    }
+  }
+}
+
+void Elf::GetStepCacheStats(uint64_t* hits, uint64_t* misses) {
+  std::lock_guard<std::mutex> guard(lock_);
+  *hits = 0;
+  *misses = 0;
+  AddStepCacheStats(interface_.get(), hits, misses);
+  AddStepCacheStats(gnu_debugdata_interface_.get(), hits, misses);
+}
+
 bool Elf::IsValidElf(Memory* memory) {
   if (memory == nullptr) {
     return false;
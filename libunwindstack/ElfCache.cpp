@@ -0,0 +1,132 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdint.h>
+
+#include <atomic>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+#include <unwindstack/Elf.h>
+#include <unwindstack/ElfCache.h>
+
+namespace unwindstack {
+
+namespace {
+
+struct CacheEntry {
+  std::string key;
+  std::shared_ptr<Elf> elf;
+  uint64_t elf_offset;
+  uint64_t bytes;
+};
+
+struct CacheData {
+  std::mutex lock;
+  // Most recently used first.
+  std::list<CacheEntry> entries;
+  std::unordered_map<std::string, std::list<CacheEntry>::iterator> index;
+  uint64_t max_bytes = ElfCache::kDefaultMaxBytes;
+  ElfCache::Stats stats;
+
+  // Drops the least recently used entries no MapInfo holds until the cache
+  // fits in max_bytes. The lock must be held.
+  void Trim(uint64_t limit) {
+    auto it = entries.end();
+    while (stats.bytes > limit && it != entries.begin()) {
+      --it;
+      if (it->elf.use_count() != 1) {
+        continue;
+      }
+      stats.bytes -= it->bytes;
+      stats.evictions++;
+      index.erase(it->key);
+      it = entries.erase(it);
+    }
+    stats.entries = entries.size();
+  }
+};
+
+std::atomic_bool g_enabled(false);
+
+CacheData* GetCacheData() {
+  // Never destroyed so that no MapInfo outlives the cache at exit.
+  static CacheData* data = new CacheData;
+  return data;
+}
+
+}  // namespace
+
+void ElfCache::SetEnabled(bool enabled) {
+  g_enabled = enabled;
+  if (!enabled) {
+    CacheData* data = GetCacheData();
+    std::lock_guard<std::mutex> guard(data->lock);
+    data->Trim(0);
+  }
+}
+
+bool ElfCache::Enabled() {
+  return g_enabled;
+}
+
+void ElfCache::SetMaxBytes(uint64_t max_bytes) {
+  CacheData* data = GetCacheData();
+  std::lock_guard<std::mutex> guard(data->lock);
+  data->max_bytes = max_bytes;
+  data->Trim(max_bytes);
+}
+
+ElfCache::Stats ElfCache::GetStats() {
+  CacheData* data = GetCacheData();
+  std::lock_guard<std::mutex> guard(data->lock);
+  return data->stats;
+}
+
+std::shared_ptr<Elf> ElfCache::Find(const std::string& key, uint64_t* elf_offset) {
+  CacheData* data = GetCacheData();
+  std::lock_guard<std::mutex> guard(data->lock);
+  auto entry = data->index.find(key);
+  if (entry == data->index.end()) {
+    data->stats.misses++;
+    return nullptr;
+  }
+  data->stats.hits++;
+  data->entries.splice(data->entries.begin(), data->entries, entry->second);
+  *elf_offset = entry->second->elf_offset;
+  return entry->second->elf;
+}
+
+std::shared_ptr<Elf> ElfCache::Add(const std::string& key, std::shared_ptr<Elf> elf,
+                                   uint64_t elf_offset, uint64_t bytes) {
+  CacheData* data = GetCacheData();
+  std::lock_guard<std::mutex> guard(data->lock);
+  auto entry = data->index.find(key);
+  if (entry != data->index.end()) {
+    return entry->second->elf;
+  }
+  data->entries.push_front(CacheEntry{key, elf, elf_offset, bytes});
+  data->index[key] = data->entries.begin();
+  data->stats.bytes += bytes;
+  // The new entry is still held by the caller, so it is never dropped here.
+  data->Trim(data->max_bytes);
+  return elf;
+}
+
+}  // namespace unwindstack
@@ -67,7 +67,7 @@ bool ElfInterface::IsValidPc(uint64_t pc) {
   return false;
 }
 
-Memory* ElfInterface::CreateGnuDebugdataMemory() {
+MemoryBuffer* ElfInterface::CreateGnuDebugdataMemory() {
   if (gnu_debugdata_offset_ == 0 || gnu_debugdata_size_ == 0) {
     return nullptr;
   }
@@ -428,6 +428,27 @@ bool ElfInterface::GetGlobalVariableWithTemplate(const std::string& name, uint64
   return false;
 }
 
+template <typename SymType>
+bool ElfInterface::InitSymbolTablesWithTemplate(uint64_t load_bias) {
+  bool built = true;
+  for (const auto symbol : symbols_) {
+    if (!symbol->BuildTable<SymType>(load_bias, memory_)) {
+      built = false;
+    }
+  }
+  return built;
+}
+
+bool ElfInterface::GetFunctionNameFromTable(uint64_t addr, uint64_t load_bias, const char** name,
+                                            uint64_t* func_offset) {
+  for (const auto symbol : symbols_) {
+    if (symbol->GetNameFromTable(addr, load_bias, name, func_offset)) {
+      return true;
+    }
+  }
+  return false;
+}
+
 bool ElfInterface::Step(uint64_t pc, uint64_t load_bias, Regs* regs, Memory* process_memory,
                         bool* finished) {
   // Adjust the load bias to get the real relative pc.
@@ -496,6 +517,9 @@ template bool ElfInterface::GetFunctionNameWithTemplate<Elf64_Sym>(uint64_t, uin
 template bool ElfInterface::GetGlobalVariableWithTemplate<Elf32_Sym>(const std::string&, uint64_t*);
 template bool ElfInterface::GetGlobalVariableWithTemplate<Elf64_Sym>(const std::string&, uint64_t*);
 
+template bool ElfInterface::InitSymbolTablesWithTemplate<Elf32_Sym>(uint64_t);
+template bool ElfInterface::InitSymbolTablesWithTemplate<Elf64_Sym>(uint64_t);
+
 template void ElfInterface::GetMaxSizeWithTemplate<Elf32_Ehdr>(Memory*, uint64_t*);
 template void ElfInterface::GetMaxSizeWithTemplate<Elf64_Ehdr>(Memory*, uint64_t*);
 
@@ -14,7 +14,9 @@
  * limitations under the License.
  */
 
+#include <inttypes.h>
 #include <sys/mman.h>
+#include <sys/stat.h>
 #include <sys/types.h>
 #include <unistd.h>
 
@@ -22,14 +24,17 @@
 #include <mutex>
 #include <string>
 
+#include <android-base/stringprintf.h>
+
 #include <unwindstack/Elf.h>
+#include <unwindstack/ElfCache.h>
 #include <unwindstack/MapInfo.h>
 #include <unwindstack/Maps.h>
 #include <unwindstack/Memory.h>
 
 namespace unwindstack {
 
-Memory* MapInfo::GetFileMemory() {
+MemoryFileAtOffset* MapInfo::GetFileMemory() {
   std::unique_ptr<MemoryFileAtOffset> memory(new MemoryFileAtOffset);
   if (offset == 0) {
     if (memory->Init(name, 0)) {
@@ -78,7 +83,11 @@ Memory* MapInfo::GetFileMemory() {
   return memory.release();
 }
 
-Memory* MapInfo::CreateMemory(const std::shared_ptr<Memory>& process_memory) {
+Memory* MapInfo::CreateMemory(const std::shared_ptr<Memory>& process_memory,
+                              uint64_t* file_size) {
+  if (file_size != nullptr) {
+    *file_size = 0;
+  }
   if (end <= start) {
     return nullptr;
   }
@@ -92,8 +101,11 @@ Memory* MapInfo::CreateMemory(const std::shared_ptr<Memory>& process_memory) {
 
   // First try and use the file associated with the info.
   if (!name.empty()) {
-    Memory* memory = GetFileMemory();
+    MemoryFileAtOffset* memory = GetFileMemory();
     if (memory != nullptr) {
+      if (file_size != nullptr) {
+        *file_size = memory->Size();
+      }
       return memory;
     }
   }
@@ -105,20 +117,71 @@ Memory* MapInfo::CreateMemory(const std::shared_ptr<Memory>& process_memory) {
   return new MemoryRange(process_memory, start, end - start, 0);
 }
 
+std::string MapInfo::GetElfCacheKey(bool init_gnu_debugdata) {
+  if (end <= start || name.empty() || (flags & MAPS_FLAGS_DEVICE_MAP)) {
+    return "";
+  }
+
+  // The file may have been replaced since it was mapped, or differ between
+  // processes that run in different mount namespaces, so identify the
+  // contents and not only the path.
+  struct stat buf;
+  if (stat(name.c_str(), &buf) == -1) {
+    return "";
+  }
+  // The map size is part of the key since it decides how much of an elf
+  // embedded at a non-zero offset is mapped.
+  return android::base::StringPrintf(
+      "%s:%" PRIx64 ":%" PRIx64 ":%" PRIx64 ":%" PRIx64 ":%" PRIx64 ":%" PRId64 ".%09ld:%d",
+      name.c_str(), offset, end - start, static_cast<uint64_t>(buf.st_dev),
+      static_cast<uint64_t>(buf.st_ino), static_cast<uint64_t>(buf.st_size),
+      static_cast<int64_t>(buf.st_mtim.tv_sec), buf.st_mtim.tv_nsec, init_gnu_debugdata);
+}
+
 Elf* MapInfo::GetElf(const std::shared_ptr<Memory>& process_memory, bool init_gnu_debugdata) {
+  Elf* cur_elf = elf.load();
+  if (cur_elf != nullptr) {
+    return cur_elf;
+  }
+
   // Make sure no other thread is trying to add the elf to this map.
   std::lock_guard<std::mutex> guard(mutex_);
 
-  if (elf) {
-    return elf;
+  cur_elf = elf.load();
+  if (cur_elf != nullptr) {
+    return cur_elf;
+  }
+
+  std::string key;
+  if (ElfCache::Enabled()) {
+    key = GetElfCacheKey(init_gnu_debugdata);
+    if (!key.empty()) {
+      uint64_t cached_elf_offset;
+      shared_elf_ = ElfCache::Find(key, &cached_elf_offset);
+      if (shared_elf_ != nullptr) {
+        elf_offset = cached_elf_offset;
+        elf = shared_elf_.get();
+        return shared_elf_.get();
+      }
+    }
   }
 
-  elf = new Elf(CreateMemory(process_memory));
-  elf->Init(init_gnu_debugdata);
+  uint64_t file_size;
+  cur_elf = new Elf(CreateMemory(process_memory, &file_size));
+  cur_elf->Init(init_gnu_debugdata);
+
+  // Only an elf read from the file itself can be shared, the process
+  // memory of one process says nothing about another one.
+  if (!key.empty() && file_size != 0) {
+    shared_elf_ = ElfCache::Add(key, std::shared_ptr<Elf>(cur_elf), elf_offset,
+                                file_size + cur_elf->gnu_debugdata_memory_size());
+    cur_elf = shared_elf_.get();
+  }
 
   // If the init fails, keep the elf around as an invalid object so we
-  // don't try to reinit the object.
-  return elf;
+  // don't try to reinit the object. Only publish it once it is initialized.
+  elf = cur_elf;
+  return cur_elf;
 }
 
 uint64_t MapInfo::GetLoadBias(const std::shared_ptr<Memory>& process_memory) {
@@ -130,9 +193,10 @@ uint64_t MapInfo::GetLoadBias(const std::shared_ptr<Memory>& process_memory) {
   {
     // Make sure no other thread is trying to add the elf to this map.
     std::lock_guard<std::mutex> guard(mutex_);
-    if (elf != nullptr) {
-      if (elf->valid()) {
-        cur_load_bias = elf->GetLoadBias();
+    Elf* cur_elf = elf.load();
+    if (cur_elf != nullptr) {
+      if (cur_elf->valid()) {
+        cur_load_bias = cur_elf->GetLoadBias();
         load_bias = cur_load_bias;
         return cur_load_bias;
       } else {
@@ -23,6 +23,7 @@
 #include <sys/types.h>
 #include <unistd.h>
 
+#include <android-base/file.h>
 #include <android-base/unique_fd.h>
 
 #include <cctype>
@@ -36,16 +37,31 @@
 
 namespace unwindstack {
 
-MapInfo* Maps::Find(uint64_t pc) {
+MapInfo* Maps::Find(uint64_t pc, size_t* map_index) {
   if (maps_.empty()) {
     return nullptr;
   }
+  size_t last_index = last_find_index_.load(std::memory_order_relaxed);
+  if (last_index < maps_.size()) {
+    MapInfo* cur = maps_[last_index];
+    if (pc >= cur->start && pc < cur->end) {
+      if (map_index != nullptr) {
+        *map_index = last_index;
+      }
+      return cur;
+    }
+  }
+
   size_t first = 0;
   size_t last = maps_.size();
   while (first < last) {
     size_t index = (first + last) / 2;
     MapInfo* cur = maps_[index];
     if (pc >= cur->start && pc < cur->end) {
+      last_find_index_.store(index, std::memory_order_relaxed);
+      if (map_index != nullptr) {
+        *map_index = index;
+      }
       return cur;
     } else if (pc < cur->start) {
       last = index;
@@ -202,6 +218,62 @@ bool Maps::Parse() {
   return return_value;
 }
 
+static bool IsSameMap(const MapInfo* a, const MapInfo* b) {
+  return a->start == b->start && a->end == b->end && a->offset == b->offset &&
+         a->flags == b->flags && a->name == b->name;
+}
+
+bool Maps::Reparse(bool* any_changed) {
+  if (any_changed != nullptr) {
+    *any_changed = false;
+  }
+
+  std::string data;
+  if (!android::base::ReadFileToString(GetMapsFile(), &data)) {
+    return false;
+  }
+  if (!maps_.empty() && data == last_maps_data_) {
+    return true;
+  }
+
+  std::vector<MapInfo*> new_maps;
+  if (!ParseBuffer(data.c_str(), &new_maps)) {
+    for (auto& map : new_maps) {
+      delete map;
+    }
+    return false;
+  }
+
+  // Both lists are sorted by start address, so walk them together, keeping
+  // the old object for every map that is the same.
+  bool changed = false;
+  size_t old_index = 0;
+  for (auto& map : new_maps) {
+    while (old_index < maps_.size() && maps_[old_index]->start < map->start) {
+      delete maps_[old_index++];
+      changed = true;
+    }
+    if (old_index < maps_.size() && IsSameMap(maps_[old_index], map)) {
+      delete map;
+      map = maps_[old_index++];
+    } else {
+      changed = true;
+    }
+  }
+  for (; old_index < maps_.size(); old_index++) {
+    delete maps_[old_index];
+    changed = true;
+  }
+
+  maps_.swap(new_maps);
+  last_find_index_ = 0;
+  last_maps_data_ = std::move(data);
+  if (any_changed != nullptr) {
+    *any_changed = changed;
+  }
+  return true;
+}
+
 void Maps::Add(uint64_t start, uint64_t end, uint64_t offset, uint64_t flags,
                const std::string& name, uint64_t load_bias) {
   MapInfo* map_info = new MapInfo(start, end, offset, flags, name);
@@ -215,8 +287,8 @@ Maps::~Maps() {
   }
 }
 
-bool BufferMaps::Parse() {
-  const char* start_of_line = buffer_;
+bool Maps::ParseBuffer(const char* buffer, std::vector<MapInfo*>* maps) {
+  const char* start_of_line = buffer;
   do {
     std::string line;
     const char* end_of_line = strchr(start_of_line, '\n');
@@ -231,13 +303,17 @@ bool BufferMaps::Parse() {
     if (map_info == nullptr) {
       return false;
     }
-    maps_.push_back(map_info);
+    maps->push_back(map_info);
 
     start_of_line = end_of_line;
   } while (start_of_line != nullptr && *start_of_line != '\0');
   return true;
 }
 
+bool BufferMaps::Parse() {
+  return ParseBuffer(buffer_, &maps_);
+}
+
 const std::string RemoteMaps::GetMapsFile() const {
   return "/proc/" + std::to_string(pid_) + "/maps";
 }
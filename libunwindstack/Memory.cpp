@@ -16,6 +16,7 @@
 
 #include <errno.h>
 #include <fcntl.h>
+#include <string.h>
 #include <sys/mman.h>
 #include <sys/ptrace.h>
 #include <sys/stat.h>
@@ -174,6 +175,10 @@ std::shared_ptr<Memory> Memory::CreateProcessMemory(pid_t pid) {
   return std::shared_ptr<Memory>(new MemoryRemote(pid));
 }
 
+std::shared_ptr<Memory> Memory::CreateProcessMemoryCached(pid_t pid) {
+  return std::shared_ptr<Memory>(new MemoryCache(CreateProcessMemory(pid)));
+}
+
 size_t MemoryBuffer::Read(uint64_t addr, void* dst, size_t size) {
   if (addr >= raw_.size()) {
     return 0;
@@ -289,10 +294,82 @@ size_t MemoryRemote::Read(uint64_t addr, void* dst, size_t size) {
   }
 }
 
+bool MemoryRemote::CheapBlockReads() {
+  return read_redirect_func_.load() == reinterpret_cast<uintptr_t>(ProcessVmRead);
+}
+
 size_t MemoryLocal::Read(uint64_t addr, void* dst, size_t size) {
   return ProcessVmRead(getpid(), addr, dst, size);
 }
 
+uint8_t* MemoryCache::GetBlock(uint64_t block) {
+  if (block == last_block_) {
+    return last_block_data_;
+  }
+  auto entry = cache_.find(block);
+  if (entry == cache_.end()) {
+    return nullptr;
+  }
+  last_block_ = block;
+  last_block_data_ = entry->second.data();
+  return last_block_data_;
+}
+
+bool MemoryCache::FillBlocks(uint64_t first_block, uint64_t last_block) {
+  constexpr size_t kMaxBlocks = 2;
+  static_assert(kMaxCachedReadSize <= kBlockSize, "A cached read spans more than two blocks.");
+
+  uint8_t buffer[kMaxBlocks * kBlockSize];
+  size_t num_blocks = last_block - first_block + 1;
+  CHECK(num_blocks <= kMaxBlocks);
+  size_t bytes = impl_->Read(first_block << kBlockBits, buffer, num_blocks * kBlockSize);
+  for (size_t i = 0; i < bytes / kBlockSize; i++) {
+    auto& data = cache_[first_block + i];
+    memcpy(data.data(), &buffer[i * kBlockSize], kBlockSize);
+  }
+  return bytes == num_blocks * kBlockSize;
+}
+
+size_t MemoryCache::Read(uint64_t addr, void* dst, size_t size) {
+  uint64_t last_addr;
+  if (size == 0 || size > kMaxCachedReadSize || !impl_->CheapBlockReads() ||
+      __builtin_add_overflow(addr, size - 1, &last_addr)) {
+    return impl_->Read(addr, dst, size);
+  }
+
+  std::lock_guard<std::mutex> guard(lock_);
+  uint64_t first_block = addr >> kBlockBits;
+  uint64_t last_block = last_addr >> kBlockBits;
+  uint8_t* first_data = GetBlock(first_block);
+  uint8_t* last_data = GetBlock(last_block);
+  if (first_data == nullptr || last_data == nullptr) {
+    uint64_t fill_first = first_data == nullptr ? first_block : last_block;
+    uint64_t fill_last = last_data == nullptr ? last_block : first_block;
+    if (!FillBlocks(fill_first, fill_last)) {
+      // Part of a block is not readable, read only what was asked for.
+      return impl_->Read(addr, dst, size);
+    }
+    first_data = GetBlock(first_block);
+    last_data = GetBlock(last_block);
+  }
+
+  uint8_t* out = reinterpret_cast<uint8_t*>(dst);
+  size_t offset = addr & (kBlockSize - 1);
+  size_t first_size = std::min(size, kBlockSize - offset);
+  memcpy(out, &first_data[offset], first_size);
+  if (first_size != size) {
+    memcpy(&out[first_size], last_data, size - first_size);
+  }
+  return size;
+}
+
+void MemoryCache::ClearCache() {
+  std::lock_guard<std::mutex> guard(lock_);
+  cache_.clear();
+  last_block_ = UINT64_MAX;
+  last_block_data_ = nullptr;
+}
+
 MemoryRange::MemoryRange(const std::shared_ptr<Memory>& memory, uint64_t begin, uint64_t length,
                          uint64_t offset)
     : memory_(memory), begin_(begin), length_(length), offset_(offset) {}
@@ -16,8 +16,12 @@
 
 #include <elf.h>
 #include <stdint.h>
+#include <string.h>
 
+#include <algorithm>
 #include <string>
+#include <utility>
+#include <vector>
 
 #include <unwindstack/Memory.h>
 
@@ -56,6 +60,15 @@ const Symbols::Info* Symbols::GetInfoFromCache(uint64_t addr) {
 template <typename SymType>
 bool Symbols::GetName(uint64_t addr, uint64_t load_bias, Memory* elf_memory, std::string* name,
                       uint64_t* func_offset) {
+  if (table_built_) {
+    const char* table_name;
+    if (!GetNameFromTable(addr, load_bias, &table_name, func_offset)) {
+      return false;
+    }
+    *name = table_name;
+    return true;
+  }
+
   addr += load_bias;
 
   if (symbols_.size() != 0) {
@@ -67,7 +80,7 @@ bool Symbols::GetName(uint64_t addr, uint64_t load_bias, Memory* elf_memory, std
     }
   }
 
-  bool symbol_added = false;
+  size_t sorted_size = symbols_.size();
   bool return_value = false;
   while (cur_offset_ + entry_size_ <= end_) {
     SymType entry;
@@ -88,7 +101,6 @@ bool Symbols::GetName(uint64_t addr, uint64_t load_bias, Memory* elf_memory, std
 
       // Cache the value.
       symbols_.emplace_back(start_offset, end_offset, str_offset_ + entry.st_name);
-      symbol_added = true;
 
       if (addr >= start_offset && addr < end_offset) {
         *func_offset = addr - start_offset;
@@ -101,13 +113,88 @@ bool Symbols::GetName(uint64_t addr, uint64_t load_bias, Memory* elf_memory, std
     }
   }
 
-  if (symbol_added) {
-    std::sort(symbols_.begin(), symbols_.end(),
-              [](const Info& a, const Info& b) { return a.start_offset < b.start_offset; });
+  if (symbols_.size() != sorted_size) {
+    // Only sort the new entries, then merge them into the sorted ones.
+    auto compare = [](const Info& a, const Info& b) { return a.start_offset < b.start_offset; };
+    std::sort(symbols_.begin() + sorted_size, symbols_.end(), compare);
+    std::inplace_merge(symbols_.begin(), symbols_.begin() + sorted_size, symbols_.end(), compare);
   }
   return return_value;
 }
 
+template <typename SymType>
+bool Symbols::BuildTable(uint64_t load_bias, Memory* elf_memory) {
+  if (table_built_) {
+    return true;
+  }
+  if (entry_size_ < sizeof(SymType) || end_ < offset_ || str_end_ < str_offset_) {
+    return false;
+  }
+
+  // The sizes come straight from the section headers, so make sure both
+  // sections are really there before allocating anything.
+  uint64_t size = end_ - offset_;
+  uint64_t str_size = str_end_ - str_offset_;
+  uint8_t last;
+  if ((size != 0 && !elf_memory->ReadFully(end_ - 1, &last, sizeof(last))) ||
+      (str_size != 0 && !elf_memory->ReadFully(str_end_ - 1, &last, sizeof(last)))) {
+    return false;
+  }
+
+  std::vector<uint8_t> entries(size);
+  std::vector<char> strings(str_size);
+  if (!elf_memory->ReadFully(offset_, entries.data(), size) ||
+      !elf_memory->ReadFully(str_offset_, strings.data(), str_size)) {
+    return false;
+  }
+
+  std::vector<Info> symbols;
+  for (uint64_t offset = 0; offset + entry_size_ <= size; offset += entry_size_) {
+    SymType entry;
+    memcpy(&entry, &entries[offset], sizeof(entry));
+    if (entry.st_shndx != SHN_UNDEF && ELF32_ST_TYPE(entry.st_info) == STT_FUNC) {
+      // Treat st_value as virtual address.
+      uint64_t start_offset = entry.st_value;
+      if (entry.st_shndx != SHN_ABS) {
+        start_offset += load_bias;
+      }
+      symbols.emplace_back(start_offset, start_offset + entry.st_size,
+                           str_offset_ + entry.st_name);
+    }
+  }
+  std::sort(symbols.begin(), symbols.end(),
+            [](const Info& a, const Info& b) { return a.start_offset < b.start_offset; });
+
+  symbols_ = std::move(symbols);
+  strings_ = std::move(strings);
+  cur_offset_ = end_;
+  table_built_ = true;
+  return true;
+}
+
+bool Symbols::GetNameFromTable(uint64_t addr, uint64_t load_bias, const char** name,
+                               uint64_t* func_offset) {
+  if (!table_built_) {
+    return false;
+  }
+
+  addr += load_bias;
+  const Info* info = GetInfoFromCache(addr);
+  if (info == nullptr) {
+    return false;
+  }
+  *func_offset = addr - info->start_offset;
+
+  // The name must be terminated inside of the string table.
+  uint64_t offset = info->str_offset - str_offset_;
+  if (offset >= strings_.size() ||
+      memchr(&strings_[offset], '\0', strings_.size() - offset) == nullptr) {
+    return false;
+  }
+  *name = &strings_[offset];
+  return true;
+}
+
 template <typename SymType>
 bool Symbols::GetGlobal(Memory* elf_memory, const std::string& name, uint64_t* memory_address) {
   uint64_t cur_offset = offset_;
@@ -139,4 +226,7 @@ template bool Symbols::GetName<Elf64_Sym>(uint64_t, uint64_t, Memory*, std::stri
 
 template bool Symbols::GetGlobal<Elf32_Sym>(Memory*, const std::string&, uint64_t*);
 template bool Symbols::GetGlobal<Elf64_Sym>(Memory*, const std::string&, uint64_t*);
+
+template bool Symbols::BuildTable<Elf32_Sym>(uint64_t, Memory*);
+template bool Symbols::BuildTable<Elf64_Sym>(uint64_t, Memory*);
 }  // namespace unwindstack
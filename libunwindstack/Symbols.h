@@ -50,8 +50,24 @@ class Symbols {
   template <typename SymType>
   bool GetGlobal(Memory* elf_memory, const std::string& name, uint64_t* memory_address);
 
+  // Reads the whole symbol table and its string table with one read each,
+  // and sorts all of the functions at once, instead of scanning the table
+  // one entry at a time as lookups miss. Returns false, leaving the table
+  // to be scanned lazily, if either section cannot be read.
+  template <typename SymType>
+  bool BuildTable(uint64_t load_bias, Memory* elf_memory);
+
+  // Only finds functions once BuildTable succeeded. The name points into the
+  // string table owned by this object.
+  bool GetNameFromTable(uint64_t addr, uint64_t load_bias, const char** name,
+                        uint64_t* func_offset);
+
+  bool table_built() { return table_built_; }
+
   void ClearCache() {
     symbols_.clear();
+    strings_.clear();
+    table_built_ = false;
     cur_offset_ = offset_;
   }
 
@@ -64,6 +80,9 @@ class Symbols {
   uint64_t str_end_;
 
   std::vector<Info> symbols_;
+
+  bool table_built_ = false;
+  std::vector<char> strings_;
 };
 
 }  // namespace unwindstack
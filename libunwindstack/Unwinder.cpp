@@ -23,6 +23,8 @@
 #include <unistd.h>
 
 #include <algorithm>
+#include <map>
+#include <utility>
 
 #include <android-base/stringprintf.h>
 
@@ -33,6 +35,16 @@
 
 namespace unwindstack {
 
+static void FillInMapData(FrameData* frame, MapInfo* map_info, Elf* elf) {
+  frame->pc = map_info->start + frame->rel_pc;
+  frame->map_name = map_info->name;
+  frame->map_offset = map_info->offset;
+  frame->map_start = map_info->start;
+  frame->map_end = map_info->end;
+  frame->map_flags = map_info->flags;
+  frame->map_load_bias = elf->GetLoadBias();
+}
+
 void Unwinder::FillInFrame(MapInfo* map_info, Elf* elf, uint64_t adjusted_rel_pc, uint64_t func_pc) {
   size_t frame_num = frames_.size();
   frames_.resize(frame_num + 1);
@@ -46,13 +58,7 @@ void Unwinder::FillInFrame(MapInfo* map_info, Elf* elf, uint64_t adjusted_rel_pc
     return;
   }
 
-  frame->pc = map_info->start + adjusted_rel_pc;
-  frame->map_name = map_info->name;
-  frame->map_offset = map_info->offset;
-  frame->map_start = map_info->start;
-  frame->map_end = map_info->end;
-  frame->map_flags = map_info->flags;
-  frame->map_load_bias = elf->GetLoadBias();
+  FillInMapData(frame, map_info, elf);
 
   if (!elf->GetFunctionName(func_pc, &frame->function_name, &frame->function_offset)) {
     frame->function_name = "";
@@ -77,15 +83,29 @@ static bool ShouldStop(const std::vector<std::string>* map_suffixes_to_ignore,
 void Unwinder::Unwind(const std::vector<std::string>* initial_map_names_to_skip,
                       const std::vector<std::string>* map_suffixes_to_ignore) {
   frames_.clear();
+  UnwindInternal(nullptr, max_frames_, initial_map_names_to_skip, map_suffixes_to_ignore);
+}
+
+size_t Unwinder::UnwindPcs(PcFrameData* pc_frames, size_t max_frames,
+                           const std::vector<std::string>* initial_map_names_to_skip,
+                           const std::vector<std::string>* map_suffixes_to_ignore) {
+  frames_.clear();
+  return UnwindInternal(pc_frames, max_frames, initial_map_names_to_skip, map_suffixes_to_ignore);
+}
 
+// When pc_frames is null, full frames are added to frames_ instead.
+size_t Unwinder::UnwindInternal(PcFrameData* pc_frames, size_t max_frames,
+                                const std::vector<std::string>* initial_map_names_to_skip,
+                                const std::vector<std::string>* map_suffixes_to_ignore) {
+  size_t num_frames = 0;
   bool return_address_attempt = false;
   bool adjust_pc = false;
-  std::unique_ptr<JitDebug> jit_debug;
-  for (; frames_.size() < max_frames_;) {
+  for (; num_frames < max_frames;) {
     uint64_t cur_pc = regs_->pc();
     uint64_t cur_sp = regs_->sp();
 
-    MapInfo* map_info = maps_->Find(regs_->pc());
+    size_t map_index;
+    MapInfo* map_info = maps_->Find(regs_->pc(), &map_index);
     uint64_t rel_pc;
     uint64_t adjusted_pc;
     uint64_t adjusted_rel_pc;
@@ -124,7 +144,23 @@ void Unwinder::Unwind(const std::vector<std::string>* initial_map_names_to_skip,
     if (map_info == nullptr || initial_map_names_to_skip == nullptr ||
         std::find(initial_map_names_to_skip->begin(), initial_map_names_to_skip->end(),
                   basename(map_info->name.c_str())) == initial_map_names_to_skip->end()) {
-      FillInFrame(map_info, elf, adjusted_rel_pc, adjusted_pc);
+      if (pc_frames == nullptr) {
+        FillInFrame(map_info, elf, adjusted_rel_pc, adjusted_pc);
+      } else {
+        PcFrameData* pc_frame = &pc_frames[num_frames];
+        pc_frame->rel_pc = adjusted_rel_pc;
+        pc_frame->sp = regs_->sp();
+        if (map_info == nullptr) {
+          pc_frame->pc = regs_->pc();
+          pc_frame->map_index = PcFrameData::kNoMap;
+          pc_frame->map_start = 0;
+        } else {
+          pc_frame->pc = map_info->start + adjusted_rel_pc;
+          pc_frame->map_index = map_index;
+          pc_frame->map_start = map_info->start;
+        }
+      }
+      num_frames++;
 
       // Once a frame is added, stop skipping frames.
       initial_map_names_to_skip = nullptr;
@@ -164,7 +200,10 @@ void Unwinder::Unwind(const std::vector<std::string>* initial_map_names_to_skip,
     if (!stepped) {
       if (return_address_attempt) {
         // Remove the speculative frame.
-        frames_.pop_back();
+        num_frames--;
+        if (pc_frames == nullptr) {
+          frames_.pop_back();
+        }
         break;
       } else if (in_device_map) {
         // Do not attempt any other unwinding, pc or sp is in a device
@@ -186,6 +225,59 @@ void Unwinder::Unwind(const std::vector<std::string>* initial_map_names_to_skip,
       break;
     }
   }
+  return num_frames;
+}
+
+void Unwinder::SymbolizeFrames(const PcFrameData* pc_frames, size_t num_frames,
+                               std::vector<FrameData>* frames) {
+  frames->clear();
+  frames->resize(num_frames);
+
+  // The frame that first looked up the function name for each elf and pc.
+  std::map<std::pair<Elf*, uint64_t>, size_t> symbolized;
+  for (size_t i = 0; i < num_frames; i++) {
+    const PcFrameData& pc_frame = pc_frames[i];
+    FrameData* frame = &frames->at(i);
+    frame->num = i;
+    frame->sp = pc_frame.sp;
+    frame->rel_pc = pc_frame.rel_pc;
+    frame->pc = pc_frame.pc;
+
+    if (pc_frame.map_index == PcFrameData::kNoMap) {
+      continue;
+    }
+    MapInfo* map_info = maps_->Get(pc_frame.map_index);
+    if (map_info == nullptr || map_info->start != pc_frame.map_start) {
+      // The maps were reparsed since the unwind.
+      map_info = maps_->Find(pc_frame.map_start);
+      if (map_info == nullptr || map_info->start != pc_frame.map_start) {
+        continue;
+      }
+    }
+
+    // Find the elf the same way as Unwind, including jit elfs, which are
+    // looked up by the non relative pc.
+    Elf* elf = map_info->GetElf(process_memory_, true);
+    uint64_t func_pc = pc_frame.rel_pc;
+    if (!elf->valid() && jit_debug_ != nullptr) {
+      Elf* jit_elf = jit_debug_->GetElf(maps_, pc_frame.pc);
+      if (jit_elf != nullptr) {
+        elf = jit_elf;
+        func_pc = pc_frame.pc;
+      }
+    }
+    FillInMapData(frame, map_info, elf);
+
+    auto entry = symbolized.emplace(std::make_pair(elf, func_pc), i);
+    if (!entry.second) {
+      const FrameData& symbolized_frame = frames->at(entry.first->second);
+      frame->function_name = symbolized_frame.function_name;
+      frame->function_offset = symbolized_frame.function_offset;
+    } else if (!elf->GetFunctionName(func_pc, &frame->function_name, &frame->function_offset)) {
+      frame->function_name = "";
+      frame->function_offset = 0;
+    }
+  }
 }
 
 std::string Unwinder::FormatFrame(size_t frame_num) {
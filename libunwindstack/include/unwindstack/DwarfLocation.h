@@ -20,6 +20,8 @@
 #include <stdint.h>
 
 #include <unordered_map>
+#include <utility>
+#include <vector>
 
 namespace unwindstack {
 
@@ -40,6 +42,21 @@ struct DwarfLocation {
 
 typedef std::unordered_map<uint16_t, DwarfLocation> dwarf_loc_regs_t;
 
+// The same locations as a dwarf_loc_regs_t in a flat array, for evaluating
+// them again and again. Registers numbered kMaxRegs or more are left out,
+// since no architecture has that many. Every register in the array has its
+// bit set in defined_regs.
+struct DwarfLocRegsFlat {
+  static constexpr uint16_t kMaxRegs = 64;
+
+  bool IsDefined(uint16_t reg) const { return reg < kMaxRegs && (defined_regs >> reg) & 1; }
+
+  bool has_cfa = false;
+  DwarfLocation cfa;
+  uint64_t defined_regs = 0;
+  std::vector<std::pair<uint16_t, DwarfLocation>> regs;
+};
+
 }  // namespace unwindstack
 
 #endif  // _LIBUNWINDSTACK_DWARF_LOCATION_H
@@ -78,6 +78,8 @@ class DwarfSection {
 
   virtual bool Eval(const DwarfCie*, Memory*, const dwarf_loc_regs_t&, Regs*, bool*) = 0;
 
+  virtual bool EvalFlat(const DwarfCie*, Memory*, const DwarfLocRegsFlat&, Regs*, bool*) = 0;
+
   virtual bool GetFdeOffsetFromPc(uint64_t pc, uint64_t* fde_offset) = 0;
 
   virtual bool Log(uint8_t indent, uint64_t pc, uint64_t load_bias, const DwarfFde* fde) = 0;
@@ -98,7 +100,20 @@ class DwarfSection {
 
   bool Step(uint64_t pc, Regs* regs, Memory* process_memory, bool* finished);
 
+  uint64_t step_cache_hits() { return step_cache_hits_; }
+  uint64_t step_cache_misses() { return step_cache_misses_; }
+
+  static void FlattenLocRegs(const dwarf_loc_regs_t& loc_regs, DwarfLocRegsFlat* flat);
+
  protected:
+  // The most pcs whose location rules are kept by Step.
+  static constexpr size_t kMaxStepCacheEntries = 1024;
+
+  struct StepCacheEntry {
+    const DwarfCie* cie;
+    DwarfLocRegsFlat loc_regs;
+  };
+
   DwarfMemory memory_;
   DwarfError last_error_;
 
@@ -109,6 +124,10 @@ class DwarfSection {
   std::unordered_map<uint64_t, DwarfFde> fde_entries_;
   std::unordered_map<uint64_t, DwarfCie> cie_entries_;
   std::unordered_map<uint64_t, dwarf_loc_regs_t> cie_loc_regs_;
+
+  std::unordered_map<uint64_t, StepCacheEntry> step_cache_;
+  uint64_t step_cache_hits_ = 0;
+  uint64_t step_cache_misses_ = 0;
 };
 
 template <typename AddressType>
@@ -135,6 +154,9 @@ class DwarfSectionImpl : public DwarfSection {
   bool Eval(const DwarfCie* cie, Memory* regular_memory, const dwarf_loc_regs_t& loc_regs,
             Regs* regs, bool* finished) override;
 
+  bool EvalFlat(const DwarfCie* cie, Memory* regular_memory, const DwarfLocRegsFlat& loc_regs,
+                Regs* regs, bool* finished) override;
+
   const DwarfCie* GetCie(uint64_t offset);
   bool FillInCie(DwarfCie* cie);
 
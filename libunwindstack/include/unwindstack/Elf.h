@@ -59,6 +59,17 @@ class Elf {
 
   bool GetFunctionName(uint64_t addr, std::string* name, uint64_t* func_offset);
 
+  // Reads the symbol tables with one read each, instead of scanning them an
+  // entry at a time as lookups miss. This makes the first lookups of a large
+  // library much faster, at the cost of keeping its string tables in memory.
+  // Returns false if any table could not be read at once, lookups in that
+  // one still work through GetFunctionName, but not GetFunctionNameFromTable.
+  bool InitSymbolTables();
+
+  // Like GetFunctionName, but returns a name owned by this object instead of
+  // copying it. Only finds functions once InitSymbolTables has been called.
+  bool GetFunctionNameFromTable(uint64_t addr, const char** name, uint64_t* func_offset);
+
   bool GetGlobalVariable(const std::string& name, uint64_t* memory_address);
 
   uint64_t GetRelPc(uint64_t pc, const MapInfo* map_info);
@@ -66,6 +77,10 @@ class Elf {
   bool Step(uint64_t rel_pc, uint64_t adjusted_rel_pc, uint64_t elf_offset, Regs* regs,
             Memory* process_memory, bool* finished);
 
+  // Sums how often the steps through the dwarf sections of this elf found
+  // the location rules of the pc already cached.
+  void GetStepCacheStats(uint64_t* hits, uint64_t* misses);
+
   ElfInterface* CreateInterfaceFromMemory(Memory* memory);
 
   uint64_t GetLoadBias() { return load_bias_; }
@@ -86,6 +101,9 @@ class Elf {
 
   ElfInterface* gnu_debugdata_interface() { return gnu_debugdata_interface_.get(); }
 
+  // The size of the decompressed .gnu_debugdata, zero if it is not initialized.
+  uint64_t gnu_debugdata_memory_size() { return gnu_debugdata_memory_size_; }
+
   static bool IsValidElf(Memory* memory);
 
   static void GetInfo(Memory* memory, bool* valid, uint64_t* size);
@@ -104,6 +122,7 @@ class Elf {
   std::mutex lock_;
 
   std::unique_ptr<Memory> gnu_debugdata_memory_;
+  uint64_t gnu_debugdata_memory_size_ = 0;
   std::unique_ptr<ElfInterface> gnu_debugdata_interface_;
 };
 
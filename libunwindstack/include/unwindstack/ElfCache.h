@@ -0,0 +1,69 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _LIBUNWINDSTACK_ELF_CACHE_H
+#define _LIBUNWINDSTACK_ELF_CACHE_H
+
+#include <stdint.h>
+
+#include <memory>
+#include <string>
+
+namespace unwindstack {
+
+// Forward declarations.
+class Elf;
+
+// A process wide cache of the Elf objects created for files, shared by every
+// MapInfo, including those of different Maps. A tool that unwinds many
+// processes then only parses each library, and builds its symbol table and
+// fde index, once. The cache is off by default.
+class ElfCache {
+ public:
+  struct Stats {
+    size_t entries = 0;
+    // The file data mapped, and any .gnu_debugdata decompressed, by the
+    // cached Elf objects.
+    uint64_t bytes = 0;
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+    uint64_t evictions = 0;
+  };
+
+  // Turning the cache off drops every Elf that no MapInfo is using.
+  static void SetEnabled(bool enabled);
+  static bool Enabled();
+
+  // Once the cached Elf objects use more than max_bytes, the least recently
+  // used ones that no MapInfo is using are dropped.
+  static void SetMaxBytes(uint64_t max_bytes);
+
+  static Stats GetStats();
+
+  // Returns the Elf cached for key, or nullptr.
+  static std::shared_ptr<Elf> Find(const std::string& key, uint64_t* elf_offset);
+
+  // Returns the Elf to use for key, which is a different one than elf if
+  // another thread added one first.
+  static std::shared_ptr<Elf> Add(const std::string& key, std::shared_ptr<Elf> elf,
+                                  uint64_t elf_offset, uint64_t bytes);
+
+  static constexpr uint64_t kDefaultMaxBytes = 256 * 1024 * 1024;
+};
+
+}  // namespace unwindstack
+
+#endif  // _LIBUNWINDSTACK_ELF_CACHE_H
@@ -31,6 +31,7 @@ namespace unwindstack {
 
 // Forward declarations.
 class Memory;
+class MemoryBuffer;
 class Regs;
 class Symbols;
 
@@ -62,12 +63,20 @@ class ElfInterface {
 
   virtual bool GetGlobalVariable(const std::string& name, uint64_t* memory_address) = 0;
 
+  // Reads all of the symbol tables up front, see Symbols::BuildTable.
+  // Returns false if any of them could not be read.
+  virtual bool InitSymbolTables(uint64_t) { return false; }
+
+  // Only finds functions in the symbol tables built by InitSymbolTables.
+  bool GetFunctionNameFromTable(uint64_t addr, uint64_t load_bias, const char** name,
+                                uint64_t* func_offset);
+
   virtual bool Step(uint64_t rel_pc, uint64_t load_bias, Regs* regs, Memory* process_memory,
                     bool* finished);
 
   virtual bool IsValidPc(uint64_t pc);
 
-  Memory* CreateGnuDebugdataMemory();
+  MemoryBuffer* CreateGnuDebugdataMemory();
 
   Memory* memory() { return memory_; }
 
@@ -116,6 +125,9 @@ class ElfInterface {
   template <typename SymType>
   bool GetGlobalVariableWithTemplate(const std::string& name, uint64_t* memory_address);
 
+  template <typename SymType>
+  bool InitSymbolTablesWithTemplate(uint64_t load_bias);
+
   virtual bool HandleType(uint64_t, uint32_t, uint64_t) { return false; }
 
   template <typename EhdrType>
@@ -176,6 +188,10 @@ class ElfInterface32 : public ElfInterface {
     return ElfInterface::GetGlobalVariableWithTemplate<Elf32_Sym>(name, memory_address);
   }
 
+  bool InitSymbolTables(uint64_t load_bias) override {
+    return ElfInterface::InitSymbolTablesWithTemplate<Elf32_Sym>(load_bias);
+  }
+
   static void GetMaxSize(Memory* memory, uint64_t* size) {
     GetMaxSizeWithTemplate<Elf32_Ehdr>(memory, size);
   }
@@ -205,6 +221,10 @@ class ElfInterface64 : public ElfInterface {
     return ElfInterface::GetGlobalVariableWithTemplate<Elf64_Sym>(name, memory_address);
   }
 
+  bool InitSymbolTables(uint64_t load_bias) override {
+    return ElfInterface::InitSymbolTablesWithTemplate<Elf64_Sym>(load_bias);
+  }
+
   static void GetMaxSize(Memory* memory, uint64_t* size) {
     GetMaxSizeWithTemplate<Elf64_Ehdr>(memory, size);
   }
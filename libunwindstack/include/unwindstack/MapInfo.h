@@ -20,6 +20,7 @@
 #include <stdint.h>
 
 #include <atomic>
+#include <memory>
 #include <mutex>
 #include <string>
 
@@ -29,6 +30,7 @@ namespace unwindstack {
 
 // Forward declarations.
 class Memory;
+class MemoryFileAtOffset;
 
 struct MapInfo {
   MapInfo() = default;
@@ -40,14 +42,21 @@ struct MapInfo {
         flags(flags),
         name(name),
         load_bias(static_cast<uint64_t>(-1)) {}
-  ~MapInfo() { delete elf; }
+  ~MapInfo() {
+    if (shared_elf_ == nullptr) {
+      delete elf;
+    }
+  }
 
   uint64_t start = 0;
   uint64_t end = 0;
   uint64_t offset = 0;
   uint16_t flags = 0;
   std::string name;
-  Elf* elf = nullptr;
+  // Once set, this never changes, so it can be read without the lock.
+  // When the ElfCache is enabled, this may be shared with other MapInfo
+  // objects of the same file, in this or any other Maps.
+  std::atomic<Elf*> elf{nullptr};
   // This value is only non-zero if the offset is non-zero but there is
   // no elf signature found at that offset. This indicates that the
   // entire file is represented by the Memory object returned by CreateMemory,
@@ -65,12 +74,22 @@ struct MapInfo {
   MapInfo(const MapInfo&) = delete;
   void operator=(const MapInfo&) = delete;
 
-  Memory* GetFileMemory();
+  MemoryFileAtOffset* GetFileMemory();
 
-  Memory* CreateMemory(const std::shared_ptr<Memory>& process_memory);
+  // If the memory is backed by the file of the map, file_size is set to the
+  // number of bytes of the file mapped, otherwise it is set to zero.
+  Memory* CreateMemory(const std::shared_ptr<Memory>& process_memory,
+                       uint64_t* file_size = nullptr);
+
+  // Identifies the file contents this map would create an elf from, or
+  // returns an empty string if the elf cannot be shared.
+  std::string GetElfCacheKey(bool init_gnu_debugdata);
 
   // Protect the creation of the elf object.
   std::mutex mutex_;
+
+  // Holds the elf when it came from the ElfCache.
+  std::shared_ptr<Elf> shared_elf_;
 };
 
 }  // namespace unwindstack
@@ -20,6 +20,7 @@
 #include <sys/types.h>
 #include <unistd.h>
 
+#include <atomic>
 #include <string>
 #include <vector>
 
@@ -36,10 +37,17 @@ class Maps {
   Maps() = default;
   virtual ~Maps();
 
-  MapInfo* Find(uint64_t pc);
+  // If map_index is not null, it is set to the index of the map found.
+  MapInfo* Find(uint64_t pc, size_t* map_index = nullptr);
 
   virtual bool Parse();
 
+  // Reads the maps file again, keeping the MapInfo, and so the Elf object,
+  // of every map that has not changed. Nothing is parsed if the file is the
+  // same as on the last call. Like Parse, this must not be called while
+  // another thread is using the maps.
+  bool Reparse(bool* any_changed = nullptr);
+
   virtual const std::string GetMapsFile() const { return ""; }
 
   void Add(uint64_t start, uint64_t end, uint64_t offset, uint64_t flags, const std::string& name,
@@ -61,7 +69,15 @@ class Maps {
   }
 
  protected:
+  static bool ParseBuffer(const char* buffer, std::vector<MapInfo*>* maps);
+
   std::vector<MapInfo*> maps_;
+
+ private:
+  // The index of the map last returned by Find, since consecutive lookups
+  // usually land in the same map.
+  std::atomic<size_t> last_find_index_{0};
+  std::string last_maps_data_;
 };
 
 class RemoteMaps : public Maps {
@@ -21,9 +21,12 @@
 #include <sys/types.h>
 #include <unistd.h>
 
+#include <array>
 #include <atomic>
 #include <memory>
+#include <mutex>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 namespace unwindstack {
@@ -34,11 +37,20 @@ class Memory {
   virtual ~Memory() = default;
 
   static std::shared_ptr<Memory> CreateProcessMemory(pid_t pid);
+  // The returned memory caches what it reads, see MemoryCache.
+  static std::shared_ptr<Memory> CreateProcessMemoryCached(pid_t pid);
 
   virtual bool ReadString(uint64_t addr, std::string* string, uint64_t max_read = UINT64_MAX);
 
   virtual size_t Read(uint64_t addr, void* dst, size_t size) = 0;
 
+  // Drops any data cached from earlier reads.
+  virtual void ClearCache() {}
+
+  // Whether reading a whole block costs about as much as reading a few bytes
+  // of it. MemoryCache only reads whole blocks when it does.
+  virtual bool CheapBlockReads() { return true; }
+
   bool ReadFully(uint64_t addr, void* dst, size_t size);
 
   inline bool ReadField(uint64_t addr, void* start, void* field, size_t size) {
@@ -105,6 +117,9 @@ class MemoryRemote : public Memory {
 
   size_t Read(uint64_t addr, void* dst, size_t size) override;
 
+  // Only once process_vm_readv is known to work, ptrace reads a word at a time.
+  bool CheapBlockReads() override;
+
   pid_t pid() { return pid_; }
 
  private:
@@ -120,6 +135,42 @@ class MemoryLocal : public Memory {
   size_t Read(uint64_t addr, void* dst, size_t size) override;
 };
 
+// MemoryCache reads the underlying memory in blocks, and keeps the blocks
+// so that the many small reads of an unwind, from the dwarf evaluator, elf
+// headers and stack, cost one read of the process per block instead of one
+// per value. When a read needs several blocks that are not cached, they are
+// all fetched with a single read, which process_vm_readv does with one
+// syscall. If the underlying memory doesn't have CheapBlockReads(), as with
+// ptrace, every read goes straight through instead. The cached data goes
+// stale once the process runs again, so call ClearCache() at the start of
+// every unwind session.
+class MemoryCache : public Memory {
+ public:
+  MemoryCache(const std::shared_ptr<Memory>& memory) : impl_(memory) {}
+  virtual ~MemoryCache() = default;
+
+  size_t Read(uint64_t addr, void* dst, size_t size) override;
+
+  void ClearCache() override;
+
+  static constexpr size_t kBlockBits = 12;
+  static constexpr size_t kBlockSize = 1 << kBlockBits;
+  // Larger reads go straight to the underlying memory.
+  static constexpr size_t kMaxCachedReadSize = 64;
+
+ private:
+  uint8_t* GetBlock(uint64_t block);
+  bool FillBlocks(uint64_t first_block, uint64_t last_block);
+
+  std::shared_ptr<Memory> impl_;
+
+  std::mutex lock_;
+  std::unordered_map<uint64_t, std::array<uint8_t, kBlockSize>> cache_;
+  // Consecutive reads usually hit the same block.
+  uint64_t last_block_ = UINT64_MAX;
+  uint8_t* last_block_data_ = nullptr;
+};
+
 // MemoryRange maps one address range onto another.
 // The range [src_begin, src_begin + length) in the underlying Memory is mapped onto offset,
 // such that range.read(offset) is equivalent to underlying.read(src_begin).
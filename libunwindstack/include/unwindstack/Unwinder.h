@@ -53,6 +53,22 @@ struct FrameData {
   int map_flags;
 };
 
+// A frame recorded by Unwinder::UnwindPcs, enough to create the FrameData
+// later with Unwinder::SymbolizeFrames.
+struct PcFrameData {
+  uint64_t rel_pc;
+  uint64_t pc;
+  uint64_t sp;
+
+  // The index of the map in Maps, or kNoMap if the pc is not in any map.
+  size_t map_index;
+  // The start of that map. Maps::Reparse can move or drop maps, so the
+  // index is only trusted while the map there still starts here.
+  uint64_t map_start;
+
+  static constexpr size_t kNoMap = static_cast<size_t>(-1);
+};
+
 class Unwinder {
  public:
   Unwinder(size_t max_frames, Maps* maps, Regs* regs, std::shared_ptr<Memory> process_memory)
@@ -64,6 +80,22 @@ class Unwinder {
   void Unwind(const std::vector<std::string>* initial_map_names_to_skip = nullptr,
               const std::vector<std::string>* map_suffixes_to_ignore = nullptr);
 
+  // Records only the pc, sp and map of each frame into pc_frames, without
+  // looking up function names or allocating. Returns the number of frames.
+  size_t UnwindPcs(PcFrameData* pc_frames, size_t max_frames,
+                   const std::vector<std::string>* initial_map_names_to_skip = nullptr,
+                   const std::vector<std::string>* map_suffixes_to_ignore = nullptr);
+
+  // Creates the FrameData for each of the pc_frames, as Unwind would have.
+  // The pc_frames can come from any number of calls to UnwindPcs using the
+  // same maps; the function name of each distinct pc is only looked up once.
+  // The num of each frame is its index in pc_frames.
+  // The maps may have been reparsed since the unwinds. Each frame is then
+  // matched to its map by start address, and gets no map data if no map
+  // starts there any more.
+  void SymbolizeFrames(const PcFrameData* pc_frames, size_t num_frames,
+                       std::vector<FrameData>* frames);
+
   size_t NumFrames() { return frames_.size(); }
 
   const std::vector<FrameData>& frames() { return frames_; }
@@ -74,6 +106,10 @@ class Unwinder {
   void SetJitDebug(JitDebug* jit_debug, ArchEnum arch);
 
  private:
+  size_t UnwindInternal(PcFrameData* pc_frames, size_t max_frames,
+                        const std::vector<std::string>* initial_map_names_to_skip,
+                        const std::vector<std::string>* map_suffixes_to_ignore);
+
   void FillInFrame(MapInfo* map_info, Elf* elf, uint64_t adjusted_rel_pc, uint64_t adjusted_pc);
 
   size_t max_frames_;
@@ -34,6 +34,9 @@ class MockDwarfSection : public DwarfSection {
 
   MOCK_METHOD5(Eval, bool(const DwarfCie*, Memory*, const dwarf_loc_regs_t&, Regs*, bool*));
 
+  MOCK_METHOD5(EvalFlat,
+               bool(const DwarfCie*, Memory*, const DwarfLocRegsFlat&, Regs*, bool*));
+
   MOCK_METHOD3(GetCfaLocationInfo, bool(uint64_t, const DwarfFde*, dwarf_loc_regs_t*));
 
   MOCK_METHOD2(Init, bool(uint64_t, uint64_t));
@@ -158,11 +161,106 @@ TEST_F(DwarfSectionTest, Step_pass) {
       .WillOnce(::testing::Return(true));
 
   MemoryFake process;
-  EXPECT_CALL(mock_section, Eval(&cie, &process, ::testing::_, nullptr, ::testing::_))
+  EXPECT_CALL(mock_section, EvalFlat(&cie, &process, ::testing::_, nullptr, ::testing::_))
       .WillOnce(::testing::Return(true));
 
   bool finished;
   ASSERT_TRUE(mock_section.Step(0x1000, nullptr, &process, &finished));
 }
 
+static bool MockGetCfaLocationInfo(::testing::Unused, const DwarfFde*, dwarf_loc_regs_t* loc_regs) {
+  (*loc_regs)[CFA_REG] = DwarfLocation{DWARF_LOCATION_REGISTER, {4, 8}};
+  (*loc_regs)[2] = DwarfLocation{DWARF_LOCATION_OFFSET, {0x10, 0}};
+  return true;
+}
+
+TEST_F(DwarfSectionTest, Step_cache) {
+  MockDwarfSection mock_section(&memory_);
+
+  DwarfCie cie{};
+  DwarfFde fde{};
+  fde.pc_end = 0x2000;
+  fde.cie = &cie;
+
+  // Only the first step at a pc looks up the location rules.
+  EXPECT_CALL(mock_section, GetFdeOffsetFromPc(0x1000, ::testing::_))
+      .WillOnce(::testing::Return(true));
+  EXPECT_CALL(mock_section, GetFdeFromOffset(::testing::_)).WillOnce(::testing::Return(&fde));
+  EXPECT_CALL(mock_section, GetCfaLocationInfo(0x1000, &fde, ::testing::_))
+      .WillOnce(::testing::Invoke(MockGetCfaLocationInfo));
+
+  // Every step, the first one included, evaluates the flattened rules.
+  MemoryFake process;
+  DwarfLocRegsFlat loc_regs;
+  EXPECT_CALL(mock_section, Eval(::testing::_, ::testing::_, ::testing::_, ::testing::_,
+                                 ::testing::_))
+      .Times(0);
+  EXPECT_CALL(mock_section, EvalFlat(&cie, &process, ::testing::_, nullptr, ::testing::_))
+      .Times(3)
+      .WillRepeatedly(::testing::DoAll(::testing::SaveArg<2>(&loc_regs), ::testing::Return(true)));
+
+  bool finished;
+  ASSERT_TRUE(mock_section.Step(0x1000, nullptr, &process, &finished));
+  EXPECT_EQ(0U, mock_section.step_cache_hits());
+  EXPECT_EQ(1U, mock_section.step_cache_misses());
+
+  ASSERT_TRUE(mock_section.Step(0x1000, nullptr, &process, &finished));
+  ASSERT_TRUE(mock_section.Step(0x1000, nullptr, &process, &finished));
+  EXPECT_EQ(2U, mock_section.step_cache_hits());
+  EXPECT_EQ(1U, mock_section.step_cache_misses());
+
+  ASSERT_TRUE(loc_regs.has_cfa);
+  EXPECT_EQ(DWARF_LOCATION_REGISTER, loc_regs.cfa.type);
+  EXPECT_EQ(4U, loc_regs.cfa.values[0]);
+  EXPECT_EQ(8U, loc_regs.cfa.values[1]);
+  EXPECT_EQ(1U << 2, loc_regs.defined_regs);
+  ASSERT_EQ(1U, loc_regs.regs.size());
+  EXPECT_EQ(2U, loc_regs.regs[0].first);
+  EXPECT_EQ(DWARF_LOCATION_OFFSET, loc_regs.regs[0].second.type);
+  EXPECT_EQ(0x10U, loc_regs.regs[0].second.values[0]);
+}
+
+TEST_F(DwarfSectionTest, Step_cache_not_filled_on_failure) {
+  MockDwarfSection mock_section(&memory_);
+
+  DwarfCie cie{};
+  DwarfFde fde{};
+  fde.pc_end = 0x2000;
+  fde.cie = &cie;
+
+  EXPECT_CALL(mock_section, GetFdeOffsetFromPc(0x1000, ::testing::_))
+      .Times(2)
+      .WillRepeatedly(::testing::Return(true));
+  EXPECT_CALL(mock_section, GetFdeFromOffset(::testing::_))
+      .Times(2)
+      .WillRepeatedly(::testing::Return(&fde));
+  EXPECT_CALL(mock_section, GetCfaLocationInfo(0x1000, &fde, ::testing::_))
+      .Times(2)
+      .WillRepeatedly(::testing::Return(false));
+
+  bool finished;
+  ASSERT_FALSE(mock_section.Step(0x1000, nullptr, nullptr, &finished));
+  ASSERT_FALSE(mock_section.Step(0x1000, nullptr, nullptr, &finished));
+  EXPECT_EQ(0U, mock_section.step_cache_hits());
+  EXPECT_EQ(2U, mock_section.step_cache_misses());
+}
+
+TEST_F(DwarfSectionTest, FlattenLocRegs) {
+  dwarf_loc_regs_t loc_regs;
+  loc_regs[63] = DwarfLocation{DWARF_LOCATION_VAL_OFFSET, {0x20, 0}};
+  loc_regs[64] = DwarfLocation{DWARF_LOCATION_OFFSET, {0x30, 0}};
+  loc_regs[0] = DwarfLocation{DWARF_LOCATION_UNDEFINED, {0, 0}};
+
+  DwarfLocRegsFlat flat;
+  DwarfSection::FlattenLocRegs(loc_regs, &flat);
+  EXPECT_FALSE(flat.has_cfa);
+  EXPECT_EQ((1ULL << 63) | 1, flat.defined_regs);
+  EXPECT_EQ(2U, flat.regs.size());
+  EXPECT_TRUE(flat.IsDefined(0));
+  EXPECT_TRUE(flat.IsDefined(63));
+  EXPECT_FALSE(flat.IsDefined(1));
+  EXPECT_FALSE(flat.IsDefined(64));
+  EXPECT_FALSE(flat.IsDefined(CFA_REG));
+}
+
 }  // namespace unwindstack
@@ -0,0 +1,170 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <elf.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <memory>
+
+#include <android-base/file.h>
+#include <android-base/test_utils.h>
+#include <gtest/gtest.h>
+
+#include <unwindstack/Elf.h>
+#include <unwindstack/ElfCache.h>
+#include <unwindstack/MapInfo.h>
+#include <unwindstack/Memory.h>
+
+#include "ElfTestUtils.h"
+#include "MemoryFake.h"
+
+namespace unwindstack {
+
+class ElfCacheTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    memory_ = new MemoryFake;
+    process_memory_.reset(memory_);
+
+    WriteElf(elf_.fd);
+    WriteElf(other_elf_.fd);
+
+    ElfCache::SetEnabled(true);
+    ElfCache::SetMaxBytes(ElfCache::kDefaultMaxBytes);
+  }
+
+  void TearDown() override { ElfCache::SetEnabled(false); }
+
+  static void WriteElf(int fd) {
+    Elf32_Ehdr ehdr;
+    TestInitEhdr<Elf32_Ehdr>(&ehdr, ELFCLASS32, EM_ARM);
+    ASSERT_TRUE(android::base::WriteFully(fd, &ehdr, sizeof(ehdr)));
+  }
+
+  std::shared_ptr<Memory> process_memory_;
+  MemoryFake* memory_;
+
+  TemporaryFile elf_;
+  TemporaryFile other_elf_;
+};
+
+TEST_F(ElfCacheTest, disabled) {
+  ElfCache::SetEnabled(false);
+
+  MapInfo info1(0x1000, 0x2000, 0, PROT_READ, elf_.path);
+  MapInfo info2(0x5000, 0x6000, 0, PROT_READ, elf_.path);
+  Elf* elf1 = info1.GetElf(process_memory_, false);
+  Elf* elf2 = info2.GetElf(process_memory_, false);
+  ASSERT_TRUE(elf1->valid());
+  ASSERT_TRUE(elf2->valid());
+  EXPECT_NE(elf1, elf2);
+  EXPECT_EQ(0U, ElfCache::GetStats().entries);
+}
+
+TEST_F(ElfCacheTest, shared) {
+  ElfCache::Stats before = ElfCache::GetStats();
+
+  std::unique_ptr<MapInfo> info1(new MapInfo(0x1000, 0x2000, 0, PROT_READ, elf_.path));
+  std::unique_ptr<MapInfo> info2(new MapInfo(0x5000, 0x6000, 0, PROT_READ, elf_.path));
+  Elf* elf1 = info1->GetElf(process_memory_, false);
+  Elf* elf2 = info2->GetElf(process_memory_, false);
+  ASSERT_TRUE(elf1->valid());
+  EXPECT_EQ(elf1, elf2);
+  EXPECT_EQ(static_cast<uint32_t>(EM_ARM), elf2->machine_type());
+
+  ElfCache::Stats stats = ElfCache::GetStats();
+  EXPECT_EQ(1U, stats.entries);
+  EXPECT_EQ(sizeof(Elf32_Ehdr), stats.bytes);
+  EXPECT_EQ(before.hits + 1, stats.hits);
+  EXPECT_EQ(before.misses + 1, stats.misses);
+
+  // The elf outlives the first map that used it.
+  info1.reset();
+  EXPECT_EQ(static_cast<uint32_t>(EM_ARM), elf2->machine_type());
+  info2.reset();
+
+  ElfCache::SetEnabled(false);
+  EXPECT_EQ(0U, ElfCache::GetStats().entries);
+}
+
+TEST_F(ElfCacheTest, different_offset_not_shared) {
+  MapInfo info1(0x1000, 0x2000, 0, PROT_READ, elf_.path);
+  MapInfo info2(0x5000, 0x6000, 0x1000, PROT_READ, elf_.path);
+  EXPECT_NE(info1.GetElf(process_memory_, false), info2.GetElf(process_memory_, false));
+}
+
+TEST_F(ElfCacheTest, gnu_debugdata_not_shared) {
+  MapInfo info1(0x1000, 0x2000, 0, PROT_READ, elf_.path);
+  MapInfo info2(0x5000, 0x6000, 0, PROT_READ, elf_.path);
+  EXPECT_NE(info1.GetElf(process_memory_, false), info2.GetElf(process_memory_, true));
+}
+
+TEST_F(ElfCacheTest, file_changed) {
+  MapInfo info1(0x1000, 0x2000, 0, PROT_READ, elf_.path);
+  Elf* elf1 = info1.GetElf(process_memory_, false);
+  ASSERT_TRUE(elf1->valid());
+
+  uint8_t data[16] = {};
+  ASSERT_TRUE(android::base::WriteFully(elf_.fd, data, sizeof(data)));
+
+  MapInfo info2(0x1000, 0x2000, 0, PROT_READ, elf_.path);
+  Elf* elf2 = info2.GetElf(process_memory_, false);
+  ASSERT_TRUE(elf2->valid());
+  EXPECT_NE(elf1, elf2);
+  EXPECT_EQ(2U, ElfCache::GetStats().entries);
+}
+
+TEST_F(ElfCacheTest, process_memory_not_cached) {
+  MapInfo info(0x3000, 0x4000, 0, PROT_READ, "");
+
+  Elf32_Ehdr ehdr;
+  TestInitEhdr<Elf32_Ehdr>(&ehdr, ELFCLASS32, EM_ARM);
+  memory_->SetMemory(0x3000, &ehdr, sizeof(ehdr));
+
+  ASSERT_TRUE(info.GetElf(process_memory_, false)->valid());
+  EXPECT_EQ(0U, ElfCache::GetStats().entries);
+}
+
+TEST_F(ElfCacheTest, evict_unused) {
+  ElfCache::SetMaxBytes(sizeof(Elf32_Ehdr));
+  ElfCache::Stats before = ElfCache::GetStats();
+
+  std::unique_ptr<MapInfo> info1(new MapInfo(0x1000, 0x2000, 0, PROT_READ, elf_.path));
+  ASSERT_TRUE(info1->GetElf(process_memory_, false)->valid());
+
+  // An elf still in use is never dropped, even if the cache is over its limit.
+  MapInfo info2(0x5000, 0x6000, 0, PROT_READ, other_elf_.path);
+  ASSERT_TRUE(info2.GetElf(process_memory_, false)->valid());
+  ElfCache::Stats stats = ElfCache::GetStats();
+  EXPECT_EQ(2U, stats.entries);
+  EXPECT_EQ(2 * sizeof(Elf32_Ehdr), stats.bytes);
+  EXPECT_EQ(before.evictions, stats.evictions);
+
+  info1.reset();
+  ElfCache::SetMaxBytes(sizeof(Elf32_Ehdr));
+  stats = ElfCache::GetStats();
+  EXPECT_EQ(1U, stats.entries);
+  EXPECT_EQ(sizeof(Elf32_Ehdr), stats.bytes);
+  EXPECT_EQ(before.evictions + 1, stats.evictions);
+
+  // The dropped elf is created again.
+  MapInfo info3(0x1000, 0x2000, 0, PROT_READ, elf_.path);
+  ASSERT_TRUE(info3.GetElf(process_memory_, false)->valid());
+  EXPECT_EQ(before.misses + 3, ElfCache::GetStats().misses);
+}
+
+}  // namespace unwindstack
@@ -81,6 +81,7 @@ class ElfInterfaceFake : public ElfInterface {
 
   static void FakePushFunctionData(const FunctionData data) { functions_.push_back(data); }
   static void FakePushStepData(const StepData data) { steps_.push_back(data); }
+  static size_t FakeGetFunctionDataCount() { return functions_.size(); }
 
   static void FakeClear() {
     functions_.clear();
@@ -844,6 +844,15 @@ void ElfInterfaceTest::InitSectionHeaders(uint64_t entry_size) {
   ASSERT_TRUE(elf->GetFunctionName(0xd0020, 0, &name, &name_offset));
   EXPECT_EQ("function_two", name);
   EXPECT_EQ(32U, name_offset);
+
+  // Most of the tables is unreadable, so they can't be read at once, but
+  // lookups still work.
+  ASSERT_FALSE(elf->InitSymbolTables(0));
+  const char* table_name;
+  ASSERT_FALSE(elf->GetFunctionNameFromTable(0x90010, 0, &table_name, &name_offset));
+  ASSERT_TRUE(elf->GetFunctionName(0x90010, 0, &name, &name_offset));
+  EXPECT_EQ("function_one", name);
+  EXPECT_EQ(16U, name_offset);
 }
 
 TEST_F(ElfInterfaceTest, init_section_headers32) {
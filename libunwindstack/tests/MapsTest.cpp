@@ -596,4 +596,87 @@ TEST(MapsTest, find) {
   EXPECT_EQ("/system/lib/fake5.so", info->name);
 }
 
+TEST(MapsTest, find_repeated) {
+  BufferMaps maps(
+      "1000-2000 r--p 00000010 00:00 0 /system/lib/fake1.so\n"
+      "3000-4000 -w-p 00000020 00:00 0 /system/lib/fake2.so\n"
+      "6000-8000 --xp 00000030 00:00 0 /system/lib/fake3.so\n");
+  ASSERT_TRUE(maps.Parse());
+
+  // Make sure looking up the map found last does not hide other maps.
+  for (size_t i = 0; i < 2; i++) {
+    MapInfo* info = maps.Find(0x6020);
+    ASSERT_TRUE(info != nullptr);
+    EXPECT_EQ(0x6000U, info->start);
+    EXPECT_TRUE(maps.Find(0x5010) == nullptr);
+    EXPECT_EQ(info, maps.Find(0x7fff));
+    info = maps.Find(0x1000);
+    ASSERT_TRUE(info != nullptr);
+    EXPECT_EQ(0x1000U, info->start);
+    EXPECT_TRUE(maps.Find(0x2000) == nullptr);
+    info = maps.Find(0x3fff);
+    ASSERT_TRUE(info != nullptr);
+    EXPECT_EQ(0x3000U, info->start);
+  }
+}
+
+TEST(MapsTest, reparse) {
+  TemporaryFile tf;
+  ASSERT_TRUE(tf.fd != -1);
+
+  ASSERT_TRUE(
+      android::base::WriteStringToFile("1000-2000 r-xp 00000000 00:00 0   /fake.so\n"
+                                       "3000-4000 r-xp 00000000 00:00 0   /fake2.so\n"
+                                       "5000-6000 r-xp 00000000 00:00 0   /fake3.so\n",
+                                       tf.path, 0660, getuid(), getgid()));
+
+  FileMaps maps(tf.path);
+  ASSERT_TRUE(maps.Parse());
+  ASSERT_EQ(3U, maps.Total());
+  MapInfo* info1 = maps.Get(0);
+  MapInfo* info3 = maps.Get(2);
+  ASSERT_EQ(info3, maps.Find(0x5000));
+
+  bool any_changed = true;
+  ASSERT_TRUE(maps.Reparse(&any_changed));
+  EXPECT_FALSE(any_changed);
+  ASSERT_EQ(3U, maps.Total());
+  EXPECT_EQ(info1, maps.Get(0));
+  EXPECT_EQ(info3, maps.Get(2));
+
+  // Nothing changed, and the file is not parsed again.
+  ASSERT_TRUE(maps.Reparse(&any_changed));
+  EXPECT_FALSE(any_changed);
+
+  ASSERT_TRUE(
+      android::base::WriteStringToFile("1000-2000 r-xp 00000000 00:00 0   /fake.so\n"
+                                       "3000-4000 r-xp 00000000 00:00 0   /fake4.so\n"
+                                       "4000-4800 r--p 00000000 00:00 0\n"
+                                       "5000-6000 r-xp 00000000 00:00 0   /fake3.so\n",
+                                       tf.path, 0660, getuid(), getgid()));
+  ASSERT_TRUE(maps.Reparse(&any_changed));
+  EXPECT_TRUE(any_changed);
+  ASSERT_EQ(4U, maps.Total());
+  EXPECT_EQ(info1, maps.Get(0));
+  EXPECT_EQ("/fake4.so", maps.Get(1)->name);
+  EXPECT_EQ(0x4000U, maps.Get(2)->start);
+  EXPECT_EQ(info3, maps.Get(3));
+  EXPECT_EQ(maps.Get(2), maps.Find(0x4010));
+
+  ASSERT_TRUE(
+      android::base::WriteStringToFile("5000-6000 r-xp 00000000 00:00 0   /fake3.so\n", tf.path,
+                                       0660, getuid(), getgid()));
+  ASSERT_TRUE(maps.Reparse(&any_changed));
+  EXPECT_TRUE(any_changed);
+  ASSERT_EQ(1U, maps.Total());
+  EXPECT_EQ(info3, maps.Get(0));
+  EXPECT_TRUE(maps.Find(0x1000) == nullptr);
+
+  ASSERT_TRUE(android::base::WriteStringToFile("bad line\n", tf.path, 0660, getuid(), getgid()));
+  ASSERT_FALSE(maps.Reparse(&any_changed));
+  EXPECT_FALSE(any_changed);
+  ASSERT_EQ(1U, maps.Total());
+  EXPECT_EQ(info3, maps.Get(0));
+}
+
 }  // namespace unwindstack
@@ -0,0 +1,222 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include <unwindstack/Memory.h>
+
+#include "MemoryFake.h"
+
+namespace unwindstack {
+
+class MemoryFakeCountReads : public MemoryFake {
+ public:
+  size_t Read(uint64_t addr, void* buffer, size_t size) override {
+    reads_++;
+    return MemoryFake::Read(addr, buffer, size);
+  }
+
+  size_t reads() { return reads_; }
+
+ private:
+  size_t reads_ = 0;
+};
+
+class MemoryCacheTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    memory_fake_ = new MemoryFakeCountReads;
+    memory_.reset(new MemoryCache(std::shared_ptr<Memory>(memory_fake_)));
+
+    std::vector<uint8_t> src(3 * MemoryCache::kBlockSize);
+    for (size_t i = 0; i < src.size(); i++) {
+      src[i] = i & 0xff;
+    }
+    memory_fake_->SetMemory(kStart, src);
+  }
+
+  static constexpr uint64_t kStart = 0x10000;
+
+  MemoryFakeCountReads* memory_fake_;
+  std::unique_ptr<MemoryCache> memory_;
+};
+
+TEST_F(MemoryCacheTest, cached_read) {
+  uint32_t value;
+  ASSERT_TRUE(memory_->Read32(kStart + 0x100, &value));
+  ASSERT_EQ(0x03020100U, value);
+  ASSERT_EQ(1U, memory_fake_->reads());
+
+  // Everything else in the block comes from the cache.
+  for (size_t i = 0; i < MemoryCache::kBlockSize; i += sizeof(value)) {
+    ASSERT_TRUE(memory_->Read32(kStart + i, &value));
+    ASSERT_EQ(i & 0xff, value & 0xff) << "Failed at offset " << i;
+  }
+  std::string string;
+  ASSERT_FALSE(memory_->ReadString(kStart + 1, &string, 16));
+  ASSERT_EQ(1U, memory_fake_->reads());
+
+  ASSERT_TRUE(memory_->Read32(kStart + MemoryCache::kBlockSize, &value));
+  ASSERT_EQ(2U, memory_fake_->reads());
+}
+
+TEST_F(MemoryCacheTest, read_across_blocks) {
+  uint64_t addr = kStart + MemoryCache::kBlockSize - 4;
+  uint64_t value;
+  ASSERT_TRUE(memory_->Read64(addr, &value));
+  ASSERT_EQ(0x03020100fffefdfcULL, value);
+  // Both blocks are fetched with one read.
+  ASSERT_EQ(1U, memory_fake_->reads());
+
+  ASSERT_TRUE(memory_->Read64(addr + 4, &value));
+  ASSERT_TRUE(memory_->Read64(addr - 4, &value));
+  ASSERT_EQ(1U, memory_fake_->reads());
+
+  // Only the missing block is fetched.
+  addr = kStart + 2 * MemoryCache::kBlockSize - 4;
+  ASSERT_TRUE(memory_->Read64(addr, &value));
+  ASSERT_EQ(0x03020100fffefdfcULL, value);
+  ASSERT_EQ(2U, memory_fake_->reads());
+}
+
+TEST_F(MemoryCacheTest, large_read_not_cached) {
+  std::vector<uint8_t> dst(MemoryCache::kMaxCachedReadSize + 1);
+  ASSERT_TRUE(memory_->ReadFully(kStart, dst.data(), dst.size()));
+  ASSERT_TRUE(memory_->ReadFully(kStart, dst.data(), dst.size()));
+  ASSERT_EQ(2U, memory_fake_->reads());
+  for (size_t i = 0; i < dst.size(); i++) {
+    ASSERT_EQ(i, dst[i]) << "Failed at byte " << i;
+  }
+}
+
+TEST_F(MemoryCacheTest, partial_block) {
+  // Only the start of the block after the data is readable.
+  uint64_t addr = kStart + 3 * MemoryCache::kBlockSize;
+  memory_fake_->SetData64(addr, 0x123456789abcdef0ULL);
+
+  uint64_t value;
+  ASSERT_TRUE(memory_->Read64(addr, &value));
+  ASSERT_EQ(0x123456789abcdef0ULL, value);
+  ASSERT_FALSE(memory_->Read64(addr + 1, &value));
+
+  // Nothing was cached, every read goes to the underlying memory.
+  size_t reads = memory_fake_->reads();
+  ASSERT_TRUE(memory_->Read64(addr, &value));
+  ASSERT_LT(reads, memory_fake_->reads());
+
+  // The preceding block is cached when a read spans both.
+  ASSERT_TRUE(memory_->Read64(addr - 4, &value));
+  ASSERT_EQ(0x9abcdef0fffefdfcULL, value);
+  reads = memory_fake_->reads();
+  ASSERT_TRUE(memory_->Read32(addr - 4, reinterpret_cast<uint32_t*>(&value)));
+  ASSERT_EQ(reads, memory_fake_->reads());
+}
+
+TEST_F(MemoryCacheTest, clear_cache) {
+  uint32_t value;
+  ASSERT_TRUE(memory_->Read32(kStart, &value));
+  ASSERT_EQ(0x03020100U, value);
+
+  memory_fake_->SetData32(kStart, 0x12345678);
+  ASSERT_TRUE(memory_->Read32(kStart, &value));
+  ASSERT_EQ(0x03020100U, value);
+
+  memory_->ClearCache();
+  ASSERT_TRUE(memory_->Read32(kStart, &value));
+  ASSERT_EQ(0x12345678U, value);
+  ASSERT_EQ(2U, memory_fake_->reads());
+}
+
+TEST_F(MemoryCacheTest, read_fails) {
+  uint32_t value;
+  ASSERT_FALSE(memory_->Read32(0x1000, &value));
+  ASSERT_FALSE(memory_->Read32(UINT64_MAX - 1, &value));
+}
+
+// Reads a word per read, like ptrace does.
+class MemoryFakeWordReads : public MemoryFakeCountReads {
+ public:
+  size_t Read(uint64_t addr, void* buffer, size_t size) override {
+    uint8_t* dst = reinterpret_cast<uint8_t*>(buffer);
+    uint64_t end = addr + size;
+    for (uint64_t word = addr & ~7ULL; word < end; word += 8) {
+      uint8_t data[8];
+      if (MemoryFakeCountReads::Read(word, data, sizeof(data)) != sizeof(data)) {
+        return word > addr ? word - addr : 0;
+      }
+      uint64_t start = std::max(word, addr);
+      memcpy(&dst[start - addr], &data[start - word], std::min(word + 8, end) - start);
+    }
+    return size;
+  }
+
+  bool CheapBlockReads() override { return false; }
+};
+
+TEST_F(MemoryCacheTest, word_reads_not_cached) {
+  MemoryFakeWordReads* memory_fake = new MemoryFakeWordReads;
+  MemoryCache memory(std::shared_ptr<Memory>(memory_fake));
+  std::vector<uint8_t> src(MemoryCache::kBlockSize);
+  for (size_t i = 0; i < src.size(); i++) {
+    src[i] = i & 0xff;
+  }
+  memory_fake->SetMemory(kStart, src);
+
+  // A value costs the words it covers, not a block of them.
+  uint32_t value;
+  ASSERT_TRUE(memory.Read32(kStart + 0x100, &value));
+  ASSERT_EQ(0x03020100U, value);
+  ASSERT_EQ(1U, memory_fake->reads());
+
+  uint64_t value64;
+  ASSERT_TRUE(memory.Read64(kStart + 0x104, &value64));
+  ASSERT_EQ(0x0b0a090807060504ULL, value64);
+  ASSERT_EQ(3U, memory_fake->reads());
+
+  ASSERT_TRUE(memory.Read32(kStart + 0x100, &value));
+  ASSERT_EQ(4U, memory_fake->reads());
+}
+
+TEST(MemoryCacheProcessTest, cached_local_memory) {
+  std::shared_ptr<Memory> memory = Memory::CreateProcessMemoryCached(getpid());
+
+  std::vector<uint64_t> values(1024);
+  for (size_t i = 0; i < values.size(); i++) {
+    values[i] = i * 0x1234567;
+  }
+  for (size_t i = 0; i < values.size(); i++) {
+    uint64_t value;
+    ASSERT_TRUE(memory->Read64(reinterpret_cast<uint64_t>(&values[i]), &value));
+    ASSERT_EQ(values[i], value) << "Failed at index " << i;
+  }
+
+  values[0] = 1;
+  memory->ClearCache();
+  uint64_t value;
+  ASSERT_TRUE(memory->Read64(reinterpret_cast<uint64_t>(&values[0]), &value));
+  ASSERT_EQ(1U, value);
+}
+
+}  // namespace unwindstack
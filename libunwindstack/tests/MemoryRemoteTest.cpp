@@ -69,12 +69,15 @@ TEST_F(MemoryRemoteTest, read) {
   ASSERT_TRUE(Attach(pid));
 
   MemoryRemote remote(pid);
+  // Nothing is known about the read function before the first read.
+  ASSERT_FALSE(remote.CheapBlockReads());
 
   std::vector<uint8_t> dst(1024);
   ASSERT_TRUE(remote.ReadFully(reinterpret_cast<uint64_t>(src.data()), dst.data(), 1024));
   for (size_t i = 0; i < 1024; i++) {
     ASSERT_EQ(0x4cU, dst[i]) << "Failed at byte " << i;
   }
+  ASSERT_TRUE(remote.CheapBlockReads());
 
   ASSERT_TRUE(Detach(pid));
 }
@@ -26,6 +26,7 @@
 #include <time.h>
 #include <unistd.h>
 
+#include <string>
 #include <vector>
 
 #include <android-base/file.h>
@@ -390,9 +391,150 @@ TYPED_TEST_P(SymbolsTest, get_global) {
   EXPECT_EQ(4U, offset);
 }
 
+TYPED_TEST_P(SymbolsTest, build_table) {
+  Symbols symbols(0x1000, sizeof(TypeParam) * 4, sizeof(TypeParam), 0x2000, 0x300);
+
+  // The whole string table has to be readable.
+  std::vector<uint8_t> strings(0x300);
+  this->memory_.SetMemory(0x2000, strings.data(), strings.size());
+
+  TypeParam sym;
+  uint64_t offset = 0x1000;
+  std::string fake_name;
+
+  this->InitSym(&sym, 0x5000, 0x10, 0x40);
+  this->memory_.SetMemory(offset, &sym, sizeof(sym));
+  fake_name = "function_one";
+  this->memory_.SetMemory(0x2040, fake_name.c_str(), fake_name.size() + 1);
+  offset += sizeof(sym);
+
+  // Not a function.
+  this->InitSym(&sym, 0x4000, 0x10, 0x80);
+  sym.st_info = STT_OBJECT;
+  this->memory_.SetMemory(offset, &sym, sizeof(sym));
+  fake_name = "global_one";
+  this->memory_.SetMemory(0x2080, fake_name.c_str(), fake_name.size() + 1);
+  offset += sizeof(sym);
+
+  this->InitSym(&sym, 0x3004, 0x200, 0x100);
+  this->memory_.SetMemory(offset, &sym, sizeof(sym));
+  fake_name = "function_two";
+  this->memory_.SetMemory(0x2100, fake_name.c_str(), fake_name.size() + 1);
+  offset += sizeof(sym);
+
+  // The name runs past the end of the string table.
+  this->InitSym(&sym, 0xa010, 0x20, 0x2fc);
+  this->memory_.SetMemory(offset, &sym, sizeof(sym));
+  fake_name = "function_three";
+  this->memory_.SetMemory(0x22fc, fake_name.c_str(), 4);
+
+  ASSERT_FALSE(symbols.table_built());
+  ASSERT_TRUE(symbols.BuildTable<TypeParam>(0, &this->memory_));
+  ASSERT_TRUE(symbols.table_built());
+
+  // Everything is read by now.
+  this->memory_.Clear();
+
+  const char* name;
+  uint64_t func_offset;
+  ASSERT_TRUE(symbols.GetNameFromTable(0x5004, 0, &name, &func_offset));
+  ASSERT_STREQ("function_one", name);
+  ASSERT_EQ(4U, func_offset);
+
+  ASSERT_TRUE(symbols.GetNameFromTable(0x3005, 0, &name, &func_offset));
+  ASSERT_STREQ("function_two", name);
+  ASSERT_EQ(1U, func_offset);
+
+  ASSERT_FALSE(symbols.GetNameFromTable(0x4000, 0, &name, &func_offset));
+  ASSERT_FALSE(symbols.GetNameFromTable(0xa010, 0, &name, &func_offset));
+
+  std::string string_name;
+  ASSERT_TRUE(symbols.GetName<TypeParam>(0x5008, 0, &this->memory_, &string_name, &func_offset));
+  ASSERT_EQ("function_one", string_name);
+  ASSERT_EQ(8U, func_offset);
+
+  symbols.ClearCache();
+  ASSERT_FALSE(symbols.table_built());
+  ASSERT_FALSE(symbols.GetNameFromTable(0x5004, 0, &name, &func_offset));
+}
+
+TYPED_TEST_P(SymbolsTest, build_table_load_bias) {
+  Symbols symbols(0x1000, sizeof(TypeParam), sizeof(TypeParam), 0x2000, 0x100);
+
+  std::vector<uint8_t> strings(0x100);
+  this->memory_.SetMemory(0x2000, strings.data(), strings.size());
+
+  TypeParam sym;
+  this->InitSym(&sym, 0x5000, 0x10, 0x40);
+  this->memory_.SetMemory(0x1000, &sym, sizeof(sym));
+  std::string fake_name("fake_function");
+  this->memory_.SetMemory(0x2040, fake_name.c_str(), fake_name.size() + 1);
+
+  ASSERT_TRUE(symbols.BuildTable<TypeParam>(0x1000, &this->memory_));
+
+  const char* name;
+  uint64_t func_offset;
+  ASSERT_TRUE(symbols.GetNameFromTable(0x5004, 0x1000, &name, &func_offset));
+  ASSERT_STREQ("fake_function", name);
+  ASSERT_EQ(4U, func_offset);
+}
+
+TYPED_TEST_P(SymbolsTest, build_table_unreadable) {
+  Symbols symbols(0x1000, sizeof(TypeParam), sizeof(TypeParam), 0x2000, 0x100);
+
+  TypeParam sym;
+  this->InitSym(&sym, 0x5000, 0x10, 0x40);
+  this->memory_.SetMemory(0x1000, &sym, sizeof(sym));
+  // Only the name itself is readable, not the whole string table.
+  std::string fake_name("fake_function");
+  this->memory_.SetMemory(0x2040, fake_name.c_str(), fake_name.size() + 1);
+
+  ASSERT_FALSE(symbols.BuildTable<TypeParam>(0, &this->memory_));
+  ASSERT_FALSE(symbols.table_built());
+
+  // The table is still scanned lazily.
+  std::string name;
+  uint64_t func_offset;
+  ASSERT_TRUE(symbols.GetName<TypeParam>(0x5000, 0, &this->memory_, &name, &func_offset));
+  ASSERT_EQ("fake_function", name);
+}
+
+TYPED_TEST_P(SymbolsTest, lazy_scan_stays_sorted) {
+  Symbols symbols(0x1000, sizeof(TypeParam) * 4, sizeof(TypeParam), 0x2000, 0x500);
+
+  TypeParam sym;
+  uint64_t offset = 0x1000;
+  std::vector<uint32_t> starts{0x7000, 0x5000, 0x8000, 0x6000};
+  for (size_t i = 0; i < starts.size(); i++) {
+    this->InitSym(&sym, starts[i], 0x10, 0x40 * i);
+    this->memory_.SetMemory(offset, &sym, sizeof(sym));
+    std::string fake_name("function_" + std::to_string(i));
+    this->memory_.SetMemory(0x2000 + 0x40 * i, fake_name.c_str(), fake_name.size() + 1);
+    offset += sizeof(sym);
+  }
+
+  // Each lookup only scans as far as the function, so the entries get added
+  // to the cache in several pieces.
+  std::string name;
+  uint64_t func_offset;
+  ASSERT_TRUE(symbols.GetName<TypeParam>(0x5000, 0, &this->memory_, &name, &func_offset));
+  ASSERT_EQ("function_1", name);
+  ASSERT_TRUE(symbols.GetName<TypeParam>(0x6000, 0, &this->memory_, &name, &func_offset));
+  ASSERT_EQ("function_3", name);
+
+  // All of the lookups must now be served from the cache.
+  for (size_t i = 0; i < starts.size(); i++) {
+    ASSERT_TRUE(symbols.GetName<TypeParam>(starts[i] + 1, 0, &this->memory_, &name, &func_offset));
+    ASSERT_EQ("function_" + std::to_string(i), name);
+    ASSERT_EQ(1U, func_offset);
+    ASSERT_TRUE(symbols.GetInfoFromCache(starts[i]) != nullptr);
+  }
+}
+
 REGISTER_TYPED_TEST_CASE_P(SymbolsTest, function_bounds_check, no_symbol, multiple_entries,
                            multiple_entries_nonstandard_size, load_bias, symtab_value_out_of_bounds,
-                           symtab_read_cached, get_global);
+                           symtab_read_cached, get_global, build_table, build_table_load_bias,
+                           build_table_unreadable, lazy_scan_stays_sorted);
 
 typedef ::testing::Types<Elf32_Sym, Elf64_Sym> SymbolsTestTypes;
 INSTANTIATE_TYPED_TEST_CASE_P(, SymbolsTest, SymbolsTestTypes);
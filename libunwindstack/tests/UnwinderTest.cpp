@@ -535,6 +535,144 @@ TEST_F(UnwinderTest, speculative_frame_removed) {
   EXPECT_EQ(0, frame->map_flags);
 }
 
+// Verify that only pcs are recorded, and that the frames created from them
+// match a full unwind.
+TEST_F(UnwinderTest, unwind_pcs) {
+  ElfInterfaceFake::FakePushFunctionData(FunctionData("Frame0", 0));
+  ElfInterfaceFake::FakePushFunctionData(FunctionData("Frame1", 1));
+
+  // Fake as if code called a nullptr function.
+  regs_.FakeSetPc(0);
+  regs_.FakeSetSp(0x10000);
+  regs_.FakeSetReturnAddress(0x1202);
+  regs_.FakeSetReturnAddressValid(true);
+
+  ElfInterfaceFake::FakePushStepData(StepData(0x23102, 0x10020, false));
+  ElfInterfaceFake::FakePushStepData(StepData(0, 0, true));
+
+  Unwinder unwinder(64, &maps_, &regs_, process_memory_);
+  PcFrameData pc_frames[2];
+  ASSERT_EQ(2U, unwinder.UnwindPcs(pc_frames, 2));
+  ASSERT_EQ(0U, unwinder.NumFrames());
+  ASSERT_EQ(2U, ElfInterfaceFake::FakeGetFunctionDataCount());
+
+  EXPECT_EQ(0U, pc_frames[0].rel_pc);
+  EXPECT_EQ(0U, pc_frames[0].pc);
+  EXPECT_EQ(0x10000U, pc_frames[0].sp);
+  EXPECT_EQ(PcFrameData::kNoMap, pc_frames[0].map_index);
+  EXPECT_EQ(0U, pc_frames[0].map_start);
+
+  EXPECT_EQ(0x200U, pc_frames[1].rel_pc);
+  EXPECT_EQ(0x1200U, pc_frames[1].pc);
+  EXPECT_EQ(0x10000U, pc_frames[1].sp);
+  EXPECT_EQ(0U, pc_frames[1].map_index);
+  EXPECT_EQ(0x1000U, pc_frames[1].map_start);
+
+  std::vector<FrameData> frames;
+  unwinder.SymbolizeFrames(pc_frames, 2, &frames);
+  ASSERT_EQ(2U, frames.size());
+
+  auto* frame = &frames[0];
+  EXPECT_EQ(0U, frame->num);
+  EXPECT_EQ(0U, frame->rel_pc);
+  EXPECT_EQ(0U, frame->pc);
+  EXPECT_EQ(0x10000U, frame->sp);
+  EXPECT_EQ("", frame->function_name);
+  EXPECT_EQ(0U, frame->function_offset);
+  EXPECT_EQ("", frame->map_name);
+  EXPECT_EQ(0U, frame->map_start);
+  EXPECT_EQ(0U, frame->map_end);
+
+  frame = &frames[1];
+  EXPECT_EQ(1U, frame->num);
+  EXPECT_EQ(0x200U, frame->rel_pc);
+  EXPECT_EQ(0x1200U, frame->pc);
+  EXPECT_EQ(0x10000U, frame->sp);
+  EXPECT_EQ("Frame0", frame->function_name);
+  EXPECT_EQ(0U, frame->function_offset);
+  EXPECT_EQ("/system/fake/libc.so", frame->map_name);
+  EXPECT_EQ(0U, frame->map_offset);
+  EXPECT_EQ(0x1000U, frame->map_start);
+  EXPECT_EQ(0x8000U, frame->map_end);
+  EXPECT_EQ(0U, frame->map_load_bias);
+  EXPECT_EQ(PROT_READ | PROT_WRITE, frame->map_flags);
+}
+
+// Verify that frames recorded before the maps were reparsed are matched
+// to their map by start address, not by a stale index.
+TEST_F(UnwinderTest, symbolize_frames_after_reparse) {
+  ElfInterfaceFake::FakePushFunctionData(FunctionData("Frame0", 0));
+
+  PcFrameData pc_frames[2];
+  // The libc map has moved to another index.
+  pc_frames[0].rel_pc = 0x200;
+  pc_frames[0].pc = 0x1200;
+  pc_frames[0].sp = 0x10000;
+  pc_frames[0].map_index = 3;
+  pc_frames[0].map_start = 0x1000;
+  // The map this pc was in is gone.
+  pc_frames[1].rel_pc = 0x100;
+  pc_frames[1].pc = 0x5100;
+  pc_frames[1].sp = 0x10010;
+  pc_frames[1].map_index = 0;
+  pc_frames[1].map_start = 0x5000;
+
+  Unwinder unwinder(64, &maps_, &regs_, process_memory_);
+  std::vector<FrameData> frames;
+  unwinder.SymbolizeFrames(pc_frames, 2, &frames);
+  ASSERT_EQ(2U, frames.size());
+
+  auto* frame = &frames[0];
+  EXPECT_EQ(0x1200U, frame->pc);
+  EXPECT_EQ("Frame0", frame->function_name);
+  EXPECT_EQ("/system/fake/libc.so", frame->map_name);
+  EXPECT_EQ(0x1000U, frame->map_start);
+  EXPECT_EQ(0x8000U, frame->map_end);
+
+  frame = &frames[1];
+  EXPECT_EQ(0x5100U, frame->pc);
+  EXPECT_EQ(0x100U, frame->rel_pc);
+  EXPECT_EQ(0x10010U, frame->sp);
+  EXPECT_EQ("", frame->function_name);
+  EXPECT_EQ("", frame->map_name);
+  EXPECT_EQ(0U, frame->map_start);
+  EXPECT_EQ(0U, frame->map_end);
+}
+
+// Verify that the function name of a pc seen in many unwinds is only
+// looked up once.
+TEST_F(UnwinderTest, symbolize_frames_once) {
+  ElfInterfaceFake::FakePushFunctionData(FunctionData("Frame0", 0));
+  ElfInterfaceFake::FakePushFunctionData(FunctionData("Frame1", 1));
+
+  std::vector<PcFrameData> pc_frames(6);
+  size_t num_frames = 0;
+  Unwinder unwinder(64, &maps_, &regs_, process_memory_);
+  for (size_t i = 0; i < 3; i++) {
+    regs_.FakeSetPc(0x1000);
+    regs_.FakeSetSp(0x10000);
+    ElfInterfaceFake::FakePushStepData(StepData(0x23102, 0x10010, false));
+    ElfInterfaceFake::FakePushStepData(StepData(0, 0, true));
+    num_frames += unwinder.UnwindPcs(&pc_frames[num_frames], 2);
+  }
+  ASSERT_EQ(6U, num_frames);
+
+  std::vector<FrameData> frames;
+  unwinder.SymbolizeFrames(pc_frames.data(), num_frames, &frames);
+  ASSERT_EQ(6U, frames.size());
+  EXPECT_EQ(0U, ElfInterfaceFake::FakeGetFunctionDataCount());
+  for (size_t i = 0; i < 6; i += 2) {
+    EXPECT_EQ(i, frames[i].num);
+    EXPECT_EQ(0x1000U, frames[i].pc);
+    EXPECT_EQ("Frame0", frames[i].function_name) << "Failed at frame " << i;
+    EXPECT_EQ("/system/fake/libc.so", frames[i].map_name);
+    EXPECT_EQ(0x23100U, frames[i + 1].pc);
+    EXPECT_EQ("Frame1", frames[i + 1].function_name) << "Failed at frame " << i + 1;
+    EXPECT_EQ(1U, frames[i + 1].function_offset);
+    EXPECT_EQ("/fake/libanother.so", frames[i + 1].map_name);
+  }
+}
+
 // Verify that an unwind stops when a frame is in given suffix.
 TEST_F(UnwinderTest, map_ignore_suffixes) {
   ElfInterfaceFake::FakePushFunctionData(FunctionData("Frame0", 0));
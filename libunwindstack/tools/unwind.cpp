@@ -89,7 +89,8 @@ void DoUnwind(pid_t pid) {
   }
   printf("\n");
 
-  auto process_memory = unwindstack::Memory::CreateProcessMemory(pid);
+  // The process stays stopped for the whole unwind, so cache what is read.
+  auto process_memory = unwindstack::Memory::CreateProcessMemoryCached(pid);
   unwindstack::Unwinder unwinder(128, &remote_maps, regs, process_memory);
   unwindstack::JitDebug jit_debug(process_memory);
   unwinder.SetJitDebug(&jit_debug, regs->Arch());
@@ -106,6 +106,11 @@ int main(int argc, char** argv) {
     return 0;
   }
 
+  // Every address gets looked up, so read the whole symbol tables at once.
+  // GetFunctionName uses them once built, and scans any that could not be
+  // read in one piece lazily as before.
+  elf.InitSymbolTables();
+
   // This is a crude way to get the symbols in order.
   for (const auto& entry : elf.interface()->pt_loads()) {
     uint64_t start = entry.second.offset + load_bias;
@@ -0,0 +1,186 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <dlfcn.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include <unwindstack/Elf.h>
+#include <unwindstack/ElfInterface.h>
+#include <unwindstack/Memory.h>
+
+// Looks up the functions of a whole library, the way the first unwinds
+// through a large library do, both by scanning the symbol tables lazily
+// and by reading them at once. The elf is read either from the file, or
+// through process_vm_readv from a copy mapped into this process, which
+// costs as much as reading a library from a remote process.
+
+constexpr size_t kNumLookups = 1000;
+
+static std::string g_elf_file;
+static std::vector<uint64_t> g_addrs;
+static void* g_elf_map = MAP_FAILED;
+static size_t g_elf_map_size;
+
+static unwindstack::Elf* CreateElf(bool process_memory = false) {
+  unwindstack::Memory* memory;
+  if (process_memory) {
+    memory = new unwindstack::MemoryRange(
+        std::shared_ptr<unwindstack::Memory>(new unwindstack::MemoryLocal),
+        reinterpret_cast<uint64_t>(g_elf_map), g_elf_map_size, 0);
+  } else {
+    unwindstack::MemoryFileAtOffset* file_memory = new unwindstack::MemoryFileAtOffset;
+    if (!file_memory->Init(g_elf_file, 0)) {
+      delete file_memory;
+      return nullptr;
+    }
+    memory = file_memory;
+  }
+  unwindstack::Elf* elf = new unwindstack::Elf(memory);
+  if (!elf->Init(true)) {
+    delete elf;
+    return nullptr;
+  }
+  return elf;
+}
+
+static bool MapElf() {
+  int fd = open(g_elf_file.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd == -1) {
+    return false;
+  }
+  struct stat buf;
+  if (fstat(fd, &buf) == -1 || buf.st_size == 0) {
+    close(fd);
+    return false;
+  }
+  g_elf_map_size = buf.st_size;
+  g_elf_map = mmap(nullptr, g_elf_map_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  return g_elf_map != MAP_FAILED;
+}
+
+// Spread the lookups over all of the loaded segments, in random order.
+static bool InitAddresses() {
+  std::unique_ptr<unwindstack::Elf> elf(CreateElf());
+  if (elf == nullptr) {
+    return false;
+  }
+
+  uint64_t total_size = 0;
+  for (const auto& entry : elf->interface()->pt_loads()) {
+    total_size += entry.second.table_size;
+  }
+  if (total_size == 0) {
+    return false;
+  }
+  for (const auto& entry : elf->interface()->pt_loads()) {
+    uint64_t num_addrs = entry.second.table_size * kNumLookups / total_size;
+    for (uint64_t i = 0; i < num_addrs; i++) {
+      g_addrs.push_back(entry.second.table_offset + i * entry.second.table_size / num_addrs);
+    }
+  }
+  std::shuffle(g_addrs.begin(), g_addrs.end(), std::mt19937(0));
+  return true;
+}
+
+static void LookupLazy(benchmark::State& state, bool process_memory) {
+  while (state.KeepRunning()) {
+    std::unique_ptr<unwindstack::Elf> elf(CreateElf(process_memory));
+    for (uint64_t addr : g_addrs) {
+      std::string name;
+      uint64_t func_offset;
+      benchmark::DoNotOptimize(elf->GetFunctionName(addr, &name, &func_offset));
+    }
+  }
+}
+
+static void LookupTable(benchmark::State& state, bool process_memory) {
+  while (state.KeepRunning()) {
+    std::unique_ptr<unwindstack::Elf> elf(CreateElf(process_memory));
+    if (!elf->InitSymbolTables()) {
+      state.SkipWithError("Cannot read the symbol tables at once.");
+      return;
+    }
+    for (uint64_t addr : g_addrs) {
+      const char* name;
+      uint64_t func_offset;
+      benchmark::DoNotOptimize(elf->GetFunctionNameFromTable(addr, &name, &func_offset));
+    }
+  }
+}
+
+static void BM_symbols_lazy_file(benchmark::State& state) {
+  LookupLazy(state, false);
+}
+BENCHMARK(BM_symbols_lazy_file);
+
+static void BM_symbols_table_file(benchmark::State& state) {
+  LookupTable(state, false);
+}
+BENCHMARK(BM_symbols_table_file);
+
+static void BM_symbols_lazy_process_memory(benchmark::State& state) {
+  LookupLazy(state, true);
+}
+BENCHMARK(BM_symbols_lazy_process_memory);
+
+static void BM_symbols_table_process_memory(benchmark::State& state) {
+  LookupTable(state, true);
+}
+BENCHMARK(BM_symbols_table_process_memory);
+
+int main(int argc, char** argv) {
+  benchmark::Initialize(&argc, argv);
+
+  if (argc > 2) {
+    printf("Usage: unwind_symbols_benchmarks [<ELF_FILE>] [<BENCHMARK_FLAGS>]\n");
+    printf("  Without ELF_FILE, the symbols of the library containing strlen are used.\n");
+    return 1;
+  }
+  if (argc == 2) {
+    g_elf_file = argv[1];
+  } else {
+    Dl_info info;
+    if (dladdr(reinterpret_cast<void*>(&strlen), &info) == 0 || info.dli_fname == nullptr) {
+      printf("Cannot find the library containing strlen.\n");
+      return 1;
+    }
+    g_elf_file = info.dli_fname;
+  }
+
+  if (!MapElf() || !InitAddresses()) {
+    printf("%s is not a valid elf file.\n", g_elf_file.c_str());
+    return 1;
+  }
+  printf("Looking up %zu addresses in %s\n", g_addrs.size(), g_elf_file.c_str());
+
+  benchmark::RunSpecifiedBenchmarks();
+  return 0;
+}
@@ -174,6 +174,9 @@ int32_t FindEntry(const ZipArchiveHandle handle, const ZipString& entryName, Zip
  *
  * This method also accepts optional prefix and suffix to restrict iteration to
  * entry names that start with |optional_prefix| or end with |optional_suffix|.
+ * Once an archive has been iterated with a prefix, later prefix iterations
+ * return entries in name order at a cost proportional to the number of
+ * matches rather than to the size of the archive.
  *
  * Returns 0 on success and negative values on failure.
  */
@@ -205,6 +208,19 @@ void EndIteration(void* cookie);
  */
 int32_t ExtractEntryToFile(ZipArchiveHandle handle, ZipEntry* entry, int fd);
 
+/*
+ * Uncompress |count| entries concurrently, each |entries[i]| to the open file
+ * |fds[i]| as ExtractEntryToFile would, using up to |num_threads| threads
+ * including the caller's (0 for one per CPU). Every entry is attempted, and
+ * if |results| is not null, |results[i]| is set to the result for
+ * |entries[i]|.
+ *
+ * Returns 0 if all the entries were extracted, otherwise the result of the
+ * first entry that failed.
+ */
+int32_t ExtractEntriesToFiles(ZipArchiveHandle handle, ZipEntry* entries, const int* fds,
+                              size_t count, size_t num_threads, int32_t* results);
+
 /**
  * Uncompress a given zip entry to the memory region at |begin| and of
  * size |size|. This size is expected to be the same as the *declared*
@@ -215,6 +231,20 @@ int32_t ExtractEntryToFile(ZipArchiveHandle handle, ZipEntry* entry, int fd);
  */
 int32_t ExtractToMemory(ZipArchiveHandle handle, ZipEntry* entry, uint8_t* begin, uint32_t size);
 
+/*
+ * Sets |*data| to the contents of a stored (uncompressed) |entry| in place,
+ * |entry->uncompressed_length| bytes that stay valid until the archive is
+ * closed. This is only possible for archives opened with
+ * OpenArchiveFromMemory; for one opened from a file the same bytes are at
+ * |entry->offset| in it, for a caller to map itself (zipalign -p aligns
+ * stored shared libraries to a page boundary for this).
+ *
+ * Returns 0 on success and negative values on failure, including when the
+ * entry is compressed or the archive is not in memory.
+ */
+int32_t GetStoredEntryData(const ZipArchiveHandle handle, const ZipEntry* entry,
+                           const uint8_t** data);
+
 int GetFileDescriptor(const ZipArchiveHandle handle);
 
 const char* ErrorCodeString(int32_t error_code);
@@ -271,6 +301,20 @@ class Reader {
  */
 int32_t Inflate(const Reader& reader, const uint32_t compressed_length,
                 const uint32_t uncompressed_length, Writer* writer, uint64_t* crc_out);
+
+/*
+ * Uncompress |count| entries concurrently, each |entries[i]| to
+ * |writers[i]|, using up to |num_threads| threads including the caller's
+ * (0 for one per CPU). A writer is only called from one thread at a time,
+ * but different writers are called concurrently. Every entry is attempted,
+ * and if |results| is not null, |results[i]| is set to the result for
+ * |entries[i]|.
+ *
+ * Returns 0 if all the entries were extracted, otherwise the result of the
+ * first entry that failed.
+ */
+int32_t ExtractToWriters(ZipArchiveHandle handle, ZipEntry* entries, Writer* const* writers,
+                         size_t count, size_t num_threads, int32_t* results);
 }  // namespace zip_archive
 
 #endif  // LIBZIPARCHIVE_ZIPARCHIVE_H_
@@ -96,6 +96,21 @@ class ZipWriter {
   // Move assignment.
   ZipWriter& operator=(ZipWriter&& zipWriter);
 
+  ~ZipWriter();
+
+  /**
+   * Deflates entries on |num_threads| worker threads, or on the calling thread if 0, the
+   * default. Entries are then compressed in independent blocks, each primed with the data
+   * preceding it, so an entry can be compressed while the ones before it are still being
+   * written and a large entry is spread across the workers. Entries keep their order and
+   * alignment, and the archive only depends on the data written, not on |num_threads|.
+   * Output is written as it becomes ready, so an error may be reported by a later call
+   * than the one that caused it.
+   * Can only be called between entries.
+   * Returns 0 on success, and an error value < 0 on failure.
+   */
+  int32_t SetDeflateThreads(size_t num_threads);
+
   /**
    * Starts a new zip entry with the given path and flags.
    * Flags can be a bitwise OR of ZipWriter::kCompress and ZipWriter::kAlign.
@@ -165,6 +180,12 @@ class ZipWriter {
   int32_t StoreBytes(FileEntry* file, const void* data, size_t len);
   int32_t CompressBytes(FileEntry* file, const void* data, size_t len);
   int32_t FlushCompressedBytes(FileEntry* file);
+  int32_t WriteLocalFileHeader(FileEntry* file, uint32_t alignment);
+  int32_t WriteEntryTrailer(FileEntry* file);
+
+  class DeflatePool;
+  int32_t SubmitBlock(bool last);
+  int32_t WritePending(size_t max_pending_blocks);
 
   enum class State {
     kWritingZip,
@@ -182,6 +203,9 @@ class ZipWriter {
 
   std::unique_ptr<z_stream, void (*)(z_stream*)> z_stream_;
   std::vector<uint8_t> buffer_;
+
+  // Set while deflating on worker threads, with the entries not fully written yet.
+  std::unique_ptr<DeflatePool> deflate_pool_;
 };
 
 #endif /* LIBZIPARCHIVE_ZIPWRITER_H_ */
@@ -28,6 +28,7 @@
 
 #include <set>
 #include <string>
+#include <vector>
 
 #include <android-base/file.h>
 #include <android-base/strings.h>
@@ -52,6 +53,13 @@ static uint64_t total_uncompressed_length = 0;
 static uint64_t total_compressed_length = 0;
 static size_t file_count = 0;
 
+// Files are created in iteration order but extracted concurrently, a batch
+// at a time to bound the number of open file descriptors.
+static const size_t kExtractBatchSize = 64;
+static std::vector<ZipEntry> pending_entries;
+static std::vector<int> pending_fds;
+static std::vector<std::string> pending_names;
+
 static bool Filter(const std::string& name) {
   if (!excludes.empty() && excludes.find(name) != excludes.end()) return true;
   if (!includes.empty() && includes.find(name) == includes.end()) return true;
@@ -148,6 +156,22 @@ static void ExtractToPipe(ZipArchiveHandle zah, ZipEntry& entry, const std::stri
   delete[] buffer;
 }
 
+static void ExtractPending(ZipArchiveHandle zah) {
+  std::vector<int32_t> results(pending_fds.size());
+  ExtractEntriesToFiles(zah, pending_entries.data(), pending_fds.data(), pending_fds.size(), 0,
+                        results.data());
+  for (size_t i = 0; i < pending_fds.size(); ++i) {
+    if (results[i] < 0) {
+      error(1, 0, "failed to extract %s: %s", pending_names[i].c_str(),
+            ErrorCodeString(results[i]));
+    }
+    close(pending_fds[i]);
+  }
+  pending_entries.clear();
+  pending_fds.clear();
+  pending_names.clear();
+}
+
 static void ExtractOne(ZipArchiveHandle zah, ZipEntry& entry, const std::string& name) {
   // Bad filename?
   if (android::base::StartsWith(name, "/") || android::base::StartsWith(name, "../") ||
@@ -193,9 +217,10 @@ static void ExtractOne(ZipArchiveHandle zah, ZipEntry& entry, const std::string&
 
   // Actually extract into the file.
   if (!flag_q) printf("  inflating: %s\n", dst.c_str());
-  int err = ExtractEntryToFile(zah, &entry, fd);
-  if (err < 0) error(1, 0, "failed to extract %s: %s", dst.c_str(), ErrorCodeString(err));
-  close(fd);
+  pending_entries.push_back(entry);
+  pending_fds.push_back(fd);
+  pending_names.push_back(dst);
+  if (pending_fds.size() >= kExtractBatchSize) ExtractPending(zah);
 }
 
 static void ListOne(const ZipEntry& entry, const std::string& name) {
@@ -250,6 +275,7 @@ static void ProcessAll(ZipArchiveHandle zah) {
 
   if (err < -1) error(1, 0, "failed iterating %s: %s", archive_name, ErrorCodeString(err));
   EndIteration(cookie);
+  ExtractPending(zah);
 
   MaybeShowFooter();
 }
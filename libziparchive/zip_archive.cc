@@ -30,7 +30,10 @@
 #include <time.h>
 #include <unistd.h>
 
+#include <algorithm>
+#include <atomic>
 #include <memory>
+#include <thread>
 #include <vector>
 
 #include <android-base/file.h>
@@ -639,8 +642,48 @@ static int32_t FindEntry(const ZipArchive* archive, const int ent, ZipEntry* dat
   return 0;
 }
 
+/*
+ * Orders entry names bytewise, a name sorts before any longer name it is a
+ * prefix of, so all the names with a given prefix are contiguous.
+ */
+static bool NameLess(const ZipString& lhs, const ZipString& rhs) {
+  const int cmp = memcmp(lhs.name, rhs.name, std::min(lhs.name_length, rhs.name_length));
+  return (cmp < 0) || ((cmp == 0) && (lhs.name_length < rhs.name_length));
+}
+
+// Prefix iterations of an archive before it is worth sorting its names.
+static const uint32_t kSortedIndexThreshold = 2;
+
+/*
+ * Returns the sorted index for a prefix iteration, or nullptr if the caller
+ * should scan the hash table instead.
+ */
+const std::vector<uint32_t>* ZipArchive::GetSortedIndex() {
+  std::lock_guard<std::mutex> lock(sorted_index_lock);
+  if (sorted_index.empty()) {
+    if (!num_entries || (++prefix_iterations < kSortedIndexThreshold)) {
+      return nullptr;
+    }
+    sorted_index.reserve(num_entries);
+    for (uint32_t i = 0; i < hash_table_size; ++i) {
+      if (hash_table[i].name != NULL) {
+        sorted_index.push_back(i);
+      }
+    }
+    const ZipString* table = hash_table;
+    std::sort(sorted_index.begin(), sorted_index.end(),
+              [table](uint32_t lhs, uint32_t rhs) { return NameLess(table[lhs], table[rhs]); });
+  }
+  return &sorted_index;
+}
+
 struct IterationHandle {
   uint32_t position;
+  // With a prefix, iterate [begin, end) of the archive's sorted_index
+  // instead of the whole hash table.
+  const std::vector<uint32_t>* sorted_index;
+  uint32_t begin;
+  uint32_t end;
   // We're not using vector here because this code is used in the Windows SDK
   // where the STL is not available.
   ZipString prefix;
@@ -685,8 +728,30 @@ int32_t StartIteration(ZipArchiveHandle handle, void** cookie_ptr, const ZipStri
 
   IterationHandle* cookie = new IterationHandle(optional_prefix, optional_suffix);
   cookie->position = 0;
+  cookie->sorted_index = nullptr;
+  cookie->begin = 0;
+  cookie->end = 0;
   cookie->archive = archive;
 
+  const std::vector<uint32_t>* index =
+      (cookie->prefix.name_length != 0) ? archive->GetSortedIndex() : nullptr;
+  if (index != nullptr) {
+    const std::vector<uint32_t>& sorted_index = *index;
+    const ZipString* hash_table = archive->hash_table;
+    const ZipString& prefix = cookie->prefix;
+    auto begin = std::lower_bound(
+        sorted_index.begin(), sorted_index.end(), prefix,
+        [hash_table](uint32_t ent, const ZipString& name) { return NameLess(hash_table[ent], name); });
+    auto end = begin;
+    while ((end != sorted_index.end()) && hash_table[*end].StartsWith(prefix)) {
+      ++end;
+    }
+    cookie->sorted_index = &sorted_index;
+    cookie->begin = begin - sorted_index.begin();
+    cookie->position = cookie->begin;
+    cookie->end = end - sorted_index.begin();
+  }
+
   *cookie_ptr = cookie;
   return 0;
 }
@@ -728,6 +793,25 @@ int32_t Next(void* cookie, ZipEntry* data, ZipString* name) {
   const uint32_t hash_table_length = archive->hash_table_size;
   const ZipString* hash_table = archive->hash_table;
 
+  if (handle->sorted_index != nullptr) {
+    for (uint32_t i = currentOffset; i < handle->end; ++i) {
+      const uint32_t ent = (*handle->sorted_index)[i];
+      if (handle->suffix.name_length == 0 || hash_table[ent].EndsWith(handle->suffix)) {
+        handle->position = (i + 1);
+        const int error = FindEntry(archive, ent, data);
+        if (!error) {
+          name->name = hash_table[ent].name;
+          name->name_length = hash_table[ent].name_length;
+        }
+
+        return error;
+      }
+    }
+
+    handle->position = handle->begin;
+    return kIterationEnd;
+  }
+
   for (uint32_t i = currentOffset; i < hash_table_length; ++i) {
     if (hash_table[i].name != NULL &&
         (handle->prefix.name_length == 0 || hash_table[i].StartsWith(handle->prefix)) &&
@@ -897,10 +981,15 @@ namespace zip_archive {
 Reader::~Reader() {}
 Writer::~Writer() {}
 
-int32_t Inflate(const Reader& reader, const uint32_t compressed_length,
-                const uint32_t uncompressed_length, Writer* writer, uint64_t* crc_out) {
+/*
+ * Inflates from |reader|, or if |in| is not null from the |compressed_length|
+ * bytes there without copying them first.
+ */
+static int32_t InflateImpl(const Reader* reader, const uint8_t* in,
+                           const uint32_t compressed_length, const uint32_t uncompressed_length,
+                           Writer* writer, uint64_t* crc_out) {
   const size_t kBufSize = 32768;
-  std::vector<uint8_t> read_buf(kBufSize);
+  std::vector<uint8_t> read_buf(in ? 0 : kBufSize);
   std::vector<uint8_t> write_buf(kBufSize);
   z_stream zstream;
   int zerr;
@@ -942,13 +1031,18 @@ int32_t Inflate(const Reader& reader, const uint32_t compressed_length,
   const bool compute_crc = (crc_out != nullptr);
   uint64_t crc = 0;
   uint32_t remaining_bytes = compressed_length;
+  if (in != nullptr) {
+    zstream.next_in = in;
+    zstream.avail_in = compressed_length;
+    remaining_bytes = 0;
+  }
   do {
     /* read as much as we can */
-    if (zstream.avail_in == 0) {
+    if ((zstream.avail_in == 0) && (remaining_bytes != 0)) {
       const size_t read_size = (remaining_bytes > kBufSize) ? kBufSize : remaining_bytes;
       const uint32_t offset = (compressed_length - remaining_bytes);
       // Make sure to read at offset to ensure concurrent access to the fd.
-      if (!reader.ReadAtOffset(read_buf.data(), read_size, offset)) {
+      if (!reader->ReadAtOffset(read_buf.data(), read_size, offset)) {
         ALOGW("Zip: inflate read failed, getSize = %zu: %s", read_size, strerror(errno));
         return kIoError;
       }
@@ -1001,10 +1095,23 @@ int32_t Inflate(const Reader& reader, const uint32_t compressed_length,
 
   return 0;
 }
+
+int32_t Inflate(const Reader& reader, const uint32_t compressed_length,
+                const uint32_t uncompressed_length, Writer* writer, uint64_t* crc_out) {
+  return InflateImpl(&reader, nullptr, compressed_length, uncompressed_length, writer, crc_out);
+}
 }  // namespace zip_archive
 
 static int32_t InflateEntryToWriter(MappedZipFile& mapped_zip, const ZipEntry* entry,
                                     zip_archive::Writer* writer, uint64_t* crc_out) {
+  // Archives in memory are inflated in place. Files are always read, a mapping
+  // of them would fault rather than fail if the file is truncated under us.
+  const uint8_t* in = mapped_zip.GetDataAtOffset(entry->compressed_length, entry->offset);
+  if (in != nullptr) {
+    return zip_archive::InflateImpl(nullptr, in, entry->compressed_length,
+                                    entry->uncompressed_length, writer, crc_out);
+  }
+
   const EntryReader reader(mapped_zip, entry);
 
   return zip_archive::Inflate(reader, entry->compressed_length, entry->uncompressed_length, writer,
@@ -1088,6 +1195,67 @@ int32_t ExtractEntryToFile(ZipArchiveHandle handle, ZipEntry* entry, int fd) {
   return ExtractToWriter(handle, entry, &writer);
 }
 
+/*
+ * Runs extract(i) for each i in [0, count) on up to num_threads threads,
+ * the calling thread included, handing out entries in order as threads
+ * become free.
+ */
+template <typename ExtractFunction>
+static int32_t ExtractConcurrently(size_t count, size_t num_threads, int32_t* results,
+                                   ExtractFunction extract) {
+  std::vector<int32_t> local_results;
+  if (results == nullptr) {
+    local_results.resize(count);
+    results = local_results.data();
+  }
+  if (num_threads == 0) {
+    num_threads = std::max(std::thread::hardware_concurrency(), 1U);
+  }
+  num_threads = std::min(num_threads, count);
+
+  std::atomic<size_t> next(0);
+  auto worker = [&]() {
+    size_t i;
+    while ((i = next.fetch_add(1, std::memory_order_relaxed)) < count) {
+      results[i] = extract(i);
+    }
+  };
+
+  std::vector<std::thread> threads;
+  for (size_t i = 1; i < num_threads; ++i) {
+    threads.emplace_back(worker);
+  }
+  worker();
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+
+  for (size_t i = 0; i < count; ++i) {
+    if (results[i] != 0) {
+      return results[i];
+    }
+  }
+  return 0;
+}
+
+int32_t ExtractEntriesToFiles(ZipArchiveHandle handle, ZipEntry* entries, const int* fds,
+                              size_t count, size_t num_threads, int32_t* results) {
+  return ExtractConcurrently(count, num_threads, results, [&](size_t i) {
+    return ExtractEntryToFile(handle, &entries[i], fds[i]);
+  });
+}
+
+namespace zip_archive {
+
+int32_t ExtractToWriters(ZipArchiveHandle handle, ZipEntry* entries, Writer* const* writers,
+                         size_t count, size_t num_threads, int32_t* results) {
+  return ExtractConcurrently(count, num_threads, results, [&](size_t i) {
+    return ExtractToWriter(handle, &entries[i], writers[i]);
+  });
+}
+
+}  // namespace zip_archive
+
 const char* ErrorCodeString(int32_t error_code) {
   // Make sure that the number of entries in kErrorMessages and ErrorCodes
   // match.
@@ -1102,6 +1270,25 @@ const char* ErrorCodeString(int32_t error_code) {
   return "Unknown return code";
 }
 
+int32_t GetStoredEntryData(const ZipArchiveHandle handle, const ZipEntry* entry,
+                           const uint8_t** data) {
+  const ZipArchive* archive = reinterpret_cast<ZipArchive*>(handle);
+  if (entry->method != kCompressStored) {
+    return kNotInMemory;
+  }
+  if (archive->mapped_zip.HasFd()) {
+    return kNotInMemory;
+  }
+
+  const uint8_t* ptr =
+      archive->mapped_zip.GetDataAtOffset(entry->uncompressed_length, entry->offset);
+  if (ptr == nullptr) {
+    return kInvalidOffset;
+  }
+  *data = ptr;
+  return 0;
+}
+
 int GetFileDescriptor(const ZipArchiveHandle handle) {
   return reinterpret_cast<ZipArchive*>(handle)->mapped_zip.GetFileDescriptor();
 }
@@ -1184,6 +1371,14 @@ bool MappedZipFile::ReadAtOffset(uint8_t* buf, size_t len, off64_t off) const {
   return true;
 }
 
+const uint8_t* MappedZipFile::GetDataAtOffset(size_t len, off64_t off) const {
+  if (has_fd_ || base_ptr_ == nullptr || off < 0 || off > data_length_ ||
+      static_cast<off64_t>(len) > data_length_ - off) {
+    return nullptr;
+  }
+  return static_cast<const uint8_t*>(base_ptr_) + off;
+}
+
 void CentralDirectory::Initialize(void* map_base_ptr, off64_t cd_start_offset, size_t cd_size) {
   base_ptr_ = static_cast<uint8_t*>(map_base_ptr) + cd_start_offset;
   length_ = cd_size;
@@ -84,4 +84,155 @@ static void Iterate_all_files(benchmark::State& state) {
 }
 BENCHMARK(Iterate_all_files);
 
+// An APK-like layout, a handful of native libraries among many resources.
+static TemporaryFile* CreateLargeZip() {
+  TemporaryFile* result = new TemporaryFile;
+  FILE* fp = fdopen(result->fd, "w");
+
+  ZipWriter writer(fp);
+  for (size_t i = 0; i < 10000; i++) {
+    std::string name = (i % 100) ? "res/drawable/image" : "lib/arm64-v8a/lib";
+    name += std::to_string(i);
+    writer.StartEntry(name.c_str(), 0);
+    writer.WriteBytes("helo", 4);
+    writer.FinishEntry();
+  }
+  writer.Finish();
+  fclose(fp);
+
+  return result;
+}
+
+static void Open_large(benchmark::State& state) {
+  std::unique_ptr<TemporaryFile> temp_file(CreateLargeZip());
+  ZipArchiveHandle handle;
+
+  while (state.KeepRunning()) {
+    OpenArchive(temp_file->path, &handle);
+    CloseArchive(handle);
+  }
+}
+BENCHMARK(Open_large);
+
+static void Iterate_prefix_large(benchmark::State& state) {
+  std::unique_ptr<TemporaryFile> temp_file(CreateLargeZip());
+  ZipArchiveHandle handle;
+  void* iteration_cookie;
+  ZipEntry data;
+  ZipString name;
+  ZipString prefix("lib/arm64-v8a/");
+
+  OpenArchive(temp_file->path, &handle);
+  while (state.KeepRunning()) {
+    StartIteration(handle, &iteration_cookie, &prefix, nullptr);
+    while (Next(iteration_cookie, &data, &name) == 0) {
+    }
+    EndIteration(iteration_cookie);
+  }
+  CloseArchive(handle);
+}
+BENCHMARK(Iterate_prefix_large);
+
+static void Open_iterate_prefix_large(benchmark::State& state) {
+  std::unique_ptr<TemporaryFile> temp_file(CreateLargeZip());
+  ZipArchiveHandle handle;
+  void* iteration_cookie;
+  ZipEntry data;
+  ZipString name;
+  ZipString prefix("lib/arm64-v8a/");
+
+  while (state.KeepRunning()) {
+    OpenArchive(temp_file->path, &handle);
+    StartIteration(handle, &iteration_cookie, &prefix, nullptr);
+    while (Next(iteration_cookie, &data, &name) == 0) {
+    }
+    EndIteration(iteration_cookie);
+    CloseArchive(handle);
+  }
+}
+BENCHMARK(Open_iterate_prefix_large);
+
+// Many compressible entries, as in an APK full of native libraries.
+static TemporaryFile* CreateExtractZip() {
+  TemporaryFile* result = new TemporaryFile;
+  FILE* fp = fdopen(result->fd, "w");
+
+  ZipWriter writer(fp);
+  std::string data;
+  for (size_t i = 0; i < 256 * 1024; i++) {
+    data += static_cast<char>('a' + (i * i) % 26);
+  }
+  for (size_t i = 0; i < 64; i++) {
+    writer.StartEntry(("lib" + std::to_string(i) + ".so").c_str(), ZipWriter::kCompress);
+    writer.WriteBytes(data.data(), data.size());
+    writer.FinishEntry();
+  }
+  writer.Finish();
+  fclose(fp);
+
+  return result;
+}
+
+class DiscardWriter : public zip_archive::Writer {
+ public:
+  DiscardWriter() : Writer() {}
+
+  virtual bool Append(uint8_t*, size_t) override { return true; }
+};
+
+static void ExtractToWriters_threads(benchmark::State& state) {
+  std::unique_ptr<TemporaryFile> temp_file(CreateExtractZip());
+  ZipArchiveHandle handle;
+  OpenArchive(temp_file->path, &handle);
+
+  std::vector<ZipEntry> entries;
+  void* iteration_cookie;
+  ZipEntry data;
+  ZipString name;
+  StartIteration(handle, &iteration_cookie, nullptr, nullptr);
+  while (Next(iteration_cookie, &data, &name) == 0) {
+    entries.push_back(data);
+  }
+  EndIteration(iteration_cookie);
+
+  std::vector<DiscardWriter> discard_writers(entries.size());
+  std::vector<zip_archive::Writer*> writers;
+  int64_t bytes = 0;
+  for (size_t i = 0; i < entries.size(); i++) {
+    writers.push_back(&discard_writers[i]);
+    bytes += entries[i].uncompressed_length;
+  }
+
+  while (state.KeepRunning()) {
+    zip_archive::ExtractToWriters(handle, entries.data(), writers.data(), entries.size(),
+                                  state.range(0), nullptr);
+  }
+  state.SetBytesProcessed(state.iterations() * bytes);
+  CloseArchive(handle);
+}
+BENCHMARK(ExtractToWriters_threads)->Arg(1)->Arg(2)->Arg(4)->Arg(8)->UseRealTime();
+
+static void ZipWriter_deflate_threads(benchmark::State& state) {
+  std::string data;
+  for (size_t i = 0; i < 256 * 1024; i++) {
+    data += static_cast<char>('a' + (i * i) % 26);
+  }
+
+  while (state.KeepRunning()) {
+    TemporaryFile temp_file;
+    FILE* fp = fdopen(temp_file.release(), "w");
+    ZipWriter writer(fp);
+    writer.SetDeflateThreads(state.range(0));
+    for (size_t i = 0; i < 64; i++) {
+      writer.StartEntry(("lib" + std::to_string(i) + ".so").c_str(), ZipWriter::kCompress);
+      writer.WriteBytes(data.data(), data.size());
+      writer.FinishEntry();
+    }
+    writer.Finish();
+    fclose(fp);
+  }
+  state.SetBytesProcessed(state.iterations() * 64 * data.size());
+}
+BENCHMARK(ZipWriter_deflate_threads)->Arg(0)->Arg(1)->Arg(2)->Arg(4)->UseRealTime();
+
 BENCHMARK_MAIN();
@@ -22,6 +22,7 @@
 #include <unistd.h>
 
 #include <memory>
+#include <mutex>
 #include <vector>
 
 #include <utils/FileMap.h>
@@ -42,6 +43,7 @@ static const char* kErrorMessages[] = {
     "Invalid entry name",
     "I/O error",
     "File mapping failed",
+    "Entry data not in memory",
 };
 
 enum ErrorCodes : int32_t {
@@ -87,7 +89,11 @@ enum ErrorCodes : int32_t {
   // We were not able to mmap the central directory or entry contents.
   kMmapFailed = -12,
 
-  kLastErrorCode = kMmapFailed,
+  // The entry's data can't be accessed in place, because it is compressed or
+  // the archive was not opened from memory.
+  kNotInMemory = -13,
+
+  kLastErrorCode = kNotInMemory,
 };
 
 class MappedZipFile {
@@ -108,6 +114,10 @@ class MappedZipFile {
 
   bool ReadAtOffset(uint8_t* buf, size_t len, off64_t off) const;
 
+  // Returns |len| bytes at offset |off| in place if the archive was opened
+  // from memory, nullptr otherwise or if the range is not valid.
+  const uint8_t* GetDataAtOffset(size_t len, off64_t off) const;
+
  private:
   // If has_fd_ is true, fd is valid and we'll read contents of a zip archive
   // from the file. Otherwise, we're opening the archive from a memory mapped
@@ -156,6 +166,14 @@ struct ZipArchive {
   uint32_t hash_table_size;
   ZipString* hash_table;
 
+  // hash_table slots in entry name order, so a prefix iteration only visits
+  // the entries that match. Sorting costs several full scans of the hash
+  // table, so GetSortedIndex() only builds it once an archive has been
+  // iterated with a prefix before.
+  std::vector<uint32_t> sorted_index;
+  uint32_t prefix_iterations;
+  std::mutex sorted_index_lock;
+
   ZipArchive(const int fd, bool assume_ownership)
       : mapped_zip(fd),
         close_file(assume_ownership),
@@ -164,7 +182,8 @@ struct ZipArchive {
         directory_map(new android::FileMap()),
         num_entries(0),
         hash_table_size(0),
-        hash_table(nullptr) {}
+        hash_table(nullptr),
+        prefix_iterations(0) {}
 
   ZipArchive(void* address, size_t length)
       : mapped_zip(address, length),
@@ -174,7 +193,8 @@ struct ZipArchive {
         directory_map(new android::FileMap()),
         num_entries(0),
         hash_table_size(0),
-        hash_table(nullptr) {}
+        hash_table(nullptr),
+        prefix_iterations(0) {}
 
   ~ZipArchive() {
     if (close_file && mapped_zip.GetFileDescriptor() >= 0) {
@@ -186,6 +206,8 @@ struct ZipArchive {
 
   bool InitializeCentralDirectory(const char* debug_file_name, off64_t cd_start_offset,
                                   size_t cd_size);
+
+  const std::vector<uint32_t>* GetSortedIndex();
 };
 
 #endif  // LIBZIPARCHIVE_ZIPARCHIVE_PRIVATE_H_
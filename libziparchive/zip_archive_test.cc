@@ -23,6 +23,7 @@
 #include <string.h>
 #include <unistd.h>
 
+#include <algorithm>
 #include <memory>
 #include <vector>
 
@@ -33,6 +34,7 @@
 #include <utils/FileMap.h>
 #include <ziparchive/zip_archive.h>
 #include <ziparchive/zip_archive_stream_entry.h>
+#include <ziparchive/zip_writer.h>
 
 static std::string test_data_dir;
 
@@ -186,6 +188,70 @@ TEST(ziparchive, IterationWithBadPrefixAndSuffix) {
   CloseArchive(handle);
 }
 
+TEST(ziparchive, IterationWithPrefixSorted) {
+  TemporaryFile tmp_file;
+  FILE* fp = fdopen(tmp_file.fd, "w");
+  ZipWriter writer(fp);
+  std::vector<std::string> expected;
+  for (size_t i = 0; i < 1000; ++i) {
+    const std::string dir = (i % 10 == 3) ? "lib/arm64/" : ((i % 10 == 4) ? "lib/arm64" : "res/");
+    const std::string entry_name = dir + std::to_string(i) + ((i % 4) ? ".so" : ".txt");
+    ASSERT_EQ(0, writer.StartEntry(entry_name.c_str(), 0));
+    ASSERT_EQ(0, writer.FinishEntry());
+    if ((i % 10 == 3) && (i % 4)) {
+      expected.push_back(entry_name);
+    }
+  }
+  ASSERT_EQ(0, writer.Finish());
+  ASSERT_EQ(0, fclose(fp));
+  tmp_file.fd = -1;
+  std::sort(expected.begin(), expected.end());
+
+  ZipArchiveHandle handle;
+  ASSERT_EQ(0, OpenArchive(tmp_file.path, &handle));
+
+  const std::string prefix_str("lib/arm64/");
+  const std::string suffix_str(".so");
+  const std::string missing_str("lib/arm64/z");
+  ZipString prefix;
+  SetZipString(&prefix, prefix_str);
+  ZipString suffix;
+  SetZipString(&suffix, suffix_str);
+  void* iteration_cookie;
+  ZipEntry data;
+  ZipString name;
+
+  // The first prefix iteration of an archive scans it, in hash order.
+  ASSERT_EQ(0, StartIteration(handle, &iteration_cookie, &prefix, &suffix));
+  std::vector<std::string> names;
+  while (Next(iteration_cookie, &data, &name) == 0) {
+    names.push_back(std::string(reinterpret_cast<const char*>(name.name), name.name_length));
+  }
+  EndIteration(iteration_cookie);
+  std::sort(names.begin(), names.end());
+  ASSERT_EQ(expected, names);
+
+  // Later ones use the sorted index.
+  ASSERT_EQ(0, StartIteration(handle, &iteration_cookie, &prefix, &suffix));
+  names.clear();
+  while (Next(iteration_cookie, &data, &name) == 0) {
+    names.push_back(std::string(reinterpret_cast<const char*>(name.name), name.name_length));
+  }
+  ASSERT_EQ(expected, names);
+
+  // The iteration starts over once it has ended.
+  ASSERT_EQ(0, Next(iteration_cookie, &data, &name));
+  ASSERT_EQ(expected[0], std::string(reinterpret_cast<const char*>(name.name), name.name_length));
+  EndIteration(iteration_cookie);
+
+  SetZipString(&prefix, missing_str);
+  ASSERT_EQ(0, StartIteration(handle, &iteration_cookie, &prefix, nullptr));
+  ASSERT_EQ(-1, Next(iteration_cookie, &data, &name));
+  EndIteration(iteration_cookie);
+
+  CloseArchive(handle);
+}
+
 TEST(ziparchive, FindEntry) {
   ZipArchiveHandle handle;
   ASSERT_EQ(0, OpenArchiveWrapper(kValidZip, &handle));
@@ -431,6 +497,46 @@ TEST(ziparchive, OpenFromMemory) {
   ASSERT_NE(-1, tmp_binary.fd);
   ASSERT_EQ(0, ExtractEntryToFile(handle, &binary_entry, tmp_binary.fd));
 }
+
+TEST(ziparchive, GetStoredEntryData) {
+  std::string zip_contents;
+  ASSERT_TRUE(android::base::ReadFileToString(test_data_dir + "/" + kValidZip, &zip_contents));
+  ZipArchiveHandle handle;
+  ASSERT_EQ(0, OpenArchiveFromMemory(&zip_contents[0], zip_contents.size(), kValidZip.c_str(),
+                                     &handle));
+
+  // A stored entry is handed out in place.
+  ZipEntry data;
+  ZipString b_name;
+  SetZipString(&b_name, kBTxtName);
+  ASSERT_EQ(0, FindEntry(handle, b_name, &data));
+  const uint8_t* b_data = nullptr;
+  ASSERT_EQ(0, GetStoredEntryData(handle, &data, &b_data));
+  ASSERT_EQ(reinterpret_cast<const uint8_t*>(zip_contents.data()) + data.offset, b_data);
+  ASSERT_EQ(0, memcmp(b_data, kBTxtContents.data(), kBTxtContents.size()));
+
+  std::vector<uint8_t> buffer(data.uncompressed_length);
+  ASSERT_EQ(0, ExtractToMemory(handle, &data, &buffer[0], buffer.size()));
+  ASSERT_EQ(kBTxtContents, buffer);
+
+  // A deflated one isn't, but still inflates straight from memory.
+  ZipString a_name;
+  SetZipString(&a_name, kATxtName);
+  ASSERT_EQ(0, FindEntry(handle, a_name, &data));
+  ASSERT_EQ(kNotInMemory, GetStoredEntryData(handle, &data, &b_data));
+
+  buffer.resize(data.uncompressed_length);
+  ASSERT_EQ(0, ExtractToMemory(handle, &data, &buffer[0], buffer.size()));
+  ASSERT_EQ(kATxtContents, buffer);
+
+  CloseArchive(handle);
+
+  // Nor is anything in an archive opened from a file.
+  ASSERT_EQ(0, OpenArchiveWrapper(kValidZip, &handle));
+  ASSERT_EQ(0, FindEntry(handle, b_name, &data));
+  ASSERT_EQ(kNotInMemory, GetStoredEntryData(handle, &data, &b_data));
+  CloseArchive(handle);
+}
 #endif
 
 static void ZipArchiveStreamTest(ZipArchiveHandle& handle, const std::string& entry_name, bool raw,
@@ -638,9 +744,10 @@ TEST(ziparchive, ErrorCodeString) {
 
   // Out of bounds.
   ASSERT_STREQ("Unknown return code", ErrorCodeString(1));
-  ASSERT_STREQ("Unknown return code", ErrorCodeString(-13));
+  ASSERT_STREQ("Unknown return code", ErrorCodeString(-14));
 
   ASSERT_STREQ("I/O error", ErrorCodeString(kIoError));
+  ASSERT_STREQ("Entry data not in memory", ErrorCodeString(kNotInMemory));
 }
 
 class VectorReader : public zip_archive::Reader {
@@ -730,6 +837,131 @@ TEST(ziparchive, Inflate) {
   }
 }
 
+TEST(ziparchive, ExtractToWriters) {
+  TemporaryFile tmp_file;
+  FILE* fp = fdopen(tmp_file.fd, "w");
+  ZipWriter zip_writer(fp);
+  std::vector<std::string> contents;
+  for (size_t i = 0; i < 32; ++i) {
+    const std::string entry_name = "entry" + std::to_string(i);
+    contents.push_back(std::string(40000 + i, static_cast<char>('a' + i % 26)));
+    ASSERT_EQ(0, zip_writer.StartEntry(entry_name.c_str(), (i % 2) ? ZipWriter::kCompress : 0));
+    ASSERT_EQ(0, zip_writer.WriteBytes(contents.back().data(), contents.back().size()));
+    ASSERT_EQ(0, zip_writer.FinishEntry());
+  }
+  ASSERT_EQ(0, zip_writer.Finish());
+  ASSERT_EQ(0, fclose(fp));
+  tmp_file.fd = -1;
+
+  ZipArchiveHandle handle;
+  ASSERT_EQ(0, OpenArchive(tmp_file.path, &handle));
+
+  std::vector<ZipEntry> entries(contents.size());
+  for (size_t i = 0; i < entries.size(); ++i) {
+    const std::string entry_name = "entry" + std::to_string(i);
+    ZipString name;
+    SetZipString(&name, entry_name);
+    ASSERT_EQ(0, FindEntry(handle, name, &entries[i]));
+  }
+
+  for (size_t num_threads : {1, 4, 0}) {
+    std::vector<VectorWriter> vector_writers(entries.size());
+    std::vector<zip_archive::Writer*> writers;
+    for (VectorWriter& writer : vector_writers) {
+      writers.push_back(&writer);
+    }
+    std::vector<int32_t> results(entries.size(), -1);
+    ASSERT_EQ(0, zip_archive::ExtractToWriters(handle, entries.data(), writers.data(),
+                                               entries.size(), num_threads, results.data()));
+    for (size_t i = 0; i < entries.size(); ++i) {
+      ASSERT_EQ(0, results[i]);
+      ASSERT_EQ(contents[i], std::string(vector_writers[i].GetOutput().begin(),
+                                         vector_writers[i].GetOutput().end()));
+    }
+  }
+
+  // Every entry is attempted, the first failure is returned.
+  // A writer is only called from one thread at a time, so each entry has its own.
+  VectorWriter good_writer;
+  BadWriter bad_writers[2];
+  zip_archive::Writer* writers[] = {&good_writer, &bad_writers[0], &bad_writers[1]};
+  int32_t results[3];
+  ASSERT_EQ(kIoError,
+            zip_archive::ExtractToWriters(handle, entries.data(), writers, 3, 2, results));
+  ASSERT_EQ(0, results[0]);
+  ASSERT_EQ(kIoError, results[1]);
+  ASSERT_EQ(kIoError, results[2]);
+  ASSERT_EQ(contents[0],
+            std::string(good_writer.GetOutput().begin(), good_writer.GetOutput().end()));
+
+  TemporaryFile output_files[4];
+  int fds[4];
+  for (size_t i = 0; i < 4; ++i) {
+    fds[i] = output_files[i].fd;
+  }
+  ASSERT_EQ(0, ExtractEntriesToFiles(handle, entries.data(), fds, 4, 4, nullptr));
+  for (size_t i = 0; i < 4; ++i) {
+    std::string output;
+    ASSERT_TRUE(android::base::ReadFileToString(output_files[i].path, &output));
+    ASSERT_EQ(contents[i], output);
+  }
+
+  CloseArchive(handle);
+}
+
+// Entries far larger than the read buffer, on an fd, stored and deflated, are
+// read rather than mapped so that a truncated file is an error, not a fault.
+TEST(ziparchive, ExtractLargeEntriesFromFd) {
+  TemporaryFile tmp_file;
+  FILE* fp = fdopen(dup(tmp_file.fd), "w");
+  ASSERT_TRUE(fp != nullptr);
+  ZipWriter zip_writer(fp);
+  // Barely compressible, so the deflated entry is as large as the stored one.
+  std::string contents(512 * 1024, '\0');
+  uint32_t seed = 1;
+  for (size_t i = 0; i < contents.size(); ++i) {
+    seed = seed * 1103515245 + 12345;
+    contents[i] = static_cast<char>(seed >> 16);
+  }
+  ASSERT_EQ(0, zip_writer.StartEntry("stored", 0));
+  ASSERT_EQ(0, zip_writer.WriteBytes(contents.data(), contents.size()));
+  ASSERT_EQ(0, zip_writer.FinishEntry());
+  ASSERT_EQ(0, zip_writer.StartEntry("deflated", ZipWriter::kCompress));
+  ASSERT_EQ(0, zip_writer.WriteBytes(contents.data(), contents.size()));
+  ASSERT_EQ(0, zip_writer.FinishEntry());
+  ASSERT_EQ(0, zip_writer.Finish());
+  ASSERT_EQ(0, fclose(fp));
+
+  ZipArchiveHandle handle;
+  ASSERT_EQ(0, OpenArchiveFd(tmp_file.fd, "ExtractLargeEntriesFromFd", &handle, false));
+
+  ZipEntry entries[2];
+  ZipString name;
+  SetZipString(&name, "stored");
+  ASSERT_EQ(0, FindEntry(handle, name, &entries[0]));
+  ASSERT_EQ(kCompressStored, entries[0].method);
+  SetZipString(&name, "deflated");
+  ASSERT_EQ(0, FindEntry(handle, name, &entries[1]));
+  ASSERT_EQ(kCompressDeflated, entries[1].method);
+  ASSERT_LT(256 * 1024U, entries[1].compressed_length);
+
+  std::string output(contents.size(), '\0');
+  for (ZipEntry& entry : entries) {
+    ASSERT_EQ(0, ExtractToMemory(handle, &entry, reinterpret_cast<uint8_t*>(&output[0]),
+                                 output.size()));
+    ASSERT_EQ(contents, output);
+  }
+
+  // Cut both entries short.
+  ASSERT_EQ(0, ftruncate(tmp_file.fd, entries[0].offset + contents.size() / 2));
+  for (ZipEntry& entry : entries) {
+    ASSERT_EQ(kIoError, ExtractToMemory(handle, &entry, reinterpret_cast<uint8_t*>(&output[0]),
+                                        output.size()));
+  }
+
+  CloseArchive(handle);
+}
+
 int main(int argc, char** argv) {
   ::testing::InitGoogleTest(&argc, argv);
 
@@ -22,7 +22,12 @@
 #include <cstdio>
 #define DEF_MEM_LEVEL 8  // normally in zutil.h?
 
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
 #include <memory>
+#include <mutex>
+#include <thread>
 #include <vector>
 
 #include "android-base/logging.h"
@@ -66,6 +71,15 @@ static const int32_t kInvalidAlign32Flag = -5;
 // The alignment parameter is not a power of 2.
 static const int32_t kInvalidAlignment = -6;
 
+// Size of the blocks entries are split into when deflating on worker threads.
+static const size_t kDeflateBlockSize = 128 * 1024u;
+
+// How much of the preceding data primes each block, the size of the deflate window.
+static const size_t kDeflateDictionarySize = 32768u;
+
+// Blocks per worker thread that may be waiting to be written before the caller waits.
+static const size_t kMaxPendingBlocksPerThread = 4;
+
 static const char* sErrorCodes[] = {
     "Invalid state", "IO error", "Invalid entry name", "Zlib error",
 };
@@ -82,6 +96,151 @@ static void DeleteZStream(z_stream* stream) {
   delete stream;
 }
 
+static int DeflateInit(z_stream* stream) {
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wold-style-cast"
+  return deflateInit2(stream, Z_BEST_COMPRESSION, Z_DEFLATED, -MAX_WBITS, DEF_MEM_LEVEL,
+                      Z_DEFAULT_STRATEGY);
+#pragma GCC diagnostic pop
+}
+
+namespace {
+
+// A piece of an entry's data, deflated on a worker thread unless the entry is stored.
+struct DeflateBlock {
+  std::vector<uint8_t> dictionary;
+  // The input, replaced by the output once done.
+  std::vector<uint8_t> data;
+  bool compress;
+  bool last;
+
+  bool done = false;
+  int32_t result = kNoError;
+};
+
+// Deflates a block into a raw deflate stream that can be appended to the one of the block
+// before it, ending on a byte boundary (Z_SYNC_FLUSH) unless it is the entry's last.
+int32_t CompressBlock(DeflateBlock* block) {
+  z_stream stream = {};
+  if (DeflateInit(&stream) != Z_OK) {
+    return kZlibError;
+  }
+  std::unique_ptr<z_stream, int (*)(z_stream*)> stream_guard(&stream, deflateEnd);
+
+  if (!block->dictionary.empty() &&
+      deflateSetDictionary(&stream, block->dictionary.data(), block->dictionary.size()) != Z_OK) {
+    return kZlibError;
+  }
+
+  // A sync flush and the empty stored block it adds fit in the slack.
+  std::vector<uint8_t> output(deflateBound(&stream, block->data.size()) + 16);
+  stream.next_in = block->data.data();
+  stream.avail_in = block->data.size();
+  stream.next_out = output.data();
+  stream.avail_out = output.size();
+  int zerr = deflate(&stream, block->last ? Z_FINISH : Z_SYNC_FLUSH);
+  if (block->last ? (zerr != Z_STREAM_END) : (zerr != Z_OK || stream.avail_out == 0)) {
+    return kZlibError;
+  }
+
+  output.resize(output.size() - stream.avail_out);
+  block->data = std::move(output);
+  return kNoError;
+}
+
+// An entry whose header, data or trailer has yet to be written. The entries before it in the
+// pool are written first.
+struct PendingEntry {
+  ZipWriter::FileEntry entry;
+  uint32_t alignment;
+
+  // Data not yet submitted, and the data before it.
+  std::vector<uint8_t> input;
+  std::vector<uint8_t> dictionary;
+
+  std::deque<std::shared_ptr<DeflateBlock>> blocks;
+  bool header_written = false;
+  bool finished = false;
+};
+
+}  // namespace
+
+class ZipWriter::DeflatePool {
+ public:
+  explicit DeflatePool(size_t num_threads) : num_threads_(num_threads) {
+    for (size_t i = 0; i < num_threads; i++) {
+      threads_.emplace_back(&DeflatePool::Run, this);
+    }
+  }
+
+  ~DeflatePool() {
+    {
+      std::lock_guard<std::mutex> lock(lock_);
+      stop_ = true;
+    }
+    work_cond_.notify_all();
+    for (std::thread& thread : threads_) {
+      thread.join();
+    }
+  }
+
+  void Submit(const std::shared_ptr<DeflateBlock>& block) {
+    pending_blocks++;
+    if (!block->compress) {
+      block->done = true;
+      return;
+    }
+    {
+      std::lock_guard<std::mutex> lock(lock_);
+      queue_.push_back(block);
+    }
+    work_cond_.notify_one();
+  }
+
+  bool IsDone(const DeflateBlock& block, bool wait) {
+    std::unique_lock<std::mutex> lock(lock_);
+    if (wait) {
+      done_cond_.wait(lock, [&block] { return block.done; });
+    }
+    return block.done;
+  }
+
+  size_t MaxPendingBlocks() const { return num_threads_ * kMaxPendingBlocksPerThread; }
+
+  std::deque<std::unique_ptr<PendingEntry>> entries;
+  size_t pending_blocks = 0;
+
+ private:
+  void Run() {
+    std::unique_lock<std::mutex> lock(lock_);
+    while (true) {
+      work_cond_.wait(lock, [this] { return stop_ || !queue_.empty(); });
+      if (stop_) {
+        return;
+      }
+      std::shared_ptr<DeflateBlock> block = std::move(queue_.front());
+      queue_.pop_front();
+
+      lock.unlock();
+      int32_t result = CompressBlock(block.get());
+      lock.lock();
+
+      block->result = result;
+      block->done = true;
+      done_cond_.notify_all();
+    }
+  }
+
+  const size_t num_threads_;
+  std::vector<std::thread> threads_;
+
+  std::mutex lock_;
+  std::condition_variable work_cond_;
+  std::condition_variable done_cond_;
+  std::deque<std::shared_ptr<DeflateBlock>> queue_;
+  bool stop_ = false;
+};
+
 ZipWriter::ZipWriter(FILE* f)
     : file_(f),
       seekable_(false),
@@ -104,7 +263,8 @@ ZipWriter::ZipWriter(ZipWriter&& writer)
       state_(writer.state_),
       files_(std::move(writer.files_)),
       z_stream_(std::move(writer.z_stream_)),
-      buffer_(std::move(writer.buffer_)) {
+      buffer_(std::move(writer.buffer_)),
+      deflate_pool_(std::move(writer.deflate_pool_)) {
   writer.file_ = nullptr;
   writer.state_ = State::kError;
 }
@@ -117,11 +277,27 @@ ZipWriter& ZipWriter::operator=(ZipWriter&& writer) {
   files_ = std::move(writer.files_);
   z_stream_ = std::move(writer.z_stream_);
   buffer_ = std::move(writer.buffer_);
+  deflate_pool_ = std::move(writer.deflate_pool_);
   writer.file_ = nullptr;
   writer.state_ = State::kError;
   return *this;
 }
 
+ZipWriter::~ZipWriter() {}
+
+int32_t ZipWriter::SetDeflateThreads(size_t num_threads) {
+  if (state_ != State::kWritingZip) {
+    return kInvalidState;
+  }
+
+  int32_t result = WritePending(0);
+  if (result != kNoError) {
+    return result;
+  }
+  deflate_pool_.reset(num_threads != 0 ? new DeflatePool(num_threads) : nullptr);
+  return kNoError;
+}
+
 int32_t ZipWriter::HandleError(int32_t error_code) {
   state_ = State::kError;
   z_stream_.reset();
@@ -210,7 +386,6 @@ int32_t ZipWriter::StartAlignedEntryWithTime(const char* path, size_t flags, tim
   }
 
   FileEntry file_entry = {};
-  file_entry.local_file_header_offset = current_offset_;
   file_entry.path = path;
 
   if (!IsValidEntryName(reinterpret_cast<const uint8_t*>(file_entry.path.data()),
@@ -218,25 +393,47 @@ int32_t ZipWriter::StartAlignedEntryWithTime(const char* path, size_t flags, tim
     return kInvalidEntryName;
   }
 
-  if (flags & ZipWriter::kCompress) {
-    file_entry.compression_method = kCompressDeflated;
+  file_entry.compression_method =
+      (flags & ZipWriter::kCompress) ? kCompressDeflated : kCompressStored;
 
+  ExtractTimeAndDate(time, &file_entry.last_mod_time, &file_entry.last_mod_date);
+
+  if (deflate_pool_) {
+    // The header is written once the entries before it are, see WritePending().
+    std::unique_ptr<PendingEntry> pending(new PendingEntry());
+    pending->entry = std::move(file_entry);
+    pending->alignment = alignment;
+    deflate_pool_->entries.push_back(std::move(pending));
+    state_ = State::kWritingEntry;
+    return kNoError;
+  }
+
+  if (file_entry.compression_method == kCompressDeflated) {
     int32_t result = PrepareDeflate();
     if (result != kNoError) {
       return result;
     }
-  } else {
-    file_entry.compression_method = kCompressStored;
   }
 
-  ExtractTimeAndDate(time, &file_entry.last_mod_time, &file_entry.last_mod_date);
+  int32_t result = WriteLocalFileHeader(&file_entry, alignment);
+  if (result != kNoError) {
+    return result;
+  }
 
-  off_t offset = current_offset_ + sizeof(LocalFileHeader) + file_entry.path.size();
+  current_file_entry_ = std::move(file_entry);
+  state_ = State::kWritingEntry;
+  return kNoError;
+}
+
+int32_t ZipWriter::WriteLocalFileHeader(FileEntry* file, uint32_t alignment) {
+  file->local_file_header_offset = current_offset_;
+
+  off_t offset = current_offset_ + sizeof(LocalFileHeader) + file->path.size();
   std::vector<char> zero_padding;
   if (alignment != 0 && (offset & (alignment - 1))) {
     // Pad the extra field so the data will be aligned.
     uint16_t padding = alignment - (offset % alignment);
-    file_entry.padding_length = padding;
+    file->padding_length = padding;
     offset += padding;
     zero_padding.resize(padding, 0);
   }
@@ -244,29 +441,35 @@ int32_t ZipWriter::StartAlignedEntryWithTime(const char* path, size_t flags, tim
   LocalFileHeader header = {};
   // Always start expecting a data descriptor. When the data has finished being written,
   // if it is possible to seek back, the GPB flag will reset and the sizes written.
-  CopyFromFileEntry(file_entry, true /*use_data_descriptor*/, &header);
+  CopyFromFileEntry(*file, true /*use_data_descriptor*/, &header);
 
   if (fwrite(&header, sizeof(header), 1, file_) != 1) {
     return HandleError(kIoError);
   }
 
-  if (fwrite(path, sizeof(*path), file_entry.path.size(), file_) != file_entry.path.size()) {
+  if (fwrite(file->path.data(), 1, file->path.size(), file_) != file->path.size()) {
     return HandleError(kIoError);
   }
 
-  if (file_entry.padding_length != 0 && fwrite(zero_padding.data(), 1, file_entry.padding_length,
-                                               file_) != file_entry.padding_length) {
+  if (file->padding_length != 0 &&
+      fwrite(zero_padding.data(), 1, file->padding_length, file_) != file->padding_length) {
     return HandleError(kIoError);
   }
 
-  current_file_entry_ = std::move(file_entry);
   current_offset_ = offset;
-  state_ = State::kWritingEntry;
   return kNoError;
 }
 
 int32_t ZipWriter::DiscardLastEntry() {
-  if (state_ != State::kWritingZip || files_.empty()) {
+  if (state_ != State::kWritingZip) {
+    return kInvalidState;
+  }
+
+  int32_t result = WritePending(0);
+  if (result != kNoError) {
+    return result;
+  }
+  if (files_.empty()) {
     return kInvalidState;
   }
 
@@ -282,6 +485,10 @@ int32_t ZipWriter::DiscardLastEntry() {
 int32_t ZipWriter::GetLastEntry(FileEntry* out_entry) {
   CHECK(out_entry != nullptr);
 
+  int32_t result = WritePending(0);
+  if (result != kNoError) {
+    return result;
+  }
   if (files_.empty()) {
     return kInvalidState;
   }
@@ -295,11 +502,7 @@ int32_t ZipWriter::PrepareDeflate() {
   // Initialize the z_stream for compression.
   z_stream_ = std::unique_ptr<z_stream, void (*)(z_stream*)>(new z_stream(), DeleteZStream);
 
-#pragma GCC diagnostic push
-#pragma GCC diagnostic ignored "-Wold-style-cast"
-  int zerr = deflateInit2(z_stream_.get(), Z_BEST_COMPRESSION, Z_DEFLATED, -MAX_WBITS,
-                          DEF_MEM_LEVEL, Z_DEFAULT_STRATEGY);
-#pragma GCC diagnostic pop
+  int zerr = DeflateInit(z_stream_.get());
 
   if (zerr != Z_OK) {
     if (zerr == Z_VERSION_ERROR) {
@@ -321,8 +524,24 @@ int32_t ZipWriter::WriteBytes(const void* data, size_t len) {
     return HandleError(kInvalidState);
   }
 
+  FileEntry* file = &current_file_entry_;
   int32_t result = kNoError;
-  if (current_file_entry_.compression_method & kCompressDeflated) {
+  if (deflate_pool_) {
+    PendingEntry* pending = deflate_pool_->entries.back().get();
+    file = &pending->entry;
+
+    const uint8_t* bytes = reinterpret_cast<const uint8_t*>(data);
+    size_t remaining = len;
+    while (remaining > 0 && result == kNoError) {
+      size_t count = std::min(remaining, kDeflateBlockSize - pending->input.size());
+      pending->input.insert(pending->input.end(), bytes, bytes + count);
+      bytes += count;
+      remaining -= count;
+      if (pending->input.size() == kDeflateBlockSize) {
+        result = SubmitBlock(false /* last */);
+      }
+    }
+  } else if (current_file_entry_.compression_method & kCompressDeflated) {
     result = CompressBytes(&current_file_entry_, data, len);
   } else {
     result = StoreBytes(&current_file_entry_, data, len);
@@ -332,9 +551,80 @@ int32_t ZipWriter::WriteBytes(const void* data, size_t len) {
     return result;
   }
 
-  current_file_entry_.crc32 =
-      crc32(current_file_entry_.crc32, reinterpret_cast<const Bytef*>(data), len);
-  current_file_entry_.uncompressed_size += len;
+  file->crc32 = crc32(file->crc32, reinterpret_cast<const Bytef*>(data), len);
+  file->uncompressed_size += len;
+  return kNoError;
+}
+
+int32_t ZipWriter::SubmitBlock(bool last) {
+  PendingEntry* pending = deflate_pool_->entries.back().get();
+  const bool compress = pending->entry.compression_method == kCompressDeflated;
+
+  // A deflated entry always ends with a last block, even an empty one, to finish the stream.
+  if (!pending->input.empty() || (last && compress)) {
+    std::shared_ptr<DeflateBlock> block(new DeflateBlock());
+    block->compress = compress;
+    block->last = last;
+    if (compress) {
+      block->dictionary.swap(pending->dictionary);
+      if (!last) {
+        size_t dictionary_size = std::min(pending->input.size(), kDeflateDictionarySize);
+        pending->dictionary.assign(pending->input.end() - dictionary_size, pending->input.end());
+      }
+    }
+    block->data.swap(pending->input);
+    pending->input.reserve(kDeflateBlockSize);
+    pending->blocks.push_back(block);
+    deflate_pool_->Submit(block);
+  }
+
+  // Write out what is ready, and wait if too much is not.
+  return WritePending(deflate_pool_->MaxPendingBlocks());
+}
+
+int32_t ZipWriter::WritePending(size_t max_pending_blocks) {
+  if (!deflate_pool_) {
+    return kNoError;
+  }
+
+  auto& entries = deflate_pool_->entries;
+  while (!entries.empty()) {
+    PendingEntry* pending = entries.front().get();
+    if (!pending->header_written) {
+      int32_t result = WriteLocalFileHeader(&pending->entry, pending->alignment);
+      if (result != kNoError) {
+        return result;
+      }
+      pending->header_written = true;
+    }
+
+    while (!pending->blocks.empty()) {
+      DeflateBlock* block = pending->blocks.front().get();
+      if (!deflate_pool_->IsDone(*block, deflate_pool_->pending_blocks > max_pending_blocks)) {
+        return kNoError;
+      }
+      if (block->result != kNoError) {
+        return HandleError(block->result);
+      }
+      if (fwrite(block->data.data(), 1, block->data.size(), file_) != block->data.size()) {
+        return HandleError(kIoError);
+      }
+      pending->entry.compressed_size += block->data.size();
+      current_offset_ += block->data.size();
+      pending->blocks.pop_front();
+      deflate_pool_->pending_blocks--;
+    }
+
+    if (!pending->finished) {
+      return kNoError;
+    }
+    int32_t result = WriteEntryTrailer(&pending->entry);
+    if (result != kNoError) {
+      return result;
+    }
+    files_.emplace_back(std::move(pending->entry));
+    entries.pop_front();
+  }
   return kNoError;
 }
 
@@ -425,6 +715,16 @@ int32_t ZipWriter::FinishEntry() {
     return kInvalidState;
   }
 
+  if (deflate_pool_) {
+    int32_t result = SubmitBlock(true /* last */);
+    if (result != kNoError) {
+      return result;
+    }
+    deflate_pool_->entries.back()->finished = true;
+    state_ = State::kWritingZip;
+    return WritePending(SIZE_MAX);
+  }
+
   if (current_file_entry_.compression_method & kCompressDeflated) {
     int32_t result = FlushCompressedBytes(&current_file_entry_);
     if (result != kNoError) {
@@ -432,7 +732,18 @@ int32_t ZipWriter::FinishEntry() {
     }
   }
 
-  if ((current_file_entry_.compression_method & kCompressDeflated) || !seekable_) {
+  int32_t result = WriteEntryTrailer(&current_file_entry_);
+  if (result != kNoError) {
+    return result;
+  }
+
+  files_.emplace_back(std::move(current_file_entry_));
+  state_ = State::kWritingZip;
+  return kNoError;
+}
+
+int32_t ZipWriter::WriteEntryTrailer(FileEntry* file) {
+  if ((file->compression_method & kCompressDeflated) || !seekable_) {
     // Some versions of ZIP don't allow STORED data to have a trailing DataDescriptor.
     // If this file is not seekable, or if the data is compressed, write a DataDescriptor.
     const uint32_t sig = DataDescriptor::kOptSignature;
@@ -441,21 +752,21 @@ int32_t ZipWriter::FinishEntry() {
     }
 
     DataDescriptor dd = {};
-    dd.crc32 = current_file_entry_.crc32;
-    dd.compressed_size = current_file_entry_.compressed_size;
-    dd.uncompressed_size = current_file_entry_.uncompressed_size;
+    dd.crc32 = file->crc32;
+    dd.compressed_size = file->compressed_size;
+    dd.uncompressed_size = file->uncompressed_size;
     if (fwrite(&dd, sizeof(dd), 1, file_) != 1) {
       return HandleError(kIoError);
     }
     current_offset_ += sizeof(DataDescriptor::kOptSignature) + sizeof(dd);
   } else {
     // Seek back to the header and rewrite to include the size.
-    if (fseeko(file_, current_file_entry_.local_file_header_offset, SEEK_SET) != 0) {
+    if (fseeko(file_, file->local_file_header_offset, SEEK_SET) != 0) {
       return HandleError(kIoError);
     }
 
     LocalFileHeader header = {};
-    CopyFromFileEntry(current_file_entry_, false /*use_data_descriptor*/, &header);
+    CopyFromFileEntry(*file, false /*use_data_descriptor*/, &header);
 
     if (fwrite(&header, sizeof(header), 1, file_) != 1) {
       return HandleError(kIoError);
@@ -466,8 +777,6 @@ int32_t ZipWriter::FinishEntry() {
     }
   }
 
-  files_.emplace_back(std::move(current_file_entry_));
-  state_ = State::kWritingZip;
   return kNoError;
 }
 
@@ -476,6 +785,11 @@ int32_t ZipWriter::Finish() {
     return kInvalidState;
   }
 
+  int32_t result = WritePending(0);
+  if (result != kNoError) {
+    return result;
+  }
+
   off_t startOfCdr = current_offset_;
   for (FileEntry& file : files_) {
     CentralDirectoryRecord cdr = {};
@@ -17,9 +17,11 @@
 #include "ziparchive/zip_writer.h"
 #include "ziparchive/zip_archive.h"
 
+#include <android-base/file.h>
 #include <android-base/test_utils.h>
 #include <gtest/gtest.h>
 #include <time.h>
+#include <algorithm>
 #include <memory>
 #include <vector>
 
@@ -286,6 +288,77 @@ TEST_F(zipwriter, WriteCompressedZipFlushFull) {
   CloseArchive(handle);
 }
 
+static void WriteZipWithDeflateThreads(FILE* file, size_t num_threads, const std::string& data) {
+  ZipWriter writer(file);
+  ASSERT_EQ(0, writer.SetDeflateThreads(num_threads));
+
+  // Spans several blocks, and is written in pieces that don't line up with them.
+  ASSERT_EQ(0, writer.StartEntry("large.txt", ZipWriter::kCompress));
+  for (size_t i = 0; i < data.size(); i += 100000) {
+    ASSERT_EQ(0, writer.WriteBytes(&data[i], std::min<size_t>(100000, data.size() - i)));
+  }
+  ASSERT_EQ(0, writer.FinishEntry());
+
+  ASSERT_EQ(0, writer.StartAlignedEntry("align.txt", 0, 4096));
+  ASSERT_EQ(0, writer.WriteBytes(data.data(), 300000));
+  ASSERT_EQ(0, writer.FinishEntry());
+
+  ASSERT_EQ(0, writer.StartEntry("empty.txt", ZipWriter::kCompress));
+  ASSERT_EQ(0, writer.FinishEntry());
+
+  ASSERT_EQ(0, writer.StartEntry("small.txt", ZipWriter::kCompress));
+  ASSERT_EQ(0, writer.WriteBytes("helo", 4));
+  ASSERT_EQ(0, writer.FinishEntry());
+
+  ASSERT_EQ(0, writer.Finish());
+}
+
+TEST_F(zipwriter, WriteWithDeflateThreads) {
+  std::string data;
+  for (size_t i = 0; i < 1000000; i++) {
+    data.push_back("abcdefghij"[(i * 7 + i / 1000) % 10]);
+  }
+
+  WriteZipWithDeflateThreads(file_, 3, data);
+  ASSERT_EQ(0, fflush(file_));
+
+  ZipArchiveHandle handle;
+  ASSERT_EQ(0, OpenArchiveFd(fd_, "temp", &handle, false));
+
+  ZipEntry entry;
+  ASSERT_EQ(0, FindEntry(handle, ZipString("large.txt"), &entry));
+  EXPECT_EQ(kCompressDeflated, entry.method);
+  EXPECT_GT(data.size(), entry.compressed_length);
+  ASSERT_TRUE(AssertFileEntryContentsEq(data, handle, &entry));
+
+  ASSERT_EQ(0, FindEntry(handle, ZipString("align.txt"), &entry));
+  EXPECT_EQ(kCompressStored, entry.method);
+  EXPECT_EQ(0, entry.offset & 0xfff);
+  ASSERT_TRUE(AssertFileEntryContentsEq(data.substr(0, 300000), handle, &entry));
+
+  ASSERT_EQ(0, FindEntry(handle, ZipString("empty.txt"), &entry));
+  ASSERT_TRUE(AssertFileEntryContentsEq("", handle, &entry));
+
+  ASSERT_EQ(0, FindEntry(handle, ZipString("small.txt"), &entry));
+  ASSERT_TRUE(AssertFileEntryContentsEq("helo", handle, &entry));
+
+  CloseArchive(handle);
+
+  // The archive doesn't depend on the number of threads.
+  std::string expected;
+  ASSERT_EQ(0, lseek(fd_, 0, SEEK_SET));
+  ASSERT_TRUE(android::base::ReadFdToString(fd_, &expected));
+
+  TemporaryFile other;
+  FILE* other_file = fdopen(other.release(), "w");
+  ASSERT_NE(nullptr, other_file);
+  WriteZipWithDeflateThreads(other_file, 1, data);
+  ASSERT_EQ(0, fclose(other_file));
+  std::string actual;
+  ASSERT_TRUE(android::base::ReadFileToString(other.path, &actual));
+  ASSERT_EQ(expected, actual);
+}
+
 TEST_F(zipwriter, CheckStartEntryErrors) {
   ZipWriter writer(file_);
 
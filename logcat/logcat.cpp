@@ -32,9 +32,11 @@
 #include <sys/socket.h>
 #include <sys/stat.h>
 #include <sys/types.h>
+#include <sys/uio.h>
 #include <time.h>
 #include <unistd.h>
 
+#include <algorithm>
 #include <atomic>
 #include <memory>
 #include <string>
@@ -48,14 +50,25 @@
 #include <cutils/sockets.h>
 #include <log/event_tag_map.h>
 #include <log/getopt.h>
+#include <log/log_frame.h>
 #include <log/logcat.h>
 #include <log/logprint.h>
 #include <private/android_logger.h>
 #include <system/thread_defs.h>
 
 #include <pcrecpp.h>
+#include <zlib.h>
 
 #define DEFAULT_MAX_ROTATED_LOGS 4
+// --rotate-compress keeps up to this many times --rotate-count compressed
+// logs, as many as fit in --rotate-count * --rotate-kbytes.
+#define MAX_COMPRESSED_LOGS_FACTOR 8
+#define OUTPUT_BUFFER_SIZE (64 * 1024)
+#define PERSIST_SYNC_PERIOD_SEC 1
+
+// printBinary
+#define BINARY_RAW 1     // struct log_msg as read
+#define BINARY_FRAMED 2  // log/log_frame.h records
 
 struct log_device_t {
     const char* device;
@@ -108,6 +121,17 @@ struct android_logcat_context_internal {
     // 0 means "unbounded"
     size_t maxRotatedLogs;
     size_t outByteCount;
+    // --rotate-compress, output is buffered and synced, and rotated logs
+    // compressed, by persistThread()
+    bool rotateCompress;
+    bool persistStarted;
+    bool persistStop;   // persistLock
+    bool persistDirty;  // persistLock, written to since the last fdatasync
+    pthread_t persistThr;
+    pthread_mutex_t persistLock;
+    pthread_cond_t persistCond;
+    std::string outBuffer;                   // persistLock
+    std::vector<std::string> compressQueue;  // persistLock
     int printBinary;
     int devCount;  // >1 means multiple
     pcrecpp::RE* regex;
@@ -135,6 +159,8 @@ android_logcat_context create_android_logcat() {
     context->output_fd = -1;
     context->error_fd = -1;
     context->maxRotatedLogs = DEFAULT_MAX_ROTATED_LOGS;
+    pthread_mutex_init(&context->persistLock, nullptr);
+    pthread_cond_init(&context->persistCond, nullptr);
 
     context->argv_hold.clear();
     context->args.clear();
@@ -231,23 +257,296 @@ static void close_error(android_logcat_context_internal* context) {
     }
 }
 
+// Compute the maximum number of digits needed to count up to
+// count in decimal.  eg:
+// count == 30
+//   -> log10(30) == 1.477
+//   -> rotationCountDigits == 2
+static int rotationCountDigits(size_t count) {
+    return (count > 0) ? (int)(floor(log10(count) + 1)) : 0;
+}
+
+static std::string compressedLogName(android_logcat_context_internal* context,
+                                     size_t i) {
+    size_t maxCount = context->maxRotatedLogs * MAX_COMPRESSED_LOGS_FACTOR;
+    return android::base::StringPrintf("%s.%.*zu.gz", context->outputFileName,
+                                       rotationCountDigits(maxCount), i);
+}
+
+// The --rotate-compress files next to outputFileName, sorted. Rotated logs
+// are "<file>.pending.<time>" until compressed into "<file>.<n>.gz".
+static std::vector<std::string> compressedLogs(const char* outputFileName,
+                                               bool pendingOnly) {
+    std::vector<std::string> files;
+
+    std::string directory;
+    const char* file = strrchr(outputFileName, '/');
+    if (!file) {
+        directory = ".";
+        file = outputFileName;
+    } else {
+        directory = std::string(outputFileName, file - outputFileName);
+        ++file;
+    }
+
+    std::unique_ptr<DIR, int (*)(DIR*)> dir(opendir(directory.c_str()),
+                                            closedir);
+    if (!dir.get()) return files;
+
+    static const char pending[] = ".pending.";
+    static const char gz[] = ".gz";
+    size_t len = strlen(file);
+    struct dirent* dp;
+    while (!!(dp = readdir(dir.get()))) {
+        if ((dp->d_type != DT_REG) || !!strncmp(dp->d_name, file, len)) {
+            continue;
+        }
+        const char* suffix = dp->d_name + len;
+        bool isGz = android::base::EndsWith(suffix, gz);
+        if (!strncmp(suffix, pending, strlen(pending))) {
+            // a compression was interrupted if it ends in .gz
+            if (pendingOnly && isGz) continue;
+        } else {
+            if (pendingOnly || (*suffix != '.') || !isdigit(suffix[1])) {
+                continue;
+            }
+            char* ep;
+            strtoull(suffix + 1, &ep, 10);
+            if (strcmp(ep, gz)) continue;
+        }
+        files.push_back(directory + "/" + dp->d_name);
+    }
+    std::sort(files.begin(), files.end());
+    return files;
+}
+
+// persistLock assumed
+static void flushOutputLocked(android_logcat_context_internal* context) {
+    if (context->outBuffer.empty()) return;
+    if (context->output_fd >= 0) {
+        android::base::WriteFully(context->output_fd, context->outBuffer.data(),
+                                  context->outBuffer.size());
+        context->persistDirty = true;
+    }
+    context->outBuffer.clear();
+}
+
+// All output to the log file goes through here, so that --rotate-compress
+// can batch it up.
+static ssize_t writeOutputv(android_logcat_context_internal* context,
+                            const struct iovec* iov, int iovcnt) {
+    if (!context->persistStarted) {
+        return TEMP_FAILURE_RETRY(writev(context->output_fd, iov, iovcnt));
+    }
+
+    ssize_t len = 0;
+    pthread_mutex_lock(&context->persistLock);
+    for (int i = 0; i < iovcnt; ++i) {
+        context->outBuffer.append(static_cast<const char*>(iov[i].iov_base),
+                                  iov[i].iov_len);
+        len += iov[i].iov_len;
+    }
+    if (context->outBuffer.size() >= OUTPUT_BUFFER_SIZE) {
+        flushOutputLocked(context);
+    }
+    pthread_mutex_unlock(&context->persistLock);
+    return len;
+}
+
+static ssize_t writeOutput(android_logcat_context_internal* context,
+                           const char* buf, size_t len) {
+    struct iovec iov = { const_cast<char*>(buf), len };
+    return writeOutputv(context, &iov, 1);
+}
+
+static int printLogLine(android_logcat_context_internal* context,
+                        const AndroidLogEntry* entry) {
+    if (!context->persistStarted) {
+        return android_log_printLogLine(context->logformat, context->output_fd,
+                                        entry);
+    }
+
+    char defaultBuffer[512];
+    size_t totalLen;
+    char* outBuffer =
+        android_log_formatLogLine(context->logformat, defaultBuffer,
+                                  sizeof(defaultBuffer), entry, &totalLen);
+    if (!outBuffer) return -1;
+    writeOutput(context, outBuffer, totalLen);
+    if (outBuffer != defaultBuffer) free(outBuffer);
+    return totalLen;
+}
+
+// Compress a pending rotated log into <file>.1.gz, shifting the older ones up
+// and dropping those that no longer fit in the rotation budget. The newest is
+// always kept.
+static void compressRotated(android_logcat_context_internal* context,
+                            const std::string& pending) {
+    int in = TEMP_FAILURE_RETRY(open(pending.c_str(), O_RDONLY | O_CLOEXEC));
+    if (in < 0) return;
+
+    std::string tmp = pending + ".gz";
+    int out = TEMP_FAILURE_RETRY(
+        open(tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC,
+             S_IRUSR | S_IWUSR));
+    gzFile gz = (out >= 0) ? gzdopen(out, "wb") : nullptr;
+    if (!gz && (out >= 0)) close(out);
+
+    bool ok = !!gz;
+    std::unique_ptr<char[]> buf(new char[OUTPUT_BUFFER_SIZE]);
+    ssize_t len = 0;
+    while (ok && ((len = TEMP_FAILURE_RETRY(
+                       read(in, buf.get(), OUTPUT_BUFFER_SIZE))) > 0)) {
+        ok = gzwrite(gz, buf.get(), len) == len;
+    }
+    close(in);
+    if (len < 0) ok = false;
+    if (gz && (gzclose(gz) != Z_OK)) ok = false;
+    if (!ok) {
+        // leave it pending, retried when we next start up
+        unlink(tmp.c_str());
+        return;
+    }
+
+    size_t maxCount = context->maxRotatedLogs * MAX_COMPRESSED_LOGS_FACTOR;
+    for (size_t i = maxCount; i > 0; --i) {
+        std::string file0 = (i == 1) ? tmp : compressedLogName(context, i - 1);
+        if ((rename(file0.c_str(), compressedLogName(context, i).c_str()) < 0) &&
+            (errno != ENOENT)) {
+            perror("while rotating compressed log files");
+        }
+    }
+    unlink(pending.c_str());
+
+    size_t budget =
+        context->maxRotatedLogs * context->logRotateSizeKBytes * 1024;
+    size_t total = 0;
+    for (size_t i = 1; i <= maxCount; ++i) {
+        std::string file = compressedLogName(context, i);
+        struct stat st;
+        if (stat(file.c_str(), &st)) continue;
+        total += st.st_size;
+        if ((i > 1) && (total > budget)) unlink(file.c_str());
+    }
+}
+
+// --rotate-compress, flushes and fdatasyncs the buffered output at least
+// every PERSIST_SYNC_PERIOD_SEC, and compresses the rotated logs, so that the
+// read loop never waits on the storage.
+static void* persistThread(void* arg) {
+    android_logcat_context_internal* context =
+        static_cast<android_logcat_context_internal*>(arg);
+
+    pthread_mutex_lock(&context->persistLock);
+    for (;;) {
+        if (context->compressQueue.empty() && !context->persistStop) {
+            struct timespec ts;
+            clock_gettime(CLOCK_REALTIME, &ts);
+            ts.tv_sec += PERSIST_SYNC_PERIOD_SEC;
+            pthread_cond_timedwait(&context->persistCond, &context->persistLock,
+                                   &ts);
+        }
+
+        flushOutputLocked(context);
+        int fd = -1;
+        if (context->persistDirty && (context->output_fd >= 0)) {
+            fd = dup(context->output_fd);
+            context->persistDirty = false;
+        }
+        std::vector<std::string> queue;
+        queue.swap(context->compressQueue);
+        bool stop = context->persistStop;
+        pthread_mutex_unlock(&context->persistLock);
+
+        if (fd >= 0) {
+            fdatasync(fd);
+            close(fd);
+        }
+        for (const auto& file : queue) compressRotated(context, file);
+
+        pthread_mutex_lock(&context->persistLock);
+        if (stop && context->compressQueue.empty()) break;
+    }
+    pthread_mutex_unlock(&context->persistLock);
+
+    return nullptr;
+}
+
+static void startPersist(android_logcat_context_internal* context) {
+    if (!context->rotateCompress || context->persistStarted) return;
+
+    // pick up what an earlier run did not get to compress
+    context->compressQueue = compressedLogs(context->outputFileName, true);
+    context->persistStop = false;
+    context->persistStarted = !pthread_create(&context->persistThr, nullptr,
+                                              persistThread, context);
+}
+
+// Flushes the output, and waits for the pending compressions.
+static void stopPersist(android_logcat_context_internal* context) {
+    if (!context->persistStarted) return;
+
+    pthread_mutex_lock(&context->persistLock);
+    context->persistStop = true;
+    pthread_cond_signal(&context->persistCond);
+    pthread_mutex_unlock(&context->persistLock);
+    pthread_join(context->persistThr, nullptr);
+    context->persistStarted = false;
+}
+
+static void reopenOutput(android_logcat_context_internal* context) {
+    context->output_fd = openLogFile(context->outputFileName);
+
+    if (context->output_fd < 0) {
+        logcat_panic(context, HELP_FALSE, "couldn't open output file");
+        return;
+    }
+    context->output = fdopen(context->output_fd, "web");
+    if (!context->output) {
+        logcat_panic(context, HELP_FALSE, "couldn't fdopen output file");
+        return;
+    }
+    if (context->stderr_stdout) {
+        close_error(context);
+        context->error = context->output;
+        context->error_fd = context->output_fd;
+    }
+
+    context->outByteCount = 0;
+}
+
 static void rotateLogs(android_logcat_context_internal* context) {
     int err;
 
     // Can't rotate logs if we're not outputting to a file
     if (!context->outputFileName) return;
 
+    // Just move the log out of the way, the persist thread compresses it and
+    // shifts the older ones.
+    if (context->persistStarted && context->maxRotatedLogs) {
+        pthread_mutex_lock(&context->persistLock);
+        flushOutputLocked(context);
+        close_output(context);
+
+        log_time now(CLOCK_REALTIME);
+        std::string pending = android::base::StringPrintf(
+            "%s.pending.%u.%09u", context->outputFileName, now.tv_sec,
+            now.tv_nsec);
+        if (rename(context->outputFileName, pending.c_str()) < 0) {
+            perror("while rotating log files");
+        } else {
+            context->compressQueue.push_back(pending);
+            pthread_cond_signal(&context->persistCond);
+        }
+
+        reopenOutput(context);
+        pthread_mutex_unlock(&context->persistLock);
+        return;
+    }
+
     close_output(context);
 
-    // Compute the maximum number of digits needed to count up to
-    // maxRotatedLogs in decimal.  eg:
-    // maxRotatedLogs == 30
-    //   -> log10(30) == 1.477
-    //   -> maxRotationCountDigits == 2
-    int maxRotationCountDigits =
-        (context->maxRotatedLogs > 0)
-            ? (int)(floor(log10(context->maxRotatedLogs) + 1))
-            : 0;
+    int maxRotationCountDigits = rotationCountDigits(context->maxRotatedLogs);
 
     for (int i = context->maxRotatedLogs; i > 0; i--) {
         std::string file1 = android::base::StringPrintf(
@@ -274,30 +573,33 @@ static void rotateLogs(android_logcat_context_internal* context) {
         }
     }
 
-    context->output_fd = openLogFile(context->outputFileName);
-
-    if (context->output_fd < 0) {
-        logcat_panic(context, HELP_FALSE, "couldn't open output file");
-        return;
-    }
-    context->output = fdopen(context->output_fd, "web");
-    if (!context->output) {
-        logcat_panic(context, HELP_FALSE, "couldn't fdopen output file");
-        return;
-    }
-    if (context->stderr_stdout) {
-        close_error(context);
-        context->error = context->output;
-        context->error_fd = context->output_fd;
-    }
-
-    context->outByteCount = 0;
+    reopenOutput(context);
 }
 
 void printBinary(android_logcat_context_internal* context, struct log_msg* buf) {
-    size_t size = buf->len();
+    ssize_t bytesWritten;
+
+    if (context->printBinary == BINARY_FRAMED) {
+        // no reformatting, the payload goes out straight from buf
+        android_log_frame_t frame;
+        int len = android_log_frame_header(buf, &frame);
+        if (len < 0) return;
 
-    TEMP_FAILURE_RETRY(write(context->output_fd, buf, size));
+        struct iovec iov[2] = {
+            { &frame, sizeof(frame) }, { buf->msg(), static_cast<size_t>(len) },
+        };
+        bytesWritten = writeOutputv(context, iov, 2);
+    } else {
+        bytesWritten =
+            writeOutput(context, reinterpret_cast<const char*>(buf), buf->len());
+    }
+
+    if (bytesWritten > 0) context->outByteCount += bytesWritten;
+
+    if (context->logRotateSizeKBytes > 0 &&
+        (context->outByteCount / 1024) >= context->logRotateSizeKBytes) {
+        rotateLogs(context);
+    }
 }
 
 static bool regexOk(android_logcat_context_internal* context,
@@ -338,8 +640,7 @@ static void processBuffer(android_logcat_context_internal* context,
 
         context->printCount += match;
         if (match || context->printItAnyways) {
-            bytesWritten = android_log_printLogLine(context->logformat,
-                                                    context->output_fd, &entry);
+            bytesWritten = printLogLine(context, &entry);
 
             if (bytesWritten < 0) {
                 logcat_panic(context, HELP_FALSE, "output error");
@@ -363,7 +664,7 @@ static void maybePrintStart(android_logcat_context_internal* context,
             char buf[1024];
             snprintf(buf, sizeof(buf), "--------- %s %s\n",
                      dev->printed ? "switch to" : "beginning of", dev->device);
-            if (write(context->output_fd, buf, strlen(buf)) < 0) {
+            if (writeOutput(context, buf, strlen(buf)) < 0) {
                 logcat_panic(context, HELP_FALSE, "output error");
                 return;
             }
@@ -421,6 +722,8 @@ static void setupOutputAndSchedulingPolicy(
     context->output = fdopen(context->output_fd, "web");
 
     context->outByteCount = statbuf.st_size;
+
+    startPersist(context);
 }
 
 // clang-format off
@@ -439,6 +742,10 @@ static void show_help(android_logcat_context_internal* context) {
                     "                  Rotate log every kbytes. Requires -f option\n"
                     "  -n <count>, --rotate-count=<count>\n"
                     "                  Sets max number of rotated logs to <count>, default 4\n"
+                    "  --rotate-compress\n"
+                    "                  Compress rotated logs in the background, keeping as many\n"
+                    "                  as fit in <count> * <kbytes>, up to 8 * <count>. The log\n"
+                    "                  file is buffered and synced every second. Requires -r\n"
                     "  --id=<id>       If the signature id for logging to file changes, then clear\n"
                     "                  the fileset and continue\n"
                     "  -v <format>, --format=<format>\n"
@@ -482,6 +789,8 @@ static void show_help(android_logcat_context_internal* context) {
                     "                  Multiple -b parameters or comma separated list of buffers are\n"
                     "                  allowed. Buffers interleaved. Default -b main,system,crash.\n"
                     "  -B, --binary    Output the log in binary.\n"
+                    "  --binary=framed Output the log as length prefixed records of the entries\n"
+                    "                  as received, see <log/log_frame.h>.\n"
                     "  -S, --statistics                       Output statistics.\n"
                     "  -p, --prune     Print prune white and ~black list. Service is specified as\n"
                     "                  UID, UID/PID or /PID. Weighed for quicker pruning if prefix\n"
@@ -500,7 +809,8 @@ static void show_help(android_logcat_context_internal* context) {
 
     fprintf(context->error, "\nfilterspecs are a series of \n"
                    "  <tag>[:priority]\n\n"
-                   "where <tag> is a log component tag (or * for all) and priority is:\n"
+                   "where <tag> is a log component tag (or * for all, or <prefix>* for all\n"
+                   "tags starting with <prefix>) and priority is:\n"
                    "  V    Verbose (default for <tag>)\n"
                    "  D    Debug (default for '*')\n"
                    "  I    Info\n"
@@ -740,6 +1050,9 @@ static int __logcat(android_logcat_context_internal* context) {
     const char* setId = nullptr;
     int mode = ANDROID_LOG_RDONLY;
     std::string forceFilters;
+    // Same filterspec as given to android_log_addFilterString(), pushed
+    // down so logd does not send what we are not going to print.
+    std::string filterspec;
     log_device_t* dev;
     struct logger_list* logger_list;
     size_t tail_lines = 0;
@@ -869,9 +1182,10 @@ static int __logcat(android_logcat_context_internal* context) {
         static const char id_str[] = "id";
         static const char wrap_str[] = "wrap";
         static const char print_str[] = "print";
+        static const char rotate_compress_str[] = "rotate-compress";
         // clang-format off
         static const struct option long_options[] = {
-          { "binary",        no_argument,       nullptr, 'B' },
+          { "binary",        optional_argument, nullptr, 'B' },
           { "buffer",        required_argument, nullptr, 'b' },
           { "buffer-size",   optional_argument, nullptr, 'g' },
           { "clear",         no_argument,       nullptr, 'c' },
@@ -891,6 +1205,7 @@ static int __logcat(android_logcat_context_internal* context) {
           { print_str,       no_argument,       nullptr, 0 },
           { "prune",         optional_argument, nullptr, 'p' },
           { "regex",         required_argument, nullptr, 'e' },
+          { rotate_compress_str, no_argument,   nullptr, 0 },
           { "rotate-count",  required_argument, nullptr, 'n' },
           { "rotate-kbytes", required_argument, nullptr, 'r' },
           { "statistics",    no_argument,       nullptr, 'S' },
@@ -948,6 +1263,10 @@ static int __logcat(android_logcat_context_internal* context) {
                     context->debug = true;
                     break;
                 }
+                if (long_options[option_index].name == rotate_compress_str) {
+                    context->rotateCompress = true;
+                    break;
+                }
                 if (long_options[option_index].name == id_str) {
                     setId = (optctx.optarg && optctx.optarg[0]) ? optctx.optarg
                                                                 : nullptr;
@@ -957,6 +1276,8 @@ static int __logcat(android_logcat_context_internal* context) {
             case 's':
                 // default to all silent
                 android_log_addFilterRule(context->logformat, "*:s");
+                // ahead of the filterspecs, logd lets the last match win
+                filterspec = "*:S";
                 break;
 
             case 'c':
@@ -1142,7 +1463,16 @@ static int __logcat(android_logcat_context_internal* context) {
             } break;
 
             case 'B':
-                context->printBinary = 1;
+                context->printBinary = BINARY_RAW;
+                if (optctx.optarg) {
+                    if (strcmp(optctx.optarg, "framed")) {
+                        logcat_panic(context, HELP_TRUE,
+                                     "Invalid parameter \"%s\" to --binary\n",
+                                     optctx.optarg);
+                        goto exit;
+                    }
+                    context->printBinary = BINARY_FRAMED;
+                }
                 break;
 
             case 'f':
@@ -1352,6 +1682,12 @@ static int __logcat(android_logcat_context_internal* context) {
         goto exit;
     }
 
+    if (context->rotateCompress && !context->logRotateSizeKBytes) {
+        logcat_panic(context, HELP_TRUE,
+                     "--rotate-compress requires -r as well\n");
+        goto exit;
+    }
+
     if (!!setId) {
         if (!context->outputFileName) {
             logcat_panic(context, HELP_TRUE,
@@ -1393,6 +1729,8 @@ static int __logcat(android_logcat_context_internal* context) {
     }
 
     if (forceFilters.size()) {
+        if (filterspec.length()) filterspec += ' ';
+        filterspec += forceFilters;
         err = android_log_addFilterString(context->logformat,
                                           forceFilters.c_str());
         if (err < 0) {
@@ -1405,6 +1743,8 @@ static int __logcat(android_logcat_context_internal* context) {
         const char* env_tags_orig = android::getenv(context, "ANDROID_LOG_TAGS");
 
         if (!!env_tags_orig) {
+            if (filterspec.length()) filterspec += ' ';
+            filterspec += env_tags_orig;
             err = android_log_addFilterString(context->logformat,
                                               env_tags_orig);
 
@@ -1428,6 +1768,8 @@ static int __logcat(android_logcat_context_internal* context) {
                              "Invalid filter expression '%s'\n", argv[i]);
                 goto exit;
             }
+            if (filterspec.length()) filterspec += ' ';
+            filterspec += argv[i];
         }
     }
 
@@ -1437,6 +1779,10 @@ static int __logcat(android_logcat_context_internal* context) {
     } else {
         logger_list = android_logger_list_alloc(mode, tail_lines, pid);
     }
+    // Binary output is written out unfiltered, keep it that way.
+    if (filterspec.length() && !context->printBinary) {
+        __android_logger_list_set_filter(logger_list, filterspec.c_str());
+    }
     // We have three orthogonal actions below to clear, set log size and
     // get log size. All sharing the same iteration loop.
     while (dev) {
@@ -1452,9 +1798,7 @@ static int __logcat(android_logcat_context_internal* context) {
         if (clearLog || setId) {
             if (context->outputFileName) {
                 int maxRotationCountDigits =
-                    (context->maxRotatedLogs > 0) ?
-                        (int)(floor(log10(context->maxRotatedLogs) + 1)) :
-                        0;
+                    android::rotationCountDigits(context->maxRotatedLogs);
 
                 for (int i = context->maxRotatedLogs ; i >= 0 ; --i) {
                     std::string file;
@@ -1480,6 +1824,16 @@ static int __logcat(android_logcat_context_internal* context) {
                         reportErrorName(&clearFail, dev->device, allSelected);
                     }
                 }
+
+                for (const auto& file :
+                     android::compressedLogs(context->outputFileName, false)) {
+                    err = unlink(file.c_str());
+
+                    if (err < 0 && errno != ENOENT && !clearFail) {
+                        perror("while clearing log files");
+                        reportErrorName(&clearFail, dev->device, allSelected);
+                    }
+                }
             } else if (android_logger_clear(dev->logger)) {
                 reportErrorName(&clearFail, dev->device, allSelected);
             }
@@ -1672,6 +2026,7 @@ close:
     android_logger_list_free(logger_list);
 
 exit:
+    android::stopPersist(context);
     // close write end of pipe to help things along
     if (context->output_fd == context->fds[1]) {
         android::close_output(context);
@@ -1826,6 +2181,8 @@ int android_logcat_destroy(android_logcat_context* ctx) {
     context->args.clear();
     context->envp_hold.clear();
     context->envs.clear();
+    context->outBuffer.clear();
+    context->compressQueue.clear();
     if (context->fds[0] >= 0) {
         close(context->fds[0]);
         context->fds[0] = -1;
@@ -1857,6 +2214,8 @@ int android_logcat_destroy(android_logcat_context* ctx) {
 
     int retval = context->retval;
 
+    pthread_cond_destroy(&context->persistCond);
+    pthread_mutex_destroy(&context->persistLock);
     free(context);
 
     return retval;
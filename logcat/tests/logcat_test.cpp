@@ -906,6 +906,62 @@ TEST(logcat, logrotate_suffix) {
     EXPECT_FALSE(IsFalse(system(command), command));
 }
 
+TEST(logcat, logrotate_compress) {
+    static const char tmp_out_dir_form[] =
+        "/data/local/tmp/logcat.logrotate.XXXXXX";
+    char tmp_out_dir[sizeof(tmp_out_dir_form)];
+    ASSERT_TRUE(NULL != mkdtemp(strcpy(tmp_out_dir, tmp_out_dir_form)));
+
+    static const char logcat_cmd[] = logcat_executable
+        " -b radio -b events -b system -b main"
+        " -d -f %s/log.txt -n 4 -r 1 --rotate-compress";
+    char command[sizeof(tmp_out_dir) + sizeof(logcat_cmd)];
+    snprintf(command, sizeof(command), logcat_cmd, tmp_out_dir);
+
+    int ret;
+    EXPECT_FALSE(IsFalse(ret = logcat_system(command), command));
+    if (!ret) {
+        snprintf(command, sizeof(command), "ls %s 2>/dev/null", tmp_out_dir);
+
+        FILE* fp;
+        EXPECT_TRUE(NULL != (fp = popen(command, "r")));
+        char buffer[BIG_BUFFER];
+        int log_file_count = 0;
+
+        while (fgets(buffer, sizeof(buffer), fp)) {
+            static const char rotated_log_filename_prefix[] = "log.txt.";
+            static const size_t rotated_log_filename_prefix_len =
+                strlen(rotated_log_filename_prefix);
+
+            if (!strncmp(buffer, rotated_log_filename_prefix,
+                         rotated_log_filename_prefix_len)) {
+                // Compressed file should have form log.txt.##.gz, up to 8
+                // times -n of them, and none left pending.
+                char* rotated_log_filename_suffix =
+                    buffer + rotated_log_filename_prefix_len;
+                char* endptr;
+                const long int suffix_value =
+                    strtol(rotated_log_filename_suffix, &endptr, 10);
+                EXPECT_EQ(rotated_log_filename_suffix + 2, endptr);
+                EXPECT_STREQ(".gz\n", endptr);
+                EXPECT_LE(suffix_value, 32);
+                EXPECT_GT(suffix_value, 0);
+                ++log_file_count;
+                continue;
+            }
+
+            if (!strcmp(buffer, "log.txt\n")) continue;
+
+            fprintf(stderr, "ERROR: Unexpected file: %s", buffer);
+            ADD_FAILURE();
+        }
+        pclose(fp);
+        EXPECT_LT(4, log_file_count);
+    }
+    snprintf(command, sizeof(command), "rm -rf %s", tmp_out_dir);
+    EXPECT_FALSE(IsFalse(system(command), command));
+}
+
 TEST(logcat, logrotate_continue) {
     static const char tmp_out_dir_form[] =
         "/data/local/tmp/logcat.logrotate.XXXXXX";
@@ -80,7 +80,7 @@ void FlushCommand::runSocketCommand(SocketClient* client) {
             return;
         }
         entry = new LogTimeEntry(mReader, client, mNonBlock, mTail, mLogMask,
-                                 mPid, mStart, mTimeout);
+                                 mPid, mStart, mTimeout, mFilter);
         times.push_front(entry);
     }
 
@@ -33,19 +33,21 @@ class FlushCommand : public SocketClientCommand {
     pid_t mPid;
     log_time mStart;
     uint64_t mTimeout;
+    const char* mFilter;  // LogTagFilter spec, valid for the call only
 
    public:
     // for opening a reader
     explicit FlushCommand(LogReader& reader, bool nonBlock, unsigned long tail,
                           log_mask_t logMask, pid_t pid, log_time start,
-                          uint64_t timeout)
+                          uint64_t timeout, const char* filter = nullptr)
         : mReader(reader),
           mNonBlock(nonBlock),
           mTail(tail),
           mLogMask(logMask),
           mPid(pid),
           mStart(start),
-          mTimeout((start != log_time::EPOCH) ? timeout : 0) {
+          mTimeout((start != log_time::EPOCH) ? timeout : 0),
+          mFilter(filter) {
     }
 
     // for notification of an update
@@ -56,7 +58,8 @@ class FlushCommand : public SocketClientCommand {
           mLogMask(logMask),
           mPid(0),
           mStart(log_time::EPOCH),
-          mTimeout(0) {
+          mTimeout(0),
+          mFilter(nullptr) {
     }
 
     virtual void runSocketCommand(SocketClient* client);
@@ -26,7 +26,10 @@
 #include <time.h>
 #include <unistd.h>
 
+#include <atomic>
+#include <string>
 #include <unordered_map>
+#include <vector>
 
 #include <cutils/properties.h>
 #include <private/android_logger.h>
@@ -72,7 +75,10 @@ void LogBuffer::init() {
         // as the act of mounting /data would trigger persist.logd.timestamp to
         // be corrected. 1/30 corner case YMMV.
         //
-        rdlock();
+        // The time index is rebuilt as entries come in.
+        //
+        wrlock();
+        mIndex.clear();
         LogBufferElementCollection::iterator it = mLogElements.begin();
         while ((it != mLogElements.end())) {
             LogBufferElement* e = *it;
@@ -116,12 +122,17 @@ void LogBuffer::init() {
 }
 
 LogBuffer::LogBuffer(LastLogTimes* times)
-    : monotonic(android_log_clockid() == CLOCK_MONOTONIC), mTimes(*times) {
+    : mCompress(false),
+      monotonic(android_log_clockid() == CLOCK_MONOTONIC),
+      mTimes(*times) {
     pthread_rwlock_init(&mLogElementsLock, nullptr);
 
     log_id_for_each(i) {
         lastLoggedElements[i] = nullptr;
         droppedElements[i] = nullptr;
+        mBlockSizes[i] = 0;
+        mColdSet[i] = false;
+        mColdRetry[i] = 0;
     }
 
     init();
@@ -198,6 +209,33 @@ static enum match_type identical(LogBufferElement* elem,
 
 int LogBuffer::log(log_id_t log_id, log_time realtime, uid_t uid, pid_t pid,
                    pid_t tid, const char* msg, unsigned short len) {
+    bool queued;
+    int ret = enqueue(log_id, realtime, uid, pid, tid, msg, len, queued);
+    if (queued && !drain()) stats.addDeferred();
+    return ret;
+}
+
+// Same as log() for each entry, but the batch is merged into the buffer with
+// a single acquisition of the lock.
+void LogBuffer::logBatch(const LogBufferEntry* entries, size_t count,
+                         int* result) {
+    bool queued = false;
+    for (size_t i = 0; i < count; ++i) {
+        const LogBufferEntry& e = entries[i];
+        bool q;
+        result[i] = enqueue(e.log_id, e.realtime, e.uid, e.pid, e.tid, e.msg,
+                            e.len, q);
+        queued |= q;
+    }
+    if (queued && !drain()) stats.addDeferred();
+}
+
+// Validate and hand the entry over to mPending, queued is set if it is
+// waiting there for a drain(). Returns the result for log().
+int LogBuffer::enqueue(log_id_t log_id, log_time realtime, uid_t uid,
+                       pid_t pid, pid_t tid, const char* msg,
+                       unsigned short len, bool& queued) {
+    queued = false;
     if ((log_id >= LOG_ID_MAX) || (log_id < 0)) {
         return -EINVAL;
     }
@@ -207,8 +245,12 @@ int LogBuffer::log(log_id_t log_id, log_time realtime, uid_t uid, pid_t pid,
     // exact entry with time specified in ms or us precision.
     if ((realtime.tv_nsec % 1000) == 0) ++realtime.tv_nsec;
 
-    LogBufferElement* elem =
-        new LogBufferElement(log_id, realtime, uid, pid, tid, msg, len);
+    LogBufferElement* elem = new (mArena[log_id], len)
+        LogBufferElement(log_id, realtime, uid, pid, tid, msg, len);
+    if (!elem) {
+        return -ENOMEM;
+    }
+    bool loggable = true;
     if (log_id != LOG_ID_SECURITY) {
         int prio = ANDROID_LOG_INFO;
         const char* tag = nullptr;
@@ -223,18 +265,66 @@ int LogBuffer::log(log_id_t log_id, log_time realtime, uid_t uid, pid_t pid,
             tag = msg + 1;
             tag_len = strnlen(tag, len - 1);
         }
-        if (!__android_log_is_loggable_len(prio, tag, tag_len,
-                                           ANDROID_LOG_VERBOSE)) {
-            // Log traffic received to total
-            wrlock();
-            stats.addTotal(elem);
-            unlock();
-            delete elem;
-            return -EACCES;
+        loggable = __android_log_is_loggable_len(prio, tag, tag_len,
+                                                 ANDROID_LOG_VERBOSE);
+    }
+
+    // Hand the element over without waiting behind readers, whoever holds
+    // the lock merges it on the way out.
+    if (mPending.push(elem, loggable)) {
+        queued = true;
+    } else {
+        // queue is full, wait our turn and catch up.
+        log_time start(CLOCK_MONOTONIC);
+        pthread_rwlock_wrlock(&mLogElementsLock);
+        stats.addBlocked(log_time(CLOCK_MONOTONIC) - start);
+        drain_Locked();
+        merge_Locked(elem, loggable);
+        unlock();
+    }
+
+    return loggable ? len : -EACCES;
+}
+
+// Merge queued entries unless someone else holds the lock, in which case
+// they will pick them up in unlock(). Returns false if entries were left to
+// the lock holder.
+bool LogBuffer::drain() {
+    while (mPending.ready()) {
+        if (pthread_rwlock_trywrlock(&mLogElementsLock)) {
+            // Order our check of the lock against the holder's check of
+            // the queue after it releases the lock.
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if (pthread_rwlock_trywrlock(&mLogElementsLock)) return false;
         }
+        drain_Locked();
+        pthread_rwlock_unlock(&mLogElementsLock);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
     }
+    return true;
+}
 
-    wrlock();
+// LogBuffer::wrlock() must be held when this function is called.
+void LogBuffer::drain_Locked() {
+    LogBufferElement* elem;
+    bool loggable;
+    while (mPending.pop(elem, loggable)) {
+        merge_Locked(elem, loggable);
+    }
+}
+
+// Squash identical messages, then log the element.
+//
+// LogBuffer::wrlock() must be held when this function is called, owns elem.
+void LogBuffer::merge_Locked(LogBufferElement* elem, bool loggable) {
+    if (!loggable) {
+        // Log traffic received to total
+        stats.addTotal(elem);
+        delete elem;
+        return;
+    }
+
+    log_id_t log_id = elem->getLogId();
     LogBufferElement* currentLast = lastLoggedElements[log_id];
     if (currentLast) {
         LogBufferElement* dropped = droppedElements[log_id];
@@ -335,15 +425,13 @@ int LogBuffer::log(log_id_t log_id, log_time realtime, uid_t uid, pid_t pid,
                     // check for overflow
                     if (total >= UINT32_MAX) {
                         log(currentLast);
-                        unlock();
-                        return len;
+                        return;
                     }
                     stats.addTotal(currentLast);
                     delete currentLast;
                     swab = total;
                     event->payload.data = htole32(swab);
-                    unlock();
-                    return len;
+                    return;
                 }
                 if (count == USHRT_MAX) {
                     log(dropped);
@@ -355,12 +443,11 @@ int LogBuffer::log(log_id_t log_id, log_time realtime, uid_t uid, pid_t pid,
             }
             if (count) {
                 stats.addTotal(currentLast);
-                currentLast->setDropped(count);
+                currentLast = drop(currentLast, count);
             }
             droppedElements[log_id] = currentLast;
             lastLoggedElements[log_id] = elem;
-            unlock();
-            return len;
+            return;
         }
         if (dropped) {         // State 1 or 2
             if (count) {       // State 2
@@ -374,12 +461,11 @@ int LogBuffer::log(log_id_t log_id, log_time realtime, uid_t uid, pid_t pid,
             delete currentLast;
         }
     }
-    lastLoggedElements[log_id] = new LogBufferElement(*elem);
+    // nullptr if out of memory, merely disables identical message squashing
+    lastLoggedElements[log_id] =
+        new (mLastArena[log_id], elem->getMsgLen()) LogBufferElement(*elem);
 
     log(elem);
-    unlock();
-
-    return len;
 }
 
 // assumes LogBuffer::wrlock() held, owns elem, look after garbage collection
@@ -398,6 +484,7 @@ void LogBuffer::log(LogBufferElement* elem) {
                         (elem->getLogId() != LOG_ID_KERNEL) &&
                         ((*it)->getLogId() != LOG_ID_KERNEL))) {
         mLogElements.push_back(elem);
+        mIndex.append(--mLogElements.end());
     } else {
         log_time end = log_time::EPOCH;
         bool end_set = false;
@@ -424,6 +511,7 @@ void LogBuffer::log(LogBufferElement* elem) {
 
         if (end_always || (end_set && (end > (*it)->getRealTime()))) {
             mLogElements.push_back(elem);
+            mIndex.append(--mLogElements.end());
         } else {
             // should be short as timestamps are localized near end()
             do {
@@ -443,11 +531,158 @@ void LogBuffer::log(LogBufferElement* elem) {
     maybePrune(elem->getLogId());
 }
 
+// Replace elem with a compact chatty copy so that a long lived chatty entry
+// does not pin the arena chunk holding the original payload.
+//
+// LogBuffer::wrlock() must be held when this function is called, elem is
+// consumed and the result must be stored in its place.
+LogBufferElement* LogBuffer::drop(LogBufferElement* elem,
+                                  unsigned short count) {
+    log_id_t id = elem->getLogId();
+    LogBufferElement* dropped =
+        new (mDroppedArena[id], LogBufferElement::droppedLen(*elem))
+            LogBufferElement(*elem, count);
+    if (!dropped) {  // out of memory, drop in place
+        elem->setDropped(count);
+        return elem;
+    }
+    delete elem;
+    return dropped;
+}
+
+// Move a whitelisted entry that prune() keeps out of mArena, so that it does
+// not pin the chunk it was logged in while the entries around it expire.
+//
+// LogBuffer::wrlock() must be held when this function is called, elem must
+// not be dropped, is consumed and the result must be stored in its place.
+LogBufferElement* LogBuffer::relocate(LogBufferElement* elem) {
+    log_id_t id = elem->getLogId();
+    if (!mArena[id].owns(elem)) {  // already moved, or compressed
+        return elem;
+    }
+    LogBufferElement* moved = new (mDroppedArena[id], elem->getMsgLen())
+        LogBufferElement(*elem);
+    if (!moved) {  // out of memory, stays where it is
+        return elem;
+    }
+    delete elem;
+    return moved;
+}
+
+// Compress the oldest uncompressed entries of the text logs, a block at a
+// time, while more than a quarter of the buffer is held uncompressed. The
+// newest entries, where the readers are, stay as they are. After a pass that
+// compressed nothing, wait for another block worth of logging before trying
+// again rather than re-walk the list on every log().
+//
+// LogBuffer::wrlock() must be held when this function is called.
+void LogBuffer::compress(log_id_t id) {
+    if (!mCompress || (id == LOG_ID_EVENTS) || (id == LOG_ID_SECURITY) ||
+        (id == LOG_ID_STATS)) {
+        return;
+    }
+    if (stats.sizesTotal(id) < mColdRetry[id]) {
+        return;
+    }
+    if ((stats.sizes(id) - stats.compressedSizes(id)) <=
+        (log_buffer_size(id) / 4)) {
+        return;
+    }
+
+    LogTimeEntry::rdlock();
+
+    // Same region lock as prune(), readers may be sending entries past it
+    // with the element lock released.
+    LogTimeEntry* oldest = nullptr;
+    LastLogTimes::iterator times = mTimes.begin();
+    while (times != mTimes.end()) {
+        LogTimeEntry* entry = (*times);
+        if (entry->owned_Locked() && entry->isWatching(id) &&
+            (!oldest || (oldest->mStart > entry->mStart))) {
+            oldest = entry;
+        }
+        times++;
+    }
+    log_time watermark(log_time::tv_sec_max, log_time::tv_nsec_max);
+    if (oldest) watermark = oldest->mStart - pruneMargin;
+
+    std::vector<LogBufferElementCollection::iterator> run;
+    std::string payload;
+    LogBufferElementCollection::iterator it =
+        mColdSet[id] ? mCold[id] : mLogElements.begin();
+    for (; (it != mLogElements.end()) &&
+           (payload.length() < LogBufferBlock::kBlockSize);
+         ++it) {
+        LogBufferElement* element = *it;
+
+        if (oldest && (watermark <= element->getRealTime())) {
+            break;
+        }
+        if (element->getLogId() != id) {
+            continue;
+        }
+        size_t prefix = LogBufferElement::prefixLen(*element);
+        if (!prefix) {  // dropped, or already compressed
+            continue;
+        }
+        run.push_back(it);
+        payload.append(element->getMsg() + prefix,
+                       element->getMsgLen() - prefix);
+    }
+
+    LogBufferBlock* block = nullptr;
+    if (payload.length() >= LogBufferBlock::kBlockSize) {
+        block = LogBufferBlock::create(payload.data(), payload.length(),
+                                       mBlockSizes[id]);
+    }
+    if (block) {
+        uint32_t offset = 0;
+        size_t charged = 0;
+        for (size_t i = 0; i < run.size(); ++i) {
+            LogBufferElement* element = *run[i];
+            size_t len =
+                element->getMsgLen() - LogBufferElement::prefixLen(*element);
+            size_t share = ((i + 1) == run.size())
+                               ? (block->size() - charged)
+                               : (block->size() * len / payload.length());
+            charged += share;
+            LogBufferElement* cold =
+                new (mColdArena[id], LogBufferElement::coldLen(*element))
+                    LogBufferElement(*element, block, offset, share);
+            offset += len;
+            if (!cold) continue;  // out of memory, stays as is
+            stats.compress(element, cold);
+            *run[i] = cold;
+            delete element;
+        }
+        block->decRef();
+        mCold[id] = run.back();
+        mColdSet[id] = true;
+        mColdRetry[id] = 0;
+    } else {
+        if (payload.length() >= LogBufferBlock::kBlockSize) {
+            // Incompressible or out of memory, leave the run behind.
+            mCold[id] = run.back();
+            mColdSet[id] = true;
+        } else if (!run.empty()) {
+            // Not enough aged content yet, skip what can not be compressed.
+            mCold[id] = run.front();
+            mColdSet[id] = true;
+        }
+        mColdRetry[id] = stats.sizesTotal(id) + LogBufferBlock::kBlockSize;
+    }
+
+    LogTimeEntry::unlock();
+}
+
 // Prune at most 10% of the log entries or maxPrune, whichever is less.
 //
 // LogBuffer::wrlock() must be held when this function is called.
 void LogBuffer::maybePrune(log_id_t id) {
-    size_t sizes = stats.sizes(id);
+    compress(id);
+
+    // limits apply to the memory used, compressed entries cost less
+    size_t sizes = stats.physicalSizes(id);
     unsigned long maxSize = log_buffer_size(id);
     if (sizes > maxSize) {
         size_t sizeOver = sizes - ((maxSize * 9) / 10);
@@ -498,9 +733,11 @@ LogBufferElementCollection::iterator LogBuffer::erase(
     }
 
     bool setLast[LOG_ID_MAX];
+    bool setCold[LOG_ID_MAX];
     bool doSetLast = false;
     log_id_for_each(i) {
         doSetLast |= setLast[i] = mLastSet[i] && (it == mLast[i]);
+        doSetLast |= setCold[i] = mColdSet[i] && (it == mCold[i]);
     }
 #ifdef DEBUG_CHECK_FOR_STALE_ENTRIES
     LogBufferElementCollection::iterator bad = it;
@@ -508,6 +745,7 @@ LogBufferElementCollection::iterator LogBuffer::erase(
                   ? element->getTag()
                   : element->getUid();
 #endif
+    mIndex.erase(it);
     it = mLogElements.erase(it);
     if (doSetLast) {
         log_id_for_each(i) {
@@ -519,6 +757,13 @@ LogBufferElementCollection::iterator LogBuffer::erase(
                     mLast[i] = it;  // push down the road as next-best-watermark
                 }
             }
+            if (setCold[i]) {
+                if (it == mLogElements.end()) {
+                    mColdSet[i] = false;
+                } else {
+                    mCold[i] = it;
+                }
+            }
         }
     }
 #ifdef DEBUG_CHECK_FOR_STALE_ENTRIES
@@ -637,7 +882,7 @@ bool LogBuffer::isBusy(log_time watermark) {
 // If the selected reader is blocking our pruning progress, decide on
 // what kind of mitigation is necessary to unblock the situation.
 void LogBuffer::kickMe(LogTimeEntry* me, log_id_t id, unsigned long pruneRows) {
-    if (stats.sizes(id) > (2 * log_buffer_size(id))) {  // +100%
+    if (stats.physicalSizes(id) > (2 * log_buffer_size(id))) {  // +100%
         // A misbehaving or slow reader has its connection
         // dropped if we hit too much memory pressure.
         me->release_Locked();
@@ -932,7 +1177,7 @@ bool LogBuffer::prune(log_id_t id, unsigned long pruneRows, uid_t caller_uid) {
                 it = erase(it);
             } else {
                 stats.drop(element);
-                element->setDropped(1);
+                *it = element = drop(element, 1);
                 if (last.coalesce(element, 1)) {
                     it = erase(it, true);
                 } else {
@@ -989,6 +1234,7 @@ bool LogBuffer::prune(log_id_t id, unsigned long pruneRows, uid_t caller_uid) {
         if (hasWhitelist && !element->getDropped() && mPrune.nice(element)) {
             // WhiteListed
             whitelist = true;
+            *it = relocate(element);
             it++;
             continue;
         }
@@ -1074,7 +1320,7 @@ bool LogBuffer::clear(log_id_t id, uid_t uid) {
 // get the used space associated with "id".
 unsigned long LogBuffer::getSizeUsed(log_id_t id) {
     rdlock();
-    size_t retval = stats.sizes(id);
+    size_t retval = stats.physicalSizes(id);
     unlock();
     return retval;
 }
@@ -1107,6 +1353,13 @@ log_time LogBuffer::flushTo(SocketClient* reader, const log_time& start,
     LogBufferElementCollection::iterator it;
     uid_t uid = reader->getUid();
 
+    // Catch up with entries queued behind other readers.
+    if (mPending.ready()) {
+        wrlock();
+        drain_Locked();
+        unlock();
+    }
+
     rdlock();
 
     if (start == log_time::EPOCH) {
@@ -1116,30 +1369,41 @@ log_time LogBuffer::flushTo(SocketClient* reader, const log_time& start,
         // 3 second limit to continue search for out-of-order entries.
         log_time min = start - pruneMargin;
 
-        // Cap to 300 iterations we look back for out-of-order entries.
-        size_t count = 300;
-
-        // Client wants to start from some specified time. Chances are
-        // we are better off starting from the end of the time sorted list.
-        LogBufferElementCollection::iterator last;
-        for (last = it = mLogElements.end(); it != mLogElements.begin();
-             /* do nothing */) {
-            --it;
-            LogBufferElement* element = *it;
-            if (element->getRealTime() > start) {
-                last = it;
-            } else if (element->getRealTime() == start) {
-                last = ++it;
-                break;
-            } else if (!--count || (element->getRealTime() < min)) {
-                break;
+        it = mLogElements.begin();
+        if (mIndex.seek(min, it)) {
+            // Client wants to start further back than the last index anchor,
+            // walk forward from the anchor preceding the out-of-order window.
+            while ((it != mLogElements.end()) &&
+                   ((*it)->getRealTime() <= start)) {
+                ++it;
             }
+        } else {
+            // Cap to 300 iterations we look back for out-of-order entries.
+            size_t count = 300;
+
+            // Chances are we are better off starting from the end of the
+            // time sorted list, there is at most an index stride to cover.
+            LogBufferElementCollection::iterator last;
+            for (last = it = mLogElements.end(); it != mLogElements.begin();
+                 /* do nothing */) {
+                --it;
+                LogBufferElement* element = *it;
+                if (element->getRealTime() > start) {
+                    last = it;
+                } else if (element->getRealTime() == start) {
+                    last = ++it;
+                    break;
+                } else if (!--count || (element->getRealTime() < min)) {
+                    break;
+                }
+            }
+            it = last;
         }
-        it = last;
     }
 
     log_time curr = start;
 
+    LogBufferBlock* pinned = nullptr;         // inflated for the run
     LogBufferElement* lastElement = nullptr;  // iterator corruption paranoia
     static const size_t maxSkip = 4194304;    // maximum entries to skip
     size_t skip = maxSkip;
@@ -1187,12 +1451,20 @@ log_time LogBuffer::flushTo(SocketClient* reader, const log_time& start,
                 (element->getDropped() && !sameTid) ? 0 : element->getTid();
         }
 
+        // Inflate each compressed block once rather than for every entry
+        LogBufferBlock* block = element->getBlock();
+        if (block && (block != pinned)) {
+            if (pinned) pinned->unpin();
+            pinned = block->pin() ? block : nullptr;
+        }
+
         unlock();
 
         // range locking in LastLogTimes looks after us
         curr = element->flushTo(reader, this, privileged, sameTid);
 
         if (curr == element->FLUSH_ERROR) {
+            if (pinned) pinned->unpin();
             return curr;
         }
 
@@ -1200,14 +1472,53 @@ log_time LogBuffer::flushTo(SocketClient* reader, const log_time& start,
         rdlock();
     }
     unlock();
+    if (pinned) pinned->unpin();
 
     return curr;
 }
 
+// Count back from the end rather than have the reader count forward from the
+// start of the buffer. Only entries flushTo() would hand to the reader count,
+// the same privilege, security and selection checks as FilterFirstPass.
+log_time LogBuffer::tailStart(const LogTimeEntry* entry, unsigned long tail,
+                              bool privileged, bool security) {
+    log_time retval = log_time::EPOCH;
+    uid_t uid = entry->mClient->getUid();
+
+    rdlock();
+    LogBufferElementCollection::iterator it = mLogElements.end();
+    while (tail && (it != mLogElements.begin())) {
+        LogBufferElement* element = *--it;
+        if (!privileged && (element->getUid() != uid)) {
+            continue;
+        }
+        if (!security && (element->getLogId() == LOG_ID_SECURITY)) {
+            continue;
+        }
+        if (entry->isSelected(element)) {
+            --tail;
+        }
+    }
+    // flushTo() starts after the entry at start time, back off by a margin
+    // to pick up entries sorted in out of order.
+    if (!tail && (it != mLogElements.begin()) &&
+        ((*it)->getRealTime() > pruneMargin)) {
+        retval = (*it)->getRealTime() - pruneMargin;
+    }
+    unlock();
+
+    return retval;
+}
+
 std::string LogBuffer::formatStatistics(uid_t uid, pid_t pid,
                                         unsigned int logMask) {
     wrlock();
 
+    log_id_for_each(id) {
+        stats.setArenaSize(id, mArena[id].size() + mDroppedArena[id].size() +
+                                   mLastArena[id].size() +
+                                   mColdArena[id].size() + mBlockSizes[id]);
+    }
     std::string ret = stats.format(uid, pid, logMask);
 
     unlock();
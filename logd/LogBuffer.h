@@ -19,6 +19,7 @@
 
 #include <sys/types.h>
 
+#include <atomic>
 #include <list>
 #include <string>
 
@@ -26,8 +27,11 @@
 #include <private/android_filesystem_config.h>
 #include <sysutils/SocketClient.h>
 
+#include "LogBufferArena.h"
 #include "LogBufferElement.h"
+#include "LogBufferIndex.h"
 #include "LogBufferInterface.h"
+#include "LogBufferQueue.h"
 #include "LogStatistics.h"
 #include "LogTags.h"
 #include "LogTimes.h"
@@ -73,11 +77,22 @@ static bool isMonotonic(const log_time& mono) {
 }
 }
 
-typedef std::list<LogBufferElement*> LogBufferElementCollection;
-
 class LogBuffer : public LogBufferInterface {
+    // element storage, must outlive every element referencing it
+    LogBufferArena mArena[LOG_ID_MAX];
+    // compact chatty elements and whitelisted survivors, kept apart so they
+    // do not pin mArena chunks
+    LogBufferArena mDroppedArena[LOG_ID_MAX];
+    // copies held for identical message squashing, at most one live per id
+    LogBufferArena mLastArena[LOG_ID_MAX];
+    // compressed elements, their payload is in a LogBufferBlock
+    LogBufferArena mColdArena[LOG_ID_MAX];
+    std::atomic<size_t> mBlockSizes[LOG_ID_MAX];
+
     LogBufferElementCollection mLogElements;
     pthread_rwlock_t mLogElementsLock;
+    // reader start time lookups
+    LogBufferIndex mIndex;
 
     LogStatistics stats;
 
@@ -85,6 +100,12 @@ class LogBuffer : public LogBufferInterface {
     // watermark for last per log id
     LogBufferElementCollection::iterator mLast[LOG_ID_MAX];
     bool mLastSet[LOG_ID_MAX];
+    // where to resume looking for entries to compress per log id
+    LogBufferElementCollection::iterator mCold[LOG_ID_MAX];
+    bool mColdSet[LOG_ID_MAX];
+    // lifetime bytes logged before compress() tries again after a failure
+    size_t mColdRetry[LOG_ID_MAX];
+    bool mCompress;
     // watermark of any worst/chatty uid processing
     typedef std::unordered_map<uid_t, LogBufferElementCollection::iterator>
         LogBufferIteratorMap;
@@ -102,7 +123,18 @@ class LogBuffer : public LogBufferInterface {
 
     LogBufferElement* lastLoggedElements[LOG_ID_MAX];
     LogBufferElement* droppedElements[LOG_ID_MAX];
+
+    // entries handed over by writers that found mLogElementsLock busy
+    LogBufferQueue mPending;
+    int enqueue(log_id_t log_id, log_time realtime, uid_t uid, pid_t pid,
+                pid_t tid, const char* msg, unsigned short len, bool& queued);
+    bool drain();
+    void drain_Locked();
+    void merge_Locked(LogBufferElement* elem, bool loggable);
+
     void log(LogBufferElement* elem);
+    LogBufferElement* drop(LogBufferElement* elem, unsigned short count);
+    LogBufferElement* relocate(LogBufferElement* elem);
 
    public:
     LastLogTimes& mTimes;
@@ -116,6 +148,8 @@ class LogBuffer : public LogBufferInterface {
 
     int log(log_id_t log_id, log_time realtime, uid_t uid, pid_t pid, pid_t tid,
             const char* msg, unsigned short len) override;
+    void logBatch(const LogBufferEntry* entries, size_t count,
+                  int* result) override;
     // lastTid is an optional context to help detect if the last previous
     // valid message was from the same source so we can differentiate chatty
     // filter types (identical or expired)
@@ -125,6 +159,10 @@ class LogBuffer : public LogBufferInterface {
                      int (*filter)(const LogBufferElement* element,
                                    void* arg) = nullptr,
                      void* arg = nullptr);
+    // A start time from which there are at least tail entries the reader
+    // of entry receives, EPOCH if the whole buffer is needed.
+    log_time tailStart(const LogTimeEntry* entry, unsigned long tail,
+                       bool privileged, bool security);
 
     bool clear(log_id_t id, uid_t uid = AID_ROOT);
     unsigned long getSize(log_id_t id);
@@ -136,6 +174,9 @@ class LogBuffer : public LogBufferInterface {
     void enableStatistics() {
         stats.enableStatistics();
     }
+    void enableCompression() {
+        mCompress = true;
+    }
 
     int initPrune(const char* cp) {
         return mPrune.init(cp);
@@ -176,6 +217,9 @@ class LogBuffer : public LogBufferInterface {
     }
     void unlock() {
         pthread_rwlock_unlock(&mLogElementsLock);
+        // Merge anything writers queued while we were holding the lock.
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (mPending.ready()) drain();
     }
 
    private:
@@ -184,6 +228,7 @@ class LogBuffer : public LogBufferInterface {
     static const log_time pruneMargin;
 
     void maybePrune(log_id_t id);
+    void compress(log_id_t id);
     bool isBusy(log_time watermark);
     void kickMe(LogTimeEntry* me, log_id_t id, unsigned long pruneRows);
 
@@ -0,0 +1,142 @@
+/*
+ * Copyright (C) 2018 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <sys/mman.h>
+
+#include "LogBufferArena.h"
+
+LogBufferArena::LogBufferArena()
+    : mHead(nullptr), mSpare(nullptr), mChunks(0) {
+    pthread_mutex_init(&mLock, nullptr);
+}
+
+LogBufferArena::~LogBufferArena() {
+    // Any element still referencing us is being torn down with the LogBuffer
+    while (mHead) {
+        Chunk* chunk = mHead;
+        unlink(chunk);
+        freeChunk(chunk);
+    }
+    if (mSpare) freeChunk(mSpare);
+    pthread_mutex_destroy(&mLock);
+}
+
+// Map a chunk aligned on kChunkSize so that release() can find the chunk
+// header of any allocation by masking its address.
+LogBufferArena::Chunk* LogBufferArena::newChunk() {
+    size_t len = 2 * kChunkSize;
+    void* map = mmap(nullptr, len, PROT_READ | PROT_WRITE,
+                     MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (map == MAP_FAILED) return nullptr;
+
+    uintptr_t start = reinterpret_cast<uintptr_t>(map);
+    uintptr_t aligned = (start + kChunkSize - 1) & -kChunkSize;
+    if (aligned != start) munmap(map, aligned - start);
+    uintptr_t end = start + len;
+    if ((aligned + kChunkSize) != end) {
+        munmap(reinterpret_cast<void*>(aligned + kChunkSize),
+               end - (aligned + kChunkSize));
+    }
+
+    Chunk* chunk = reinterpret_cast<Chunk*>(aligned);
+    chunk->arena = this;
+    chunk->prev = chunk->next = nullptr;
+    chunk->offset = kChunkHeaderSize;
+    chunk->live = 0;
+    ++mChunks;
+    return chunk;
+}
+
+void LogBufferArena::freeChunk(Chunk* chunk) {
+    munmap(chunk, kChunkSize);
+    --mChunks;
+}
+
+void LogBufferArena::unlink(Chunk* chunk) {
+    if (chunk->prev) chunk->prev->next = chunk->next;
+    if (chunk->next) chunk->next->prev = chunk->prev;
+    if (mHead == chunk) mHead = chunk->next;
+    chunk->prev = chunk->next = nullptr;
+}
+
+void* LogBufferArena::allocate(size_t len) {
+    len = (len + alignof(uint64_t) - 1) & -alignof(uint64_t);
+    if (len > (kChunkSize - kChunkHeaderSize)) return nullptr;
+
+    pthread_mutex_lock(&mLock);
+    Chunk* chunk = mHead;
+    if (!chunk || ((chunk->offset + len) > kChunkSize)) {
+        // Retire the current chunk; it stays linked until its last entry
+        // is released.
+        if (mSpare) {
+            chunk = mSpare;
+            mSpare = nullptr;
+        } else {
+            chunk = newChunk();
+            if (!chunk) {
+                pthread_mutex_unlock(&mLock);
+                return nullptr;
+            }
+        }
+        chunk->next = mHead;
+        if (mHead) mHead->prev = chunk;
+        mHead = chunk;
+    }
+    void* ptr = reinterpret_cast<char*>(chunk) + chunk->offset;
+    chunk->offset += len;
+    ++chunk->live;
+    pthread_mutex_unlock(&mLock);
+    return ptr;
+}
+
+void LogBufferArena::release(void* ptr) {
+    if (!ptr) return;
+    Chunk* chunk = reinterpret_cast<Chunk*>(reinterpret_cast<uintptr_t>(ptr) &
+                                            -kChunkSize);
+    chunk->arena->release(chunk);
+}
+
+void LogBufferArena::release(Chunk* chunk) {
+    pthread_mutex_lock(&mLock);
+    if (--chunk->live == 0) {
+        if (chunk == mHead) {
+            // Nothing left in the chunk being filled, rewind it in place.
+            chunk->offset = kChunkHeaderSize;
+        } else {
+            unlink(chunk);
+            if (!mSpare) {
+                chunk->offset = kChunkHeaderSize;
+                mSpare = chunk;
+            } else {
+                freeChunk(chunk);
+            }
+        }
+    }
+    pthread_mutex_unlock(&mLock);
+}
+
+bool LogBufferArena::owns(const void* ptr) const {
+    const Chunk* chunk = reinterpret_cast<const Chunk*>(
+        reinterpret_cast<uintptr_t>(ptr) & -kChunkSize);
+    return chunk->arena == this;
+}
+
+size_t LogBufferArena::size() const {
+    pthread_mutex_lock(&mLock);
+    size_t retval = mChunks * kChunkSize;
+    pthread_mutex_unlock(&mLock);
+    return retval;
+}
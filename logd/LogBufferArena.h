@@ -0,0 +1,79 @@
+/*
+ * Copyright (C) 2018 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _LOGD_LOG_BUFFER_ARENA_H__
+#define _LOGD_LOG_BUFFER_ARENA_H__
+
+#include <pthread.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include <android-base/macros.h>
+
+// Backing store for LogBufferElement header and payload.
+//
+// Storage is carved out of fixed size, size aligned chunks with a bump
+// pointer, so logging an entry costs no trip to the allocator. Entries are
+// expired oldest first, so the chunks behave as a ring: a chunk is handed
+// back as soon as the last entry in it is released, and pruning the oldest
+// entries advances the tail. An entry that outlives its neighbours keeps its
+// whole chunk mapped, so LogBuffer moves long lived ones (chatty, whitelist,
+// squashing copies) into arenas of their own.
+//
+// allocate() and release() are thread safe; elements are created before
+// LogBuffer::wrlock() is taken.
+class LogBufferArena {
+   public:
+    static constexpr size_t kChunkSize = 64 * 1024;
+
+    LogBufferArena();
+    ~LogBufferArena();
+
+    // returns nullptr if len can not fit in a chunk or we are out of memory
+    void* allocate(size_t len);
+    // ptr must have been returned by allocate() on any LogBufferArena
+    static void release(void* ptr);
+    // whether ptr was returned by allocate() on this arena
+    bool owns(const void* ptr) const;
+
+    // bytes mapped for chunks, including the cached spare
+    size_t size() const;
+
+   private:
+    struct Chunk {
+        LogBufferArena* arena;
+        Chunk* prev;
+        Chunk* next;
+        size_t offset;  // bump pointer, relative to the chunk start
+        size_t live;    // outstanding allocations
+    };
+    static constexpr size_t kChunkHeaderSize =
+        (sizeof(Chunk) + alignof(uint64_t) - 1) & -alignof(uint64_t);
+
+    mutable pthread_mutex_t mLock;
+    Chunk* mHead;   // chunk currently being filled
+    Chunk* mSpare;  // one empty chunk kept around to avoid mmap churn
+    size_t mChunks;
+
+    Chunk* newChunk();
+    void freeChunk(Chunk* chunk);
+    void unlink(Chunk* chunk);
+    void release(Chunk* chunk);
+
+    DISALLOW_COPY_AND_ASSIGN(LogBufferArena);
+};
+
+#endif  // _LOGD_LOG_BUFFER_ARENA_H__
@@ -0,0 +1,110 @@
+/*
+ * Copyright (C) 2018 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <new>
+
+#include <zlib.h>
+
+#include "LogBufferBlock.h"
+
+LogBufferBlock* LogBufferBlock::create(const char* data, size_t len,
+                                       std::atomic<size_t>& accounting) {
+    uLongf size = compressBound(len);
+    char* buffer = static_cast<char*>(malloc(size));
+    if (!buffer) return nullptr;
+
+    // Favour speed, this runs with the element lock held.
+    if ((compress2(reinterpret_cast<Bytef*>(buffer), &size,
+                   reinterpret_cast<const Bytef*>(data), len,
+                   Z_BEST_SPEED) != Z_OK) ||
+        ((sizeof(LogBufferBlock) + size) >= len)) {
+        free(buffer);
+        return nullptr;
+    }
+
+    void* mem = malloc(sizeof(LogBufferBlock) + size);
+    if (!mem) {
+        free(buffer);
+        return nullptr;
+    }
+    LogBufferBlock* block = new (mem) LogBufferBlock(size, len, accounting);
+    memcpy(block->data(), buffer, size);
+    free(buffer);
+    return block;
+}
+
+LogBufferBlock::LogBufferBlock(size_t size, size_t length,
+                               std::atomic<size_t>& accounting)
+    : mRefs(1),
+      mAccounting(accounting),
+      mSize(size),
+      mLength(length),
+      mPins(0),
+      mInflated(nullptr) {
+    pthread_mutex_init(&mLock, nullptr);
+    mAccounting.fetch_add(sizeof(*this) + mSize, std::memory_order_relaxed);
+}
+
+LogBufferBlock::~LogBufferBlock() {
+    mAccounting.fetch_sub(sizeof(*this) + mSize, std::memory_order_relaxed);
+    free(mInflated);
+    pthread_mutex_destroy(&mLock);
+}
+
+void LogBufferBlock::decRef() {
+    if (mRefs.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        this->~LogBufferBlock();
+        free(this);
+    }
+}
+
+const char* LogBufferBlock::pin() {
+    incRef();
+    pthread_mutex_lock(&mLock);
+    if (!mInflated) {
+        char* buffer = static_cast<char*>(malloc(mLength));
+        uLongf length = mLength;
+        if (buffer &&
+            ((uncompress(reinterpret_cast<Bytef*>(buffer), &length,
+                         reinterpret_cast<const Bytef*>(data()),
+                         mSize) != Z_OK) ||
+             (length != mLength))) {
+            free(buffer);
+            buffer = nullptr;
+        }
+        mInflated = buffer;
+    }
+    const char* retval = mInflated;
+    if (retval) {
+        ++mPins;
+    }
+    pthread_mutex_unlock(&mLock);
+    if (!retval) decRef();
+    return retval;
+}
+
+void LogBufferBlock::unpin() {
+    pthread_mutex_lock(&mLock);
+    if (--mPins == 0) {
+        free(mInflated);
+        mInflated = nullptr;
+    }
+    pthread_mutex_unlock(&mLock);
+    decRef();
+}
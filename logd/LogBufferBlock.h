@@ -0,0 +1,81 @@
+/*
+ * Copyright (C) 2018 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _LOGD_LOG_BUFFER_BLOCK_H__
+#define _LOGD_LOG_BUFFER_BLOCK_H__
+
+#include <pthread.h>
+#include <stddef.h>
+
+#include <atomic>
+
+#include <android-base/macros.h>
+
+// Compressed payloads of a run of consecutive aged entries of one log id.
+//
+// Every cold LogBufferElement holds a reference and the offset of its payload
+// in the inflated block. The block is inflated on the first pin() and the
+// copy is freed with the last unpin(), so a reader walking through a run of
+// cold entries pays for a single inflate.
+class LogBufferBlock {
+   public:
+    static constexpr size_t kBlockSize = 32 * 1024;  // target inflated size
+
+    // Returns nullptr if out of memory or if compression does not pay off.
+    // The caller holds the initial reference. accounting tracks the memory
+    // held by all the blocks of a log id.
+    static LogBufferBlock* create(const char* data, size_t len,
+                                  std::atomic<size_t>& accounting);
+
+    void incRef() {
+        mRefs.fetch_add(1, std::memory_order_relaxed);
+    }
+    void decRef();
+
+    // Inflated content, nullptr if out of memory. Holds a reference until the
+    // matching unpin(), so the block can outlive the elements referencing it.
+    const char* pin();
+    void unpin();
+
+    // compressed size
+    size_t size() const {
+        return mSize;
+    }
+    // inflated size
+    size_t length() const {
+        return mLength;
+    }
+
+   private:
+    LogBufferBlock(size_t size, size_t length, std::atomic<size_t>& accounting);
+    ~LogBufferBlock();
+
+    char* data() {
+        return reinterpret_cast<char*>(this) + sizeof(*this);
+    }
+
+    std::atomic<size_t> mRefs;
+    std::atomic<size_t>& mAccounting;
+    const size_t mSize;
+    const size_t mLength;
+    pthread_mutex_t mLock;  // protects mPins and mInflated
+    size_t mPins;
+    char* mInflated;
+
+    DISALLOW_COPY_AND_ASSIGN(LogBufferBlock);
+};
+
+#endif  // _LOGD_LOG_BUFFER_BLOCK_H__
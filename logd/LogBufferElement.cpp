@@ -40,10 +40,11 @@ LogBufferElement::LogBufferElement(log_id_t log_id, log_time realtime,
       mPid(pid),
       mTid(tid),
       mRealTime(realtime),
+      mMsg(reinterpret_cast<char*>(this) + sizeof(*this)),
       mMsgLen(len),
       mLogId(log_id),
-      mDropped(false) {
-    mMsg = new char[len];
+      mDropped(false),
+      mCompressed(false) {
     memcpy(mMsg, msg, len);
 }
 
@@ -52,15 +53,87 @@ LogBufferElement::LogBufferElement(const LogBufferElement& elem)
       mPid(elem.mPid),
       mTid(elem.mTid),
       mRealTime(elem.mRealTime),
+      mMsg(reinterpret_cast<char*>(this) + sizeof(*this)),
       mMsgLen(elem.mMsgLen),
       mLogId(elem.mLogId),
-      mDropped(elem.mDropped) {
-    mMsg = new char[mMsgLen];
+      mDropped(elem.mDropped),
+      mCompressed(false) {
     memcpy(mMsg, elem.mMsg, mMsgLen);
 }
 
+LogBufferElement::LogBufferElement(const LogBufferElement& elem,
+                                   unsigned short dropped)
+    : mUid(elem.mUid),
+      mPid(elem.mPid),
+      mTid(elem.mTid),
+      mRealTime(elem.mRealTime),
+      mMsg(nullptr),
+      mDroppedCount(dropped),
+      mLogId(elem.mLogId),
+      mDropped(true),
+      mCompressed(false) {
+    // The tag information is saved in mMsg data, if the tag is non-zero
+    // save only the information needed to get the tag.
+    if (elem.getTag() != 0) {
+        mMsg = reinterpret_cast<char*>(this) + sizeof(*this);
+        memcpy(mMsg, elem.mMsg, sizeof(android_event_header_t));
+    }
+}
+
+LogBufferElement::LogBufferElement(const LogBufferElement& elem,
+                                   LogBufferBlock* block, uint32_t offset,
+                                   uint16_t share)
+    : mUid(elem.mUid),
+      mPid(elem.mPid),
+      mTid(elem.mTid),
+      mRealTime(elem.mRealTime),
+      mMsg(reinterpret_cast<char*>(this) + sizeof(*this) + sizeof(ColdRef)),
+      mMsgLen(elem.mMsgLen),
+      mLogId(elem.mLogId),
+      mDropped(false),
+      mCompressed(true) {
+    ColdRef ref;
+    ref.block = block;
+    ref.offset = offset;
+    ref.prefixLen = prefixLen(elem);
+    ref.share = share;
+    memcpy(reinterpret_cast<char*>(this) + sizeof(*this), &ref, sizeof(ref));
+    memcpy(mMsg, elem.mMsg, ref.prefixLen);
+    block->incRef();
+}
+
 LogBufferElement::~LogBufferElement() {
-    delete[] mMsg;
+    // an element dropped in place still holds on to its block
+    if (mCompressed) getColdRef().block->decRef();
+}
+
+size_t LogBufferElement::droppedLen(const LogBufferElement& elem) {
+    return elem.getTag() ? sizeof(android_event_header_t) : 0;
+}
+
+// Text logs keep the priority and tag resident for statistics and the prune
+// filters, binary logs are left alone.
+size_t LogBufferElement::prefixLen(const LogBufferElement& elem) {
+    if (elem.mDropped || elem.mCompressed || elem.isBinary() ||
+        (elem.mLogId == LOG_ID_STATS) || (elem.mMsgLen <= 1)) {
+        return 0;
+    }
+    size_t len = 1 + strnlen(elem.mMsg + 1, elem.mMsgLen - 1) + 1;
+    return (len < elem.mMsgLen) ? len : 0;
+}
+
+LogBufferElement::ColdRef LogBufferElement::getColdRef() const {
+    ColdRef ref;
+    memcpy(&ref, reinterpret_cast<const char*>(this) + sizeof(*this),
+           sizeof(ref));
+    return ref;
+}
+
+unsigned short LogBufferElement::getPhysicalLen() const {
+    if (mDropped) return 0;
+    if (!mCompressed) return mMsgLen;
+    ColdRef ref = getColdRef();
+    return ref.prefixLen + ref.share;
 }
 
 uint32_t LogBufferElement::getTag() const {
@@ -71,18 +144,10 @@ uint32_t LogBufferElement::getTag() const {
                : 0;
 }
 
+// The payload is inline, so this does not give back any memory, callers that
+// keep the element around should prefer a compact dropped copy.
 unsigned short LogBufferElement::setDropped(unsigned short value) {
-    // The tag information is saved in mMsg data, if the tag is non-zero
-    // save only the information needed to get the tag.
-    if (getTag() != 0) {
-        if (mMsgLen > sizeof(android_event_header_t)) {
-            char* truncated_msg = new char[sizeof(android_event_header_t)];
-            memcpy(truncated_msg, mMsg, sizeof(android_event_header_t));
-            delete[] mMsg;
-            mMsg = truncated_msg;
-        }  // mMsgLen == sizeof(android_event_header_t), already at minimum.
-    } else {
-        delete[] mMsg;
+    if (!mDropped && (getTag() == 0)) {
         mMsg = nullptr;
     }
     mDropped = true;
@@ -243,12 +308,29 @@ log_time LogBufferElement::flushTo(SocketClient* reader, LogBuffer* parent,
     entry.sec = mRealTime.tv_sec;
     entry.nsec = mRealTime.tv_nsec;
 
-    struct iovec iovec[2];
+    struct iovec iovec[3];
     iovec[0].iov_base = &entry;
     iovec[0].iov_len = entry.hdr_size;
 
     char* buffer = NULL;
 
+    if (isCompressed()) {
+        // Nested pin, LogBuffer::flushTo() keeps the block inflated while it
+        // walks through a run of its entries.
+        ColdRef ref = getColdRef();
+        const char* body = ref.block->pin();
+        if (!body) return mRealTime;
+        entry.len = mMsgLen;
+        iovec[1].iov_base = mMsg;
+        iovec[1].iov_len = ref.prefixLen;
+        iovec[2].iov_base = const_cast<char*>(body + ref.offset);
+        iovec[2].iov_len = mMsgLen - ref.prefixLen;
+        log_time retval =
+            reader->sendDatav(iovec, 3) ? FLUSH_ERROR : mRealTime;
+        ref.block->unpin();
+        return retval;
+    }
+
     if (mDropped) {
         entry.len = populateDroppedMessage(buffer, parent, lastSame);
         if (!entry.len) return mRealTime;
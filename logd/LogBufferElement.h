@@ -24,6 +24,9 @@
 #include <log/log.h>
 #include <sysutils/SocketClient.h>
 
+#include "LogBufferArena.h"
+#include "LogBufferBlock.h"
+
 class LogBuffer;
 
 #define EXPIRE_HOUR_THRESHOLD 24  // Only expire chatty UID logs to preserve
@@ -40,13 +43,24 @@ class __attribute__((packed)) LogBufferElement {
     const uint32_t mPid;
     const uint32_t mTid;
     log_time mRealTime;
-    char* mMsg;
+    char* mMsg;  // inline, immediately follows the element in its arena
     union {
         const uint16_t mMsgLen;  // mDropped == false
         uint16_t mDroppedCount;  // mDropped == true
     };
     const uint8_t mLogId;
     bool mDropped;
+    bool mCompressed;  // payload moved to a LogBufferBlock, see ColdRef
+
+    // Inline data of a compressed element, followed by the resident prefix
+    // (priority and tag) that mMsg points to.
+    struct __attribute__((packed)) ColdRef {
+        LogBufferBlock* block;
+        uint32_t offset;  // of the remaining payload in the inflated block
+        uint16_t prefixLen;
+        uint16_t share;  // of the block compressed size charged to us
+    };
+    ColdRef getColdRef() const;
 
     static atomic_int_fast64_t sequence;
 
@@ -55,11 +69,40 @@ class __attribute__((packed)) LogBufferElement {
                                   bool lastSame);
 
    public:
+    // Elements are allocated with their payload from a LogBufferArena, len
+    // being the payload size:
+    //     new (arena, len) LogBufferElement(...)
+    // A nullptr return signals the arena is out of memory.
+    static void* operator new(size_t size, LogBufferArena& arena,
+                              size_t len) noexcept {
+        return arena.allocate(size + len);
+    }
+    static void operator delete(void* ptr, LogBufferArena&, size_t) {
+        LogBufferArena::release(ptr);
+    }
+    static void operator delete(void* ptr) {
+        LogBufferArena::release(ptr);
+    }
+
     LogBufferElement(log_id_t log_id, log_time realtime, uid_t uid, pid_t pid,
                      pid_t tid, const char* msg, unsigned short len);
     LogBufferElement(const LogBufferElement& elem);
+    // Compact chatty copy of elem holding only what is needed for getTag(),
+    // allocate with a len of droppedLen(elem).
+    LogBufferElement(const LogBufferElement& elem, unsigned short dropped);
+    // Cold copy of elem keeping only the prefix resident, the rest of the
+    // payload is at offset in block. Allocate with a len of coldLen(elem).
+    LogBufferElement(const LogBufferElement& elem, LogBufferBlock* block,
+                     uint32_t offset, uint16_t share);
     ~LogBufferElement();
 
+    static size_t droppedLen(const LogBufferElement& elem);
+    // Resident part of the payload if elem were compressed, 0 if it can not.
+    static size_t prefixLen(const LogBufferElement& elem);
+    static size_t coldLen(const LogBufferElement& elem) {
+        return sizeof(ColdRef) + prefixLen(elem);
+    }
+
     bool isBinary(void) const {
         return (mLogId == LOG_ID_EVENTS) || (mLogId == LOG_ID_SECURITY);
     }
@@ -84,9 +127,18 @@ class __attribute__((packed)) LogBufferElement {
     unsigned short getMsgLen() const {
         return mDropped ? 0 : mMsgLen;
     }
+    // Only the prefix, priority and tag, is resident if isCompressed()
     const char* getMsg() const {
         return mDropped ? nullptr : mMsg;
     }
+    bool isCompressed() const {
+        return mCompressed && !mDropped;
+    }
+    LogBufferBlock* getBlock() const {
+        return isCompressed() ? getColdRef().block : nullptr;
+    }
+    // memory charged to the payload
+    unsigned short getPhysicalLen() const;
     log_time getRealTime(void) const {
         return mRealTime;
     }
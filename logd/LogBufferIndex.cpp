@@ -0,0 +1,64 @@
+/*
+ * Copyright (C) 2018 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <algorithm>
+
+#include "LogBufferElement.h"
+#include "LogBufferIndex.h"
+
+void LogBufferIndex::append(LogBufferElementCollection::iterator it) {
+    if (++mSinceLast < kStride) return;
+
+    log_time realtime = (*it)->getRealTime();
+    // keep the anchors sorted, try again with the next entry
+    if (!mAnchors.empty() && (realtime < mAnchors.back().realtime)) return;
+
+    mAnchors.push_back({ realtime, it });
+    mSinceLast = 0;
+}
+
+void LogBufferIndex::erase(LogBufferElementCollection::iterator it) {
+    if (mAnchors.empty()) return;
+
+    // Pruning expires the oldest entries first
+    if (mAnchors.front().it == it) {
+        mAnchors.pop_front();
+        return;
+    }
+
+    log_time realtime = (*it)->getRealTime();
+    auto anchor = std::lower_bound(
+        mAnchors.begin(), mAnchors.end(), realtime,
+        [](const Anchor& a, const log_time& t) { return a.realtime < t; });
+    for (; (anchor != mAnchors.end()) && (anchor->realtime == realtime);
+         ++anchor) {
+        if (anchor->it == it) {
+            mAnchors.erase(anchor);
+            return;
+        }
+    }
+}
+
+bool LogBufferIndex::seek(const log_time& time,
+                          LogBufferElementCollection::iterator& it) const {
+    if (mAnchors.empty() || (mAnchors.back().realtime < time)) return false;
+
+    auto anchor = std::lower_bound(
+        mAnchors.begin(), mAnchors.end(), time,
+        [](const Anchor& a, const log_time& t) { return a.realtime < t; });
+    if (anchor != mAnchors.begin()) it = (--anchor)->it;
+    return true;
+}
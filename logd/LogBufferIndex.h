@@ -0,0 +1,79 @@
+/*
+ * Copyright (C) 2018 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _LOGD_LOG_BUFFER_INDEX_H__
+#define _LOGD_LOG_BUFFER_INDEX_H__
+
+#include <stddef.h>
+
+#include <deque>
+#include <list>
+
+#include <android-base/macros.h>
+#include <log/log_time.h>
+
+class LogBufferElement;
+
+typedef std::list<LogBufferElement*> LogBufferElementCollection;
+
+// Sparse time index into the LogBuffer element list.
+//
+// An anchor is recorded every kStride entries appended at the end of the
+// list, so the anchors are in time order and a reader asking for a start
+// time far back in the buffer is placed with a binary search rather than a
+// walk over the list. Entries inserted out of order are not anchored.
+//
+// Must be protected by LogBuffer::wrlock(), seek() by rdlock().
+class LogBufferIndex {
+   public:
+    static constexpr size_t kStride = 256;
+
+    LogBufferIndex() : mSinceLast(0) {
+    }
+
+    // it was appended at the end of the list
+    void append(LogBufferElementCollection::iterator it);
+    // it is about to be erased from the list
+    void erase(LogBufferElementCollection::iterator it);
+    // element times were changed in place
+    void clear() {
+        mAnchors.clear();
+        mSinceLast = 0;
+    }
+
+    // Returns false if time is newer than the last anchor, a scan from the
+    // end of the list is then cheaper. Otherwise it is set to the last anchor
+    // older than time, or left alone if there is none.
+    bool seek(const log_time& time,
+              LogBufferElementCollection::iterator& it) const;
+
+    size_t size() const {
+        return mAnchors.size();
+    }
+
+   private:
+    struct Anchor {
+        log_time realtime;
+        LogBufferElementCollection::iterator it;
+    };
+
+    std::deque<Anchor> mAnchors;
+    size_t mSinceLast;  // entries appended since the last anchor
+
+    DISALLOW_COPY_AND_ASSIGN(LogBufferIndex);
+};
+
+#endif  // _LOGD_LOG_BUFFER_INDEX_H__
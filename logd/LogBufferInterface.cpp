@@ -21,6 +21,13 @@ LogBufferInterface::LogBufferInterface() {
 }
 LogBufferInterface::~LogBufferInterface() {
 }
+void LogBufferInterface::logBatch(const LogBufferEntry* entries, size_t count,
+                                  int* result) {
+    for (size_t i = 0; i < count; ++i) {
+        const LogBufferEntry& e = entries[i];
+        result[i] = log(e.log_id, e.realtime, e.uid, e.pid, e.tid, e.msg, e.len);
+    }
+}
 uid_t LogBufferInterface::pidToUid(pid_t pid) {
     return android::pidToUid(pid);
 }
@@ -23,6 +23,17 @@
 #include <log/log_id.h>
 #include <log/log_time.h>
 
+// Arguments of one LogBufferInterface::log() call, for batches.
+struct LogBufferEntry {
+    log_id_t log_id;
+    log_time realtime;
+    uid_t uid;
+    pid_t pid;
+    pid_t tid;
+    const char* msg;
+    unsigned short len;
+};
+
 // Abstract interface that handles log when log available.
 class LogBufferInterface {
    public:
@@ -32,6 +43,11 @@ class LogBufferInterface {
     // Returns the size of the handled log message.
     virtual int log(log_id_t log_id, log_time realtime, uid_t uid, pid_t pid,
                     pid_t tid, const char* msg, unsigned short len) = 0;
+    // Handles count log entries received together in LogListener, result[i]
+    // is what log() returns for entries[i]. Implementations may merge the
+    // whole batch at once, the default calls log() for each entry.
+    virtual void logBatch(const LogBufferEntry* entries, size_t count,
+                          int* result);
 
     virtual uid_t pidToUid(pid_t pid);
     virtual pid_t tidToPid(pid_t tid);
@@ -0,0 +1,107 @@
+/*
+ * Copyright (C) 2018 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _LOGD_LOG_BUFFER_QUEUE_H__
+#define _LOGD_LOG_BUFFER_QUEUE_H__
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <atomic>
+
+#include <android-base/macros.h>
+
+class LogBufferElement;
+
+// Bounded queue of elements handed over by writers that found the
+// LogBuffer element lock busy.
+//
+// Each slot carries a sequence number. A writer claims a slot by advancing
+// mTail and publishes it by bumping the slot sequence, so handing over an
+// entry never waits on readers. There is a single consumer at a time,
+// whoever holds LogBuffer::wrlock(), which merges the entries in the order
+// they were published.
+class LogBufferQueue {
+   public:
+    static constexpr size_t kSize = 256;  // power of two
+
+    LogBufferQueue() : mHead(0), mTail(0) {
+        for (size_t i = 0; i < kSize; ++i) {
+            mSlots[i].sequence.store(i, std::memory_order_relaxed);
+            mSlots[i].value = 0;
+        }
+    }
+
+    // Returns false if the queue is full, caller must then take the lock.
+    bool push(LogBufferElement* elem, bool loggable) {
+        size_t pos = mTail.load(std::memory_order_relaxed);
+        for (;;) {
+            Slot& slot = mSlots[pos & (kSize - 1)];
+            size_t seq = slot.sequence.load(std::memory_order_acquire);
+            intptr_t diff = (intptr_t)seq - (intptr_t)pos;
+            if (diff == 0) {
+                if (mTail.compare_exchange_weak(pos, pos + 1,
+                                                std::memory_order_relaxed)) {
+                    // elements are at least 8 byte aligned, borrow bit 0
+                    slot.value = reinterpret_cast<uintptr_t>(elem) | !loggable;
+                    slot.sequence.store(pos + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if (diff < 0) {
+                return false;
+            } else {
+                pos = mTail.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    // Consumer only. Returns false if empty, or if the next writer in line
+    // has claimed its slot but not yet published; it will drain on its own.
+    bool pop(LogBufferElement*& elem, bool& loggable) {
+        size_t pos = mHead.load(std::memory_order_relaxed);
+        Slot& slot = mSlots[pos & (kSize - 1)];
+        if (slot.sequence.load(std::memory_order_acquire) != (pos + 1)) {
+            return false;
+        }
+        uintptr_t value = slot.value;
+        elem = reinterpret_cast<LogBufferElement*>(value & ~uintptr_t(1));
+        loggable = !(value & 1);
+        mHead.store(pos + 1, std::memory_order_relaxed);
+        slot.sequence.store(pos + kSize, std::memory_order_release);
+        return true;
+    }
+
+    // An entry is ready for pop()
+    bool ready() const {
+        size_t pos = mHead.load(std::memory_order_relaxed);
+        const Slot& slot = mSlots[pos & (kSize - 1)];
+        return slot.sequence.load(std::memory_order_acquire) == (pos + 1);
+    }
+
+   private:
+    struct Slot {
+        std::atomic<size_t> sequence;
+        uintptr_t value;
+    };
+
+    Slot mSlots[kSize];
+    std::atomic<size_t> mHead;
+    std::atomic<size_t> mTail;
+
+    DISALLOW_COPY_AND_ASSIGN(LogBufferQueue);
+};
+
+#endif  // _LOGD_LOG_BUFFER_QUEUE_H__
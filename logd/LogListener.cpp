@@ -43,39 +43,79 @@ bool LogListener::onDataAvailable(SocketClient* cli) {
         name_set = true;
     }
 
-    // + 1 to ensure null terminator if MAX_PAYLOAD buffer is received
-    char buffer[sizeof_log_id_t + sizeof(uint16_t) + sizeof(log_time) +
-                LOGGER_ENTRY_MAX_PAYLOAD + 1];
-    struct iovec iov = { buffer, sizeof(buffer) - 1 };
-
-    alignas(4) char control[CMSG_SPACE(sizeof(struct ucred))];
-    struct msghdr hdr = {
-        NULL, 0, &iov, 1, control, sizeof(control), 0,
-    };
+    struct iovec iov[kBatch];
+    struct mmsghdr msgs[kBatch];
+    for (size_t i = 0; i < kBatch; ++i) {
+        iov[i] = { buffers[i], sizeof(buffers[i]) - 1 };
+        msgs[i].msg_hdr = {
+            NULL, 0, &iov[i], 1, controls[i], sizeof(controls[i]), 0,
+        };
+        msgs[i].msg_len = 0;
+    }
 
     int socket = cli->getSocket();
 
+    // Drain what is queued on the socket in one go, during log storms the
+    // syscall and buffer lock per message dominate our cpu time.
+    int count = recvmmsg(socket, msgs, kBatch, MSG_DONTWAIT, NULL);
+    if (count <= 0) {
+        return false;
+    }
+
+    bool logged = false;
+    size_t n = 0;
+    for (int i = 0; i < count; ++i) {
+        if ((n + kSplit) > kEntries) {
+            logged |= commit(n);
+            n = 0;
+        }
+        n += parse(&msgs[i].msg_hdr, msgs[i].msg_len, &entries[n]);
+    }
+
+    return commit(n) || logged;
+}
+
+bool LogListener::commit(size_t n) {
+    if ((logbuf != nullptr) && n) {
+        int res[kEntries];
+        logbuf->logBatch(entries, n, res);
+        log_mask_t logMask = 0;
+        for (size_t i = 0; i < n; ++i) {
+            if (res[i] > 0) logMask |= 1 << entries[i].log_id;
+        }
+        if (logMask && (reader != nullptr)) {
+            reader->notifyNewLog(logMask);
+        }
+    }
+
+    return n != 0;
+}
+
+// Check credentials and fill in the entries for one received datagram of n
+// bytes, returns how many, at most kSplit.
+size_t LogListener::parse(struct msghdr* hdr, ssize_t n,
+                          LogBufferEntry* entry) {
+    if (n <= (ssize_t)(sizeof(android_log_header_t))) {
+        return 0;
+    }
+
     // To clear the entire buffer is secure/safe, but this contributes to 1.68%
     // overhead under logging load. We are safe because we check counts, but
     // still need to clear null terminator
     // memset(buffer, 0, sizeof(buffer));
-    ssize_t n = recvmsg(socket, &hdr, 0);
-    if (n <= (ssize_t)(sizeof(android_log_header_t))) {
-        return false;
-    }
-
+    char* buffer = static_cast<char*>(hdr->msg_iov[0].iov_base);
     buffer[n] = 0;
 
     struct ucred* cred = NULL;
 
-    struct cmsghdr* cmsg = CMSG_FIRSTHDR(&hdr);
+    struct cmsghdr* cmsg = CMSG_FIRSTHDR(hdr);
     while (cmsg != NULL) {
         if (cmsg->cmsg_level == SOL_SOCKET &&
             cmsg->cmsg_type == SCM_CREDENTIALS) {
             cred = (struct ucred*)CMSG_DATA(cmsg);
             break;
         }
-        cmsg = CMSG_NXTHDR(&hdr, cmsg);
+        cmsg = CMSG_NXTHDR(hdr, cmsg);
     }
 
     struct ucred fake_cred;
@@ -89,21 +129,22 @@ bool LogListener::onDataAvailable(SocketClient* cli) {
         // ignore log messages we send to ourself.
         // Such log messages are often generated by libraries we depend on
         // which use standard Android logging.
-        return false;
+        return 0;
     }
 
     android_log_header_t* header =
         reinterpret_cast<android_log_header_t*>(buffer);
+    bool batch = header->id == LOG_ID_BATCH;
     log_id_t logId = static_cast<log_id_t>(header->id);
-    if (/* logId < LOG_ID_MIN || */ logId >= LOG_ID_MAX ||
-        logId == LOG_ID_KERNEL) {
-        return false;
+    if (!batch && (/* logId < LOG_ID_MIN || */ logId >= LOG_ID_MAX ||
+                   logId == LOG_ID_KERNEL)) {
+        return 0;
     }
 
     if ((logId == LOG_ID_SECURITY) &&
         (!__android_log_security() ||
          !clientHasLogCredentials(cred->uid, cred->gid, cred->pid))) {
-        return false;
+        return 0;
     }
 
     // Check credential validity, acquire corrected details if not supplied.
@@ -114,7 +155,7 @@ bool LogListener::onDataAvailable(SocketClient* cli) {
             // We expect that /proc/<tid>/ is accessible to self even without
             // readproc group, so that we will always drop messages that come
             // from any of our logd threads and their library calls.
-            return false;  // ignore self
+            return 0;  // ignore self
         }
     }
     if (cred->uid == DEFAULT_OVERFLOWUID) {
@@ -127,22 +168,52 @@ bool LogListener::onDataAvailable(SocketClient* cli) {
         if (uid != AID_LOGD) cred->uid = uid;
     }
 
-    char* msg = ((char*)buffer) + sizeof(android_log_header_t);
     n -= sizeof(android_log_header_t);
 
-    // NB: hdr.msg_flags & MSG_TRUNC is not tested, silently passing a
+    // NB: hdr->msg_flags & MSG_TRUNC is not tested, silently passing a
     // truncated message to the logs.
 
-    if (logbuf != nullptr) {
-        int res = logbuf->log(
-            logId, header->realtime, cred->uid, cred->pid, header->tid, msg,
-            ((size_t)n <= USHRT_MAX) ? (unsigned short)n : USHRT_MAX);
-        if (res > 0 && reader != nullptr) {
-            reader->notifyNewLog(static_cast<log_mask_t>(1 << logId));
+    if (!batch) {
+        entry->log_id = logId;
+        entry->realtime = header->realtime;
+        entry->uid = cred->uid;
+        entry->pid = cred->pid;
+        entry->tid = header->tid;
+        entry->msg = buffer + sizeof(android_log_header_t);
+        entry->len = ((size_t)n <= USHRT_MAX) ? (unsigned short)n : USHRT_MAX;
+        return 1;
+    }
+
+    // Split a batch from liblog, a truncated last entry is dropped. Security
+    // entries are never batched.
+    size_t count = 0;
+    const char* msg = buffer + sizeof(android_log_header_t);
+    while ((n > (ssize_t)sizeof(android_log_batch_header_t)) &&
+           (count < kSplit)) {
+        const android_log_batch_header_t* batchHeader =
+            reinterpret_cast<const android_log_batch_header_t*>(msg);
+        ssize_t len = batchHeader->len;
+        n -= sizeof(android_log_batch_header_t);
+        msg += sizeof(android_log_batch_header_t);
+        if (!len || (len > n)) break;
+        logId = static_cast<log_id_t>(batchHeader->id);
+        if (/* logId >= LOG_ID_MIN && */ logId < LOG_ID_MAX &&
+            logId != LOG_ID_KERNEL && logId != LOG_ID_SECURITY) {
+            entry->log_id = logId;
+            entry->realtime = batchHeader->realtime;
+            entry->uid = cred->uid;
+            entry->pid = cred->pid;
+            entry->tid = header->tid;
+            entry->msg = msg;
+            entry->len = len;
+            ++entry;
+            ++count;
         }
+        n -= len;
+        msg += len;
     }
 
-    return true;
+    return count;
 }
 
 int LogListener::getLogSocket() {
@@ -17,7 +17,12 @@
 #ifndef _LOGD_LOG_LISTENER_H__
 #define _LOGD_LOG_LISTENER_H__
 
+#include <sys/socket.h>
+
+#include <private/android_logger.h>
 #include <sysutils/SocketListener.h>
+
+#include "LogBufferInterface.h"
 #include "LogReader.h"
 
 // DEFAULT_OVERFLOWUID is defined in linux/highuid.h, which is not part of
@@ -34,6 +39,18 @@ class LogListener : public SocketListener {
     LogBufferInterface* logbuf;
     LogReader* reader;
 
+    // datagrams drained from the socket per recvmmsg
+    static constexpr size_t kBatch = 32;
+    // + 1 to ensure null terminator if MAX_PAYLOAD buffer is received
+    char buffers[kBatch][sizeof_log_id_t + sizeof(uint16_t) + sizeof(log_time) +
+                         LOGGER_ENTRY_MAX_PAYLOAD + 1];
+    alignas(4) char controls[kBatch][CMSG_SPACE(sizeof(struct ucred))];
+    // most entries a LOG_ID_BATCH datagram can carry
+    static constexpr size_t kSplit =
+        LOGGER_ENTRY_MAX_PAYLOAD / (sizeof(android_log_batch_header_t) + 1);
+    static constexpr size_t kEntries = 2 * kSplit;
+    LogBufferEntry entries[kEntries];
+
    public:
     LogListener(LogBufferInterface* buf, LogReader* reader /* nullable */);
 
@@ -42,6 +59,8 @@ class LogListener : public SocketListener {
 
    private:
     static int getLogSocket();
+    size_t parse(struct msghdr* hdr, ssize_t n, LogBufferEntry* entry);
+    bool commit(size_t n);
 };
 
 #endif
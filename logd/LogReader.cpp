@@ -32,6 +32,9 @@
 
 LogReader::LogReader(LogBuffer* logbuf)
     : SocketListener(getLogSocket(), true), mLogbuf(*logbuf) {
+    // A non-blocking reader with a start time scans the whole buffer before
+    // it is answered, do not make the other readers wait behind it.
+    setWorkerThreads(LOGD_READER_WORKERS);
 }
 
 // When we are notified a new log entry is available, inform
@@ -42,13 +45,13 @@ void LogReader::notifyNewLog(log_mask_t logMask) {
 }
 
 bool LogReader::onDataAvailable(SocketClient* cli) {
-    static bool name_set;
+    static thread_local bool name_set;
     if (!name_set) {
         prctl(PR_SET_NAME, "logd.reader");
         name_set = true;
     }
 
-    char buffer[255];
+    char buffer[1024];
 
     int len = read(cli->getSocket(), buffer, sizeof(buffer) - 1);
     if (len <= 0) {
@@ -57,9 +60,19 @@ bool LogReader::onDataAvailable(SocketClient* cli) {
     }
     buffer[len] = '\0';
 
+    // The filter spec goes last and may contain anything, take it out of
+    // the way of the other keys.
+    const char* filter = nullptr;
+    static const char _filter[] = " filter=";
+    char* cp = strstr(buffer, _filter);
+    if (cp) {
+        *cp = '\0';
+        filter = cp + sizeof(_filter) - 1;
+    }
+
     unsigned long tail = 0;
     static const char _tail[] = " tail=";
-    char* cp = strstr(buffer, _tail);
+    cp = strstr(buffer, _tail);
     if (cp) {
         tail = atol(cp + sizeof(_tail) - 1);
     }
@@ -199,7 +212,8 @@ bool LogReader::onDataAvailable(SocketClient* cli) {
         cli->getUid(), cli->getGid(), cli->getPid(), nonBlock ? 'n' : 'b', tail,
         logMask, (int)pid, sequence.nsec(), timeout);
 
-    FlushCommand command(*this, nonBlock, tail, logMask, pid, sequence, timeout);
+    FlushCommand command(*this, nonBlock, tail, logMask, pid, sequence, timeout,
+                         filter);
 
     // Set acceptable upper limit to wait for slow reader processing b/27242723
     struct timeval t = { LOGD_SNDTIMEO, 0 };
@@ -22,6 +22,7 @@
 #include "LogTimes.h"
 
 #define LOGD_SNDTIMEO 32
+#define LOGD_READER_WORKERS 4
 
 class LogBuffer;
 
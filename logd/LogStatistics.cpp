@@ -34,7 +34,7 @@ static const uint64_t monthSec = 31 * 24 * hourSec;
 
 size_t LogStatistics::SizesTotal;
 
-LogStatistics::LogStatistics() : enable(false) {
+LogStatistics::LogStatistics() : mDeferred(0), mBlocked(0), enable(false) {
     log_time now(CLOCK_REALTIME);
     log_id_for_each(id) {
         mSizes[id] = 0;
@@ -45,6 +45,9 @@ LogStatistics::LogStatistics() : enable(false) {
         mOldest[id] = now;
         mNewest[id] = now;
         mNewestDropped[id] = now;
+        mArenaSizes[id] = 0;
+        mPhysicalSizes[id] = 0;
+        mCompressedSizes[id] = 0;
     }
 }
 
@@ -93,6 +96,8 @@ void LogStatistics::add(LogBufferElement* element) {
     log_id_t log_id = element->getLogId();
     unsigned short size = element->getMsgLen();
     mSizes[log_id] += size;
+    mPhysicalSizes[log_id] += element->getPhysicalLen();
+    if (element->isCompressed()) mCompressedSizes[log_id] += size;
     ++mElements[log_id];
 
     // When caller adding a chatty entry, they will have already
@@ -163,6 +168,8 @@ void LogStatistics::subtract(LogBufferElement* element) {
     log_id_t log_id = element->getLogId();
     unsigned short size = element->getMsgLen();
     mSizes[log_id] -= size;
+    mPhysicalSizes[log_id] -= element->getPhysicalLen();
+    if (element->isCompressed()) mCompressedSizes[log_id] -= size;
     --mElements[log_id];
     if (element->getDropped()) {
         --mDroppedElements[log_id];
@@ -202,12 +209,22 @@ void LogStatistics::subtract(LogBufferElement* element) {
     }
 }
 
+// Logical size and all the tables are unchanged, only the resident size
+void LogStatistics::compress(LogBufferElement* hot, LogBufferElement* cold) {
+    log_id_t log_id = cold->getLogId();
+    mPhysicalSizes[log_id] -= hot->getPhysicalLen();
+    mPhysicalSizes[log_id] += cold->getPhysicalLen();
+    mCompressedSizes[log_id] += cold->getMsgLen();
+}
+
 // Atomically set an entry to drop
 // entry->setDropped(1) must follow this call, caller should do this explicitly.
 void LogStatistics::drop(LogBufferElement* element) {
     log_id_t log_id = element->getLogId();
     unsigned short size = element->getMsgLen();
     mSizes[log_id] -= size;
+    mPhysicalSizes[log_id] -= element->getPhysicalLen();
+    if (element->isCompressed()) mCompressedSizes[log_id] -= size;
     ++mDroppedElements[log_id];
 
     if (mNewestDropped[log_id] < element->getRealTime()) {
@@ -680,6 +697,29 @@ std::string LogStatistics::format(uid_t uid, pid_t pid,
     output += android::base::StringPrintf("%*s%zu/%zu", spaces, "", totalSize,
                                           totalEls);
 
+    // resident size, less than Now when older entries are compressed
+    static const char PhysicalStr[] = "\nPhysical";
+    spaces = 10 - strlen(PhysicalStr);
+    output += PhysicalStr;
+
+    totalSize = 0;
+    log_id_for_each(id) {
+        if (!(logMask & (1 << id))) continue;
+
+        size_t els = elements(id);
+        if (els) {
+            oldLength = output.length();
+            if (spaces < 0) spaces = 0;
+            size_t szs = physicalSizes(id);
+            totalSize += szs;
+            output += android::base::StringPrintf("%*s%zu", spaces, "", szs);
+            spaces -= output.length() - oldLength;
+        }
+        spaces += spaces_total;
+    }
+    if (spaces < 0) spaces = 0;
+    output += android::base::StringPrintf("%*s%zu", spaces, "", totalSize);
+
     static const char SpanStr[] = "\nLogspan";
     spaces = 10 - strlen(SpanStr);
     output += SpanStr;
@@ -753,12 +793,11 @@ std::string LogStatistics::format(uid_t uid, pid_t pid,
         if (els) {
             oldLength = output.length();
             if (spaces < 0) spaces = 0;
-            // estimate the std::list overhead.
-            static const size_t overhead =
-                ((sizeof(LogBufferElement) + sizeof(uint64_t) - 1) &
-                 -sizeof(uint64_t)) +
-                sizeof(std::list<LogBufferElement*>);
-            size_t szs = sizes(id) + els * overhead;
+            // arena and compressed blocks hold element and payload, estimate
+            // the std::list overhead on top of that.
+            static const size_t overhead = sizeof(std::list<LogBufferElement*>);
+            size_t szs =
+                std::max(mArenaSizes[id], physicalSizes(id)) + els * overhead;
             totalSize += szs;
             output += android::base::StringPrintf("%*s%zu", spaces, "", szs);
             spaces -= output.length() - oldLength;
@@ -769,6 +808,13 @@ std::string LogStatistics::format(uid_t uid, pid_t pid,
     if (spaces < 0) spaces = 0;
     output += android::base::StringPrintf("%*s%zu", spaces, "", totalSize);
 
+    // Writers never wait behind readers unless the hand over queue is full
+    output += android::base::StringPrintf(
+        "\nContended %zu deferred, blocked %" PRIu64 "ms",
+        mDeferred.load(std::memory_order_relaxed),
+        static_cast<uint64_t>(mBlocked.load(std::memory_order_relaxed) /
+                              (NS_PER_SEC / MS_PER_SEC)));
+
     // Report on Chattiest
 
     std::string name;
@@ -25,6 +25,7 @@
 #include <sys/types.h>
 
 #include <algorithm>  // std::max
+#include <atomic>
 #include <memory>
 #include <string>
 #include <string_view>
@@ -677,6 +678,13 @@ class LogStatistics {
     log_time mOldest[LOG_ID_MAX];
     log_time mNewest[LOG_ID_MAX];
     log_time mNewestDropped[LOG_ID_MAX];
+    size_t mArenaSizes[LOG_ID_MAX];
+    // resident payload, and the part of mSizes held in compressed blocks
+    size_t mPhysicalSizes[LOG_ID_MAX];
+    size_t mCompressedSizes[LOG_ID_MAX];
+    // writer contention on the LogBuffer element lock, updated without it
+    std::atomic<size_t> mDeferred;
+    std::atomic<uint64_t> mBlocked;  // nanoseconds
     static size_t SizesTotal;
     bool enable;
 
@@ -744,6 +752,8 @@ class LogStatistics {
     void subtract(LogBufferElement* entry);
     // entry->setDropped(1) must follow this call
     void drop(LogBufferElement* entry);
+    // hot has been replaced by its compressed copy cold
+    void compress(LogBufferElement* hot, LogBufferElement* cold);
     // Correct for coalescing two entries referencing dropped content
     void erase(LogBufferElement* element) {
         log_id_t log_id = element->getLogId();
@@ -762,10 +772,30 @@ class LogStatistics {
         return LogFindWorst<TagEntry>(tagTable.sort(uid, pid, len));
     }
 
+    // writer found the lock busy and left its entry to the holder
+    void addDeferred() {
+        mDeferred.fetch_add(1, std::memory_order_relaxed);
+    }
+    // writer had to wait for the lock
+    void addBlocked(const log_time& blocked) {
+        mBlocked.fetch_add(blocked.nsec(), std::memory_order_relaxed);
+    }
+
+    // memory backing the elements, reported as part of the overhead
+    void setArenaSize(log_id_t id, size_t size) {
+        mArenaSizes[id] = size;
+    }
+
     // fast track current value by id only
     size_t sizes(log_id_t id) const {
         return mSizes[id];
     }
+    size_t physicalSizes(log_id_t id) const {
+        return mPhysicalSizes[id];
+    }
+    size_t compressedSizes(log_id_t id) const {
+        return mCompressedSizes[id];
+    }
     size_t elements(log_id_t id) const {
         return mElements[id];
     }
@@ -0,0 +1,70 @@
+/*
+ * Copyright (C) 2018 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <string.h>
+
+#include "LogBuffer.h"
+#include "LogBufferElement.h"
+#include "LogTagFilter.h"
+
+LogTagFilter::~LogTagFilter() {
+    if (mFormat) android_log_format_free(mFormat);
+}
+
+bool LogTagFilter::init(const char* spec) {
+    if (mFormat) {
+        android_log_format_free(mFormat);
+        mFormat = nullptr;
+    }
+    if (!spec[strspn(spec, " \t,")]) return true;
+
+    AndroidLogFormat* format = android_log_format_new();
+    if (!format) return false;
+    if (android_log_addFilterString(format, spec) < 0) {
+        android_log_format_free(format);
+        return false;
+    }
+    mFormat = format;
+    return true;
+}
+
+bool LogTagFilter::match(const LogBufferElement* element,
+                         LogBuffer& logbuf) const {
+    if (!mFormat) return true;
+
+    // chatty entries are reported with an info priority
+    int pri = ANDROID_LOG_INFO;
+    const char* tag;
+
+    if (element->getDropped()) {
+        tag = "chatty";
+    } else if (element->isBinary() ||
+               (element->getLogId() == LOG_ID_STATS)) {
+        tag = logbuf.tagToName(element->getTag());
+        if (!tag) return true;  // reader may know it by another name
+    } else {
+        const char* msg = element->getMsg();
+        unsigned short msgLen = element->getMsgLen();
+        if (!msg || (msgLen < 2)) return true;
+        // the reader sees an unterminated tag as the rest of the payload
+        if (!memchr(msg + 1, '\0', msgLen - 1)) return true;
+        pri = msg[0];
+        tag = msg + 1;
+    }
+
+    return android_log_shouldPrintLine(
+        mFormat, tag, static_cast<android_LogPriority>(pri));
+}
@@ -0,0 +1,54 @@
+/*
+ * Copyright (C) 2018 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _LOGD_LOG_TAG_FILTER_H__
+#define _LOGD_LOG_TAG_FILTER_H__
+
+#include <android/log.h>
+#include <log/logprint.h>
+
+class LogBuffer;
+class LogBufferElement;
+
+// Reader side tag and priority filter, a filterspec as understood by
+// android_log_addFilterString() (logcat) pushed down so that logd does not
+// send entries the reader is going to discard. The rules are parsed and
+// matched by liblog's logprint, so logd and logcat can not disagree.
+//
+// An element passes if the reader would print it; when in doubt it passes,
+// the reader still applies its own filter.
+class LogTagFilter {
+   public:
+    LogTagFilter() : mFormat(nullptr) {
+    }
+    ~LogTagFilter();
+
+    // An invalid spec leaves the filter disabled.
+    bool init(const char* spec);
+
+    bool enabled() const {
+        return mFormat != nullptr;
+    }
+    bool match(const LogBufferElement* element, LogBuffer& logbuf) const;
+
+   private:
+    LogTagFilter(const LogTagFilter&) = delete;
+    void operator=(const LogTagFilter&) = delete;
+
+    AndroidLogFormat* mFormat;
+};
+
+#endif  // _LOGD_LOG_TAG_FILTER_H__
@@ -29,7 +29,8 @@ pthread_mutex_t LogTimeEntry::timesLock = PTHREAD_MUTEX_INITIALIZER;
 
 LogTimeEntry::LogTimeEntry(LogReader& reader, SocketClient* client,
                            bool nonBlock, unsigned long tail, log_mask_t logMask,
-                           pid_t pid, log_time start, uint64_t timeout)
+                           pid_t pid, log_time start, uint64_t timeout,
+                           const char* filter)
     : mRefCount(1),
       mRelease(false),
       mError(false),
@@ -48,6 +49,7 @@ LogTimeEntry::LogTimeEntry(LogReader& reader, SocketClient* client,
     mTimeout.tv_sec = timeout / NS_PER_SEC;
     mTimeout.tv_nsec = timeout % NS_PER_SEC;
     memset(mLastTid, 0, sizeof(mLastTid));
+    if (filter) mFilter.init(filter);
     pthread_cond_init(&threadTriggeredCondition, nullptr);
     cleanSkip_Locked();
 }
@@ -152,6 +154,10 @@ void* LogTimeEntry::threadStart(void* obj) {
         unlock();
 
         if (me->mTail) {
+            // No need to count entries that are going to be skipped
+            log_time tailStart = logbuf.tailStart(me, me->mTail,
+                                                  privileged, security);
+            if (start < tailStart) start = tailStart;
             logbuf.flushTo(client, start, nullptr, privileged, security,
                            FilterFirstPass, me);
             me->leadingDropped = true;
@@ -204,8 +210,7 @@ int LogTimeEntry::FilterFirstPass(const LogBufferElement* element, void* obj) {
         me->mStart = element->getRealTime();
     }
 
-    if ((!me->mPid || (me->mPid == element->getPid())) &&
-        (me->isWatching(element->getLogId()))) {
+    if (me->isSelected(element)) {
         ++me->mCount;
     }
 
@@ -214,6 +219,12 @@ int LogTimeEntry::FilterFirstPass(const LogBufferElement* element, void* obj) {
     return false;
 }
 
+bool LogTimeEntry::isSelected(const LogBufferElement* element) const {
+    return (!mPid || (mPid == element->getPid())) &&
+           isWatching(element->getLogId()) &&
+           mFilter.match(element, mReader.logbuf());
+}
+
 // A second pass to send the selected elements
 int LogTimeEntry::FilterSecondPass(const LogBufferElement* element, void* obj) {
     LogTimeEntry* me = reinterpret_cast<LogTimeEntry*>(obj);
@@ -247,6 +258,10 @@ int LogTimeEntry::FilterSecondPass(const LogBufferElement* element, void* obj) {
         goto skip;
     }
 
+    if (!me->mFilter.match(element, me->mReader.logbuf())) {
+        goto skip;
+    }
+
     if (me->isError_Locked()) {
         goto stop;
     }
@@ -26,6 +26,8 @@
 #include <log/log.h>
 #include <sysutils/SocketClient.h>
 
+#include "LogTagFilter.h"
+
 typedef unsigned int log_mask_t;
 
 class LogReader;
@@ -45,6 +47,7 @@ class LogTimeEntry {
     static void threadStop(void* me);
     const log_mask_t mLogMask;
     const pid_t mPid;
+    LogTagFilter mFilter;
     unsigned int skipAhead[LOG_ID_MAX];
     pid_t mLastTid[LOG_ID_MAX];
     unsigned long mCount;
@@ -54,7 +57,8 @@ class LogTimeEntry {
    public:
     LogTimeEntry(LogReader& reader, SocketClient* client, bool nonBlock,
                  unsigned long tail, log_mask_t logMask, pid_t pid,
-                 log_time start, uint64_t timeout);
+                 log_time start, uint64_t timeout,
+                 const char* filter = nullptr);
 
     SocketClient* mClient;
     log_time mStart;
@@ -141,6 +145,9 @@ class LogTimeEntry {
     bool isWatchingMultiple(log_mask_t logMask) const {
         return mLogMask & logMask;
     }
+    // Selected by log id, pid and tag filter, privilege checks are up to
+    // the caller.
+    bool isSelected(const LogBufferElement* element) const;
     // flushTo filter callbacks
     static int FilterFirstPass(const LogBufferElement* element, void* me);
     static int FilterSecondPass(const LogBufferElement* element, void* me);
@@ -497,6 +497,11 @@ int main(int argc, char* argv[]) {
         logBuf->enableStatistics();
     }
 
+    if (__android_logger_property_get_bool(
+            "logd.compress", BOOL_DEFAULT_FALSE | BOOL_DEFAULT_FLAG_PERSIST)) {
+        logBuf->enableCompression();
+    }
+
     // LogReader listens on /dev/socket/logdr. When a client
     // connects, log entries in the LogBuffer are written to the client.
 
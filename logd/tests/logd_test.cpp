@@ -238,6 +238,101 @@ TEST(logd, statistics) {
 #endif
 }
 
+// Report what each entry costs logd on top of its payload. The Now row of
+// the statistics carries the payload size and count, the Physical row the
+// part of it that is resident once older entries are compressed, and the
+// Overhead row adds the element storage and list linkage.
+TEST(logd, statistics_overhead) {
+#ifdef __ANDROID__
+    size_t len;
+    char* buf;
+
+    alloc_statistics(&buf, &len);
+
+    ASSERT_TRUE(nullptr != buf);
+
+    // first column is the main log buffer
+    unsigned long size = 0;
+    unsigned long elements = 0;
+    unsigned long physical = 0;
+    unsigned long overhead = 0;
+    static const char now_row[] = "\nNow";
+    static const char physical_row[] = "\nPhysical";
+    static const char overhead_row[] = "\nOverhead";
+    char* cp = strstr(buf, now_row);
+    if (cp) sscanf(cp + strlen(now_row), "%lu/%lu", &size, &elements);
+    cp = strstr(buf, physical_row);
+    if (cp) sscanf(cp + strlen(physical_row), "%lu", &physical);
+    cp = strstr(buf, overhead_row);
+    if (cp) sscanf(cp + strlen(overhead_row), "%lu", &overhead);
+
+    delete[] buf;
+
+    ASSERT_NE(0UL, elements);  // failure to parse
+    ASSERT_NE(0UL, physical);
+    EXPECT_LE(physical, size);
+    EXPECT_LE(physical, overhead);
+
+    fprintf(stderr,
+            "main: %lu entries %lu bytes (%lu resident), "
+            "%lu bytes overhead/entry\n",
+            elements, size, physical, (overhead - physical) / elements);
+
+    // No more than a maximum payload per entry even with a cold buffer
+    EXPECT_GT((unsigned long)LOGGER_ENTRY_MAX_PAYLOAD,
+              (overhead - physical) / elements);
+#else
+    GTEST_LOG_(INFO) << "This test does nothing.\n";
+#endif
+}
+
+// The reader filterspec is applied by logd, entries the reader is not going
+// to print do not cross the socket.
+TEST(logd, filter) {
+#ifdef __ANDROID__
+    static const char keep[] = "logd_test_filter_keep";
+    static const char drop[] = "logd_test_filter_drop";
+
+    ASSERT_LT(0, __android_log_buf_write(LOG_ID_MAIN, ANDROID_LOG_INFO, keep,
+                                         "kept"));
+    ASSERT_LT(0, __android_log_buf_write(LOG_ID_MAIN, ANDROID_LOG_INFO, drop,
+                                         "dropped by tag"));
+    ASSERT_LT(0, __android_log_buf_write(LOG_ID_MAIN, ANDROID_LOG_DEBUG, keep,
+                                         "dropped by priority"));
+    usleep(1000000);
+
+    struct logger_list* logger_list;
+    ASSERT_TRUE(nullptr !=
+                (logger_list = android_logger_list_open(
+                     LOG_ID_MAIN, ANDROID_LOG_RDONLY | ANDROID_LOG_NONBLOCK,
+                     0, getpid())));
+    std::string spec = android::base::StringPrintf("*:S %s:I", keep);
+    ASSERT_EQ(0, __android_logger_list_set_filter(logger_list, spec.c_str()));
+
+    int kept = 0;
+    int other = 0;
+    for (;;) {
+        log_msg log_msg;
+        if (android_logger_list_read(logger_list, &log_msg) <= 0) break;
+
+        char* msg = log_msg.msg();
+        if (!msg || (log_msg.entry.len < 2)) continue;
+        if (!strcmp(msg + 1, keep) && (msg[0] >= ANDROID_LOG_INFO)) {
+            ++kept;
+        } else {
+            ++other;
+        }
+    }
+
+    android_logger_list_close(logger_list);
+
+    EXPECT_EQ(1, kept);
+    EXPECT_EQ(0, other);
+#else
+    GTEST_LOG_(INFO) << "This test does nothing.\n";
+#endif
+}
+
 #ifdef __ANDROID__
 static void caught_signal(int /* signum */) {
 }